@@ -0,0 +1,112 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "BaselineTracker.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+
+namespace
+{
+	// taxels within this many columns of an active touch, about two keys, are not updated.
+	const float kTouchRadius = 4.f;
+
+	// a taxel is quiet if it is within this many standard deviations of its mean,
+	// or within this fraction of its mean, whichever is wider.
+	const double kQuietDeviations = 4.;
+	const double kQuietFraction = 0.005;
+
+	// inverse of the key position mapping in TouchTracker's peakToTouch().
+	float keyToSensorX(float kx)
+	{
+		return 3.5f + (kx - 1.f)*2.f;
+	}
+}
+
+void BaselineTracker::setSampleRate(float sr)
+{
+	mSampleRate = sr;
+	updateCoeffs();
+}
+
+void BaselineTracker::setTimeConstant(float seconds)
+{
+	mTimeConstant = seconds;
+	updateCoeffs();
+}
+
+void BaselineTracker::updateCoeffs()
+{
+	mAlpha = 1. - exp(-1./(std::max(mTimeConstant, 0.001f)*mSampleRate));
+	mUpdateInterval = std::max(static_cast<int>(mSampleRate), 1);
+}
+
+void BaselineTracker::reset(const SensorFrame& mean, const SensorFrame& stdDev)
+{
+	for(int i=0; i<kTaxels; ++i)
+	{
+		mMean[i] = mean[i];
+		mVariance[i] = stdDev[i]*stdDev[i];
+	}
+	mFrames = 0;
+	updateCoeffs();
+}
+
+bool BaselineTracker::process(const SensorFrame& raw, const TouchFrame& touches)
+{
+	constexpr int w = SensorGeometry::width;
+	constexpr int h = SensorGeometry::height;
+
+	bool ready = (++mFrames >= mUpdateInterval);
+	if(ready)
+	{
+		mFrames = 0;
+	}
+
+	// the surface around a touch that is starting or ending is changing fast.
+	if(touches.masks.on | touches.masks.off) return ready;
+
+	// touches spread over the whole height of the surface, so whole columns are skipped.
+	std::bitset<w> nearTouch;
+	forEachTouch(touches.masks.active, [&](int t)
+	{
+		float sx = keyToSensorX(touches.x[t]);
+		int left = std::max(static_cast<int>(floorf(sx - kTouchRadius)), 0);
+		int right = std::min(static_cast<int>(ceilf(sx + kTouchRadius)), w - 1);
+		for(int i=left; i<=right; ++i)
+		{
+			nearTouch.set(i);
+		}
+	});
+
+	const double a = mAlpha;
+	for(int j=0; j<h; ++j)
+	{
+		for(int i=0; i<w; ++i)
+		{
+			if(nearTouch[i]) continue;
+
+			int k = j*w + i;
+			double d = raw[k] - mMean[k];
+			double band = std::max(kQuietDeviations*kQuietDeviations*mVariance[k], kQuietFraction*kQuietFraction*mMean[k]*mMean[k]);
+			if(d*d > band) continue;
+
+			mMean[k] += a*d;
+			mVariance[k] = (1. - a)*(mVariance[k] + a*d*d);
+		}
+	}
+	return ready;
+}
+
+SensorFrame BaselineTracker::getMean() const
+{
+	SensorFrame mean;
+	for(int i=0; i<kTaxels; ++i)
+	{
+		mean[i] = static_cast<float>(mMean[i]);
+	}
+	return mean;
+}
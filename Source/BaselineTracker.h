@@ -0,0 +1,54 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+
+#include "SensorFrame.h"
+#include "TouchFrame.h"
+
+// Follows slow drift in the resting value of each taxel while the surface is played.
+// Starting from a calibration, the mean and variance of each taxel are updated by
+// exponentially weighted averages of the raw frames, but only where the taxel is
+// confidently untouched: away from every active touch, and near its mean. Frames in
+// which touches start or end are skipped. Sudden changes bigger than the noise are
+// never followed, so they still need a full calibration.
+
+class BaselineTracker
+{
+public:
+	BaselineTracker() {}
+	~BaselineTracker() {}
+
+	void setSampleRate(float sr);
+
+	// time constant of the averages in seconds.
+	void setTimeConstant(float seconds);
+
+	// start from the statistics of a calibration.
+	void reset(const SensorFrame& mean, const SensorFrame& stdDev);
+
+	// update from one raw frame and the touches found in it. Returns true about once
+	// a second, when the mean should be put to use.
+	bool process(const SensorFrame& raw, const TouchFrame& touches);
+
+	SensorFrame getMean() const;
+
+private:
+	static constexpr int kTaxels = SensorGeometry::width*SensorGeometry::height;
+
+	void updateCoeffs();
+
+	float mSampleRate{1000.f};
+	float mTimeConstant{20.f};
+	double mAlpha{0.};
+	int mUpdateInterval{1000};
+	int mFrames{0};
+
+	// in double, because the change per frame is far below float precision.
+	std::array< double, kTaxels > mMean{};
+	std::array< double, kTaxels > mVariance{};
+};
@@ -0,0 +1,116 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "CalibrationStore.h"
+
+#include "MLDebug.h"
+
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	const uint32_t kCalibrationMagic = 0x53504341; // 'SPCA'
+
+	// increment when the file format changes.
+	const uint32_t kCalibrationVersion = 1;
+
+	std::vector< uint8_t > carrierBytes(const SoundplaneDriver::Carriers& carriers)
+	{
+		std::vector< uint8_t > bytes;
+		for(auto c : carriers)
+		{
+			bytes.push_back(static_cast<uint8_t>(c));
+		}
+		return bytes;
+	}
+
+	// FNV-1a, to name the file for a set of carriers.
+	uint32_t hashCarriers(const std::vector< uint8_t >& bytes)
+	{
+		uint32_t h = 2166136261u;
+		for(uint8_t b : bytes)
+		{
+			h = (h ^ b)*16777619u;
+		}
+		return h;
+	}
+}
+
+CalibrationStore::CalibrationStore(const File& directory) :
+	mDirectory(directory)
+{
+}
+
+CalibrationStore::~CalibrationStore()
+{
+}
+
+File CalibrationStore::getFile(uint32_t serial, const SoundplaneDriver::Carriers& carriers) const
+{
+	String name = String(serial) + "-" + String::toHexString(static_cast<int>(hashCarriers(carrierBytes(carriers)))) + ".cal";
+	return mDirectory.getChildFile(name);
+}
+
+bool CalibrationStore::load(uint32_t serial, const SoundplaneDriver::Carriers& carriers, SensorFrame& mean, SensorFrame& stdDev) const
+{
+	File file = getFile(serial, carriers);
+	std::ifstream in(file.getFullPathName().toUTF8(), std::ios::binary);
+	if(!in) return false;
+
+	uint32_t magic, version, fileSerial, carrierCount, taxels;
+	if(!in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) || (magic != kCalibrationMagic)) return false;
+	if(!in.read(reinterpret_cast<char*>(&version), sizeof(version)) || (version != kCalibrationVersion)) return false;
+	if(!in.read(reinterpret_cast<char*>(&fileSerial), sizeof(fileSerial)) || (fileSerial != serial)) return false;
+
+	// the file name is only a hash, so check the carriers themselves.
+	std::vector< uint8_t > expected = carrierBytes(carriers);
+	if(!in.read(reinterpret_cast<char*>(&carrierCount), sizeof(carrierCount)) || (carrierCount != expected.size())) return false;
+	std::vector< uint8_t > fileCarriers(carrierCount);
+	if(!in.read(reinterpret_cast<char*>(fileCarriers.data()), carrierCount) || (fileCarriers != expected)) return false;
+
+	if(!in.read(reinterpret_cast<char*>(&taxels), sizeof(taxels)) || (taxels != mean.size())) return false;
+	SensorFrame fileMean, fileStdDev;
+	if(!in.read(reinterpret_cast<char*>(fileMean.data()), taxels*sizeof(float))) return false;
+	if(!in.read(reinterpret_cast<char*>(fileStdDev.data()), taxels*sizeof(float))) return false;
+
+	mean = fileMean;
+	stdDev = fileStdDev;
+	return true;
+}
+
+bool CalibrationStore::save(uint32_t serial, const SoundplaneDriver::Carriers& carriers, const SensorFrame& mean, const SensorFrame& stdDev) const
+{
+	if(!mDirectory.isDirectory() && !mDirectory.createDirectory().wasOk())
+	{
+		MLConsole() << "CalibrationStore: could not create " << mDirectory.getFullPathName().toUTF8() << "\n";
+		return false;
+	}
+
+	// write to a temporary file and move it into place, so a calibration is never half written.
+	File file = getFile(serial, carriers);
+	File tempFile = file.getSiblingFile(file.getFileName() + ".tmp");
+	{
+		std::ofstream out(tempFile.getFullPathName().toUTF8(), std::ios::binary | std::ios::trunc);
+		if(!out)
+		{
+			MLConsole() << "CalibrationStore: could not write " << file.getFullPathName().toUTF8() << "\n";
+			return false;
+		}
+		std::vector< uint8_t > bytes = carrierBytes(carriers);
+		uint32_t carrierCount = bytes.size();
+		uint32_t taxels = mean.size();
+		out.write(reinterpret_cast<const char*>(&kCalibrationMagic), sizeof(kCalibrationMagic));
+		out.write(reinterpret_cast<const char*>(&kCalibrationVersion), sizeof(kCalibrationVersion));
+		out.write(reinterpret_cast<const char*>(&serial), sizeof(serial));
+		out.write(reinterpret_cast<const char*>(&carrierCount), sizeof(carrierCount));
+		out.write(reinterpret_cast<const char*>(bytes.data()), carrierCount);
+		out.write(reinterpret_cast<const char*>(&taxels), sizeof(taxels));
+		out.write(reinterpret_cast<const char*>(mean.data()), taxels*sizeof(float));
+		out.write(reinterpret_cast<const char*>(stdDev.data()), taxels*sizeof(float));
+		if(!out) return false;
+	}
+	return tempFile.moveFileTo(file);
+}
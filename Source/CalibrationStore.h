@@ -0,0 +1,35 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <stdint.h>
+
+#include "JuceHeader.h"
+#include "SensorFrame.h"
+#include "SoundplaneDriver.h"
+
+// The calibrations made on this computer, one file per device and set of carriers, so
+// that a Soundplane can play as soon as it is connected. The resting values of a
+// surface change with the carriers, so a calibration is only found for the carriers
+// it was made with.
+
+class CalibrationStore
+{
+public:
+	CalibrationStore(const File& directory);
+	~CalibrationStore();
+
+	// read the calibration saved for the device and carriers. Returns false if there is none.
+	bool load(uint32_t serial, const SoundplaneDriver::Carriers& carriers, SensorFrame& mean, SensorFrame& stdDev) const;
+
+	// write the calibration, replacing any saved for the device and carriers.
+	bool save(uint32_t serial, const SoundplaneDriver::Carriers& carriers, const SensorFrame& mean, const SensorFrame& stdDev) const;
+
+private:
+	File getFile(uint32_t serial, const SoundplaneDriver::Carriers& carriers) const;
+
+	File mDirectory;
+};
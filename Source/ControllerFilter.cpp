@@ -0,0 +1,68 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "ControllerFilter.h"
+
+#include <cmath>
+
+void ControllerFilter::setSampleRate(float sr)
+{
+	if(sr <= 0.f) return;
+	mSampleRate = sr;
+	updateCoeffs();
+}
+
+void ControllerFilter::setSmoothTime(float ms)
+{
+	mSmoothTime = (ms > 0.f) ? ms : 0.f;
+	updateCoeffs();
+}
+
+void ControllerFilter::setSlewRate(float rangesPerSecond)
+{
+	mSlewRate = (rangesPerSecond > 0.f) ? rangesPerSecond : 0.f;
+	updateCoeffs();
+}
+
+void ControllerFilter::updateCoeffs()
+{
+	mSmoothCoeff = (mSmoothTime > 0.f) ? (1.f - expf(-1000.f/(mSmoothTime*mSampleRate))) : 1.f;
+	mMaxDelta = mSlewRate/mSampleRate;
+}
+
+void ControllerFilter::reset(float x)
+{
+	mSmoothed = mSlewed = mHeld = x;
+}
+
+float ControllerFilter::process(float x)
+{
+	// finish the approach once the lowpass is within half a step of its input.
+	mSmoothed += (x - mSmoothed)*mSmoothCoeff;
+	if(fabsf(x - mSmoothed) < 0.5f/kMaxStep)
+	{
+		mSmoothed = x;
+	}
+
+	float d = mSmoothed - mSlewed;
+	if(mMaxDelta > 0.f)
+	{
+		d = (d > mMaxDelta) ? mMaxDelta : ((d < -mMaxDelta) ? -mMaxDelta : d);
+	}
+	mSlewed += d;
+
+	// the ends of the range always get through, so a controller can be set fully on or off.
+	if((fabsf(mSlewed - mHeld) > mDeadband) || (mSlewed <= 0.f) || (mSlewed >= 1.f))
+	{
+		mHeld = mSlewed;
+	}
+	return toStep(mHeld)/static_cast<float>(kMaxStep);
+}
+
+int ControllerFilter::toStep(float x)
+{
+	x = (x < 0.f) ? 0.f : ((x > 1.f) ? 1.f : x);
+	return static_cast<int>(lroundf(x*kMaxStep));
+}
@@ -0,0 +1,54 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+// Shapes one controller value from a zone on its way to the outputs. The value is
+// smoothed by a one-pole lowpass, its rate of change is limited, and then it is held
+// until it moves more than the dead-band from the value last put out. The output is
+// quantized to 14 bits, so outputs can detect a change by comparing values exactly.
+
+class ControllerFilter
+{
+public:
+	static const int kMaxStep = 16383;
+
+	ControllerFilter() {}
+	~ControllerFilter() {}
+
+	void setSampleRate(float sr);
+
+	// time constant of the lowpass in milliseconds, or 0 for none.
+	void setSmoothTime(float ms);
+
+	// the most the value can change per second, in full ranges, or 0 for no limit.
+	void setSlewRate(float rangesPerSecond);
+
+	// in steps of 1/128, like the thinning thresholds.
+	void setDeadband(float steps) { mDeadband = steps/128.f; }
+
+	// jump to the value x.
+	void reset(float x);
+
+	// filter the value x over [0, 1] for one frame and return the output value.
+	float process(float x);
+
+	// the 14-bit step of a value over [0, 1].
+	static int toStep(float x);
+
+private:
+	void updateCoeffs();
+
+	float mSampleRate{1000.f};
+	float mSmoothTime{0.f};
+	float mSlewRate{0.f};
+	float mSmoothCoeff{1.f};
+	float mMaxDelta{0.f};
+	float mDeadband{0.f};
+
+	float mSmoothed{0.f};
+	float mSlewed{0.f};
+	float mHeld{0.f};
+};
@@ -0,0 +1,93 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "LatencyHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+LatencyHistogram::LatencyHistogram()
+{
+	clear();
+}
+
+// values below kSubBuckets get one bucket each. Above that, the bucket is found from the
+// position of the highest set bit and the kSubBucketBits bits below it.
+int LatencyHistogram::valueToBucket(uint32_t v)
+{
+	if(v < kSubBuckets) return v;
+	int msb = 31 - __builtin_clz(v);
+	int shift = msb - kSubBucketBits;
+	int sub = (v >> shift) & (kSubBuckets - 1);
+	return (shift + 1)*kSubBuckets + sub;
+}
+
+uint32_t LatencyHistogram::bucketToHighestValue(int b)
+{
+	if(b < kSubBuckets) return b;
+	int shift = b/kSubBuckets - 1;
+	int sub = b%kSubBuckets;
+	uint32_t lowest = (uint32_t)(kSubBuckets + sub) << shift;
+	return lowest + (1u << shift) - 1;
+}
+
+void LatencyHistogram::record(uint32_t micros)
+{
+	uint32_t v = (micros > kMaxValue) ? kMaxValue : micros;
+	mBuckets[valueToBucket(v)].fetch_add(1, std::memory_order_relaxed);
+	mCount.fetch_add(1, std::memory_order_relaxed);
+	mSum.fetch_add(v, std::memory_order_relaxed);
+	
+	// only the process thread records, so a load and store is enough to keep the max.
+	if(v > mMax.load(std::memory_order_relaxed))
+	{
+		mMax.store(v, std::memory_order_relaxed);
+	}
+}
+
+// clearing while another thread records may lose a few counts, which is fine for statistics.
+void LatencyHistogram::clear()
+{
+	for(auto& b : mBuckets)
+	{
+		b.store(0, std::memory_order_relaxed);
+	}
+	mCount.store(0, std::memory_order_relaxed);
+	mSum.store(0, std::memory_order_relaxed);
+	mMax.store(0, std::memory_order_relaxed);
+}
+
+float LatencyHistogram::getMean() const
+{
+	uint64_t n = getCount();
+	if(!n) return 0.f;
+	return (float)mSum.load(std::memory_order_relaxed) / (float)n;
+}
+
+uint32_t LatencyHistogram::getPercentile(float p) const
+{
+	// count the buckets first, since the total may change while we are reading.
+	std::array<uint32_t, kNumBuckets> counts;
+	uint64_t total = 0;
+	for(int i=0; i<kNumBuckets; ++i)
+	{
+		counts[i] = mBuckets[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+	if(!total) return 0;
+	
+	p = std::min(std::max(p, 0.f), 100.f);
+	uint64_t target = std::max((uint64_t)1, (uint64_t)std::ceil(p*0.01f*total));
+	uint64_t sum = 0;
+	for(int i=0; i<kNumBuckets; ++i)
+	{
+		sum += counts[i];
+		if(sum >= target)
+		{
+			return std::min(bucketToHighestValue(i), getMax());
+		}
+	}
+	return getMax();
+}
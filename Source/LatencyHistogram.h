@@ -0,0 +1,50 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <stdint.h>
+
+// A histogram of durations in microseconds, bucketed in the manner of HDR histograms:
+// each power of two is split into kSubBuckets linear buckets, so any recorded value is
+// known to within 1/kSubBuckets of itself, over a range from 1 microsecond to 16 seconds.
+//
+// record() is lock-free and wait-free, so it can be called from the process thread
+// while the UI or other threads read statistics.
+
+class LatencyHistogram
+{
+public:
+	static constexpr int kSubBucketBits = 3;
+	static constexpr int kSubBuckets = 1 << kSubBucketBits;
+	static constexpr int kMaxValueBits = 24;
+	static constexpr uint32_t kMaxValue = (1u << kMaxValueBits) - 1;
+	static constexpr int kNumBuckets = (kMaxValueBits - kSubBucketBits + 1)*kSubBuckets;
+	
+	LatencyHistogram();
+	~LatencyHistogram() {}
+	
+	void record(uint32_t micros);
+	void clear();
+	
+	uint64_t getCount() const { return mCount.load(std::memory_order_relaxed); }
+	uint32_t getMax() const { return mMax.load(std::memory_order_relaxed); }
+	float getMean() const;
+	
+	// get the value at percentile p in [0, 100]. The result is the highest value
+	// equivalent to the bucket the percentile falls in.
+	uint32_t getPercentile(float p) const;
+	
+private:
+	static int valueToBucket(uint32_t v);
+	static uint32_t bucketToHighestValue(int b);
+	
+	std::array< std::atomic<uint32_t>, kNumBuckets > mBuckets;
+	std::atomic<uint64_t> mCount{0};
+	std::atomic<uint64_t> mSum{0};
+	std::atomic<uint32_t> mMax{0};
+};
@@ -0,0 +1,110 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "MIDIFrameScheduler.h"
+
+MIDIFrameScheduler::MIDIFrameScheduler()
+{
+	mSendBuffer.ensureSize(kMaxFrameBytes*2);
+}
+
+MIDIFrameScheduler::~MIDIFrameScheduler()
+{
+	stop();
+}
+
+void MIDIFrameScheduler::start(juce::MidiOutput* pDevice)
+{
+	stop();
+	if(!pDevice) return;
+
+	// the send thread is stopped, so it is safe to drop old frames from the reading end.
+	mReadIdx.store(mWriteIdx.load(std::memory_order_acquire), std::memory_order_release);
+	mpDevice = pDevice;
+	mRunning.store(true, std::memory_order_release);
+	mThread = std::thread(&MIDIFrameScheduler::run, this);
+}
+
+void MIDIFrameScheduler::stop()
+{
+	mRunning.store(false, std::memory_order_release);
+	if(mThread.joinable())
+	{
+		mThread.join();
+	}
+	mpDevice = nullptr;
+}
+
+bool MIDIFrameScheduler::add(const juce::MidiBuffer& messages, steady_clock::time_point sendTime)
+{
+	uint32_t w = mWriteIdx.load(std::memory_order_relaxed);
+	if(w - mReadIdx.load(std::memory_order_acquire) >= kMaxFrames)
+	{
+		mDroppedFrames.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	Frame& frame = mFrames[w % kMaxFrames];
+	int numBytes = 0;
+	juce::MidiBuffer::Iterator it(messages);
+	const uint8* data;
+	int size, position;
+	while(it.getNextEvent(data, size, position))
+	{
+		if((size > 255) || (numBytes + 1 + size > kMaxFrameBytes))
+		{
+			mDroppedFrames.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		frame.bytes[numBytes++] = static_cast<uint8_t>(size);
+		std::copy(data, data + size, frame.bytes.begin() + numBytes);
+		numBytes += size;
+	}
+	frame.numBytes = numBytes;
+	frame.sendTime = sendTime;
+	mWriteIdx.store(w + 1, std::memory_order_release);
+	return true;
+}
+
+// once stopping, the frames still queued are sent without waiting for their times.
+void MIDIFrameScheduler::run()
+{
+	while(true)
+	{
+		bool running = mRunning.load(std::memory_order_acquire);
+		uint32_t r = mReadIdx.load(std::memory_order_relaxed);
+		if(r == mWriteIdx.load(std::memory_order_acquire))
+		{
+			if(!running) break;
+			std::this_thread::sleep_for(microseconds(mPollInterval.load(std::memory_order_relaxed)));
+			continue;
+		}
+
+		const Frame& frame = mFrames[r % kMaxFrames];
+		if(running)
+		{
+			std::this_thread::sleep_until(frame.sendTime);
+		}
+		sendFrame(frame);
+		mReadIdx.store(r + 1, std::memory_order_release);
+	}
+}
+
+void MIDIFrameScheduler::sendFrame(const Frame& frame)
+{
+	mSendBuffer.clear();
+	int i = 0;
+	int position = 0;
+	while(i < frame.numBytes)
+	{
+		int size = frame.bytes[i++];
+		mSendBuffer.addEvent(frame.bytes.data() + i, size, position++);
+		i += size;
+	}
+	if(!mSendBuffer.isEmpty())
+	{
+		mpDevice->sendBlockOfMessagesNow(mSendBuffer);
+	}
+}
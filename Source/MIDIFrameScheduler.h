@@ -0,0 +1,86 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <thread>
+
+#include "JuceHeader.h"
+
+using namespace std::chrono;
+
+// Sends blocks of MIDI messages to a device at given times, from a thread of its own.
+// The process thread copies each frame's messages into a preallocated queue with add(),
+// which does not allocate or lock, and the send thread waits until each frame's time
+// and sends it in one block. Frames are sent in the order they were added.
+//
+// The send thread runs from start() to stop(), and sends to the device given to start().
+
+class MIDIFrameScheduler
+{
+public:
+	// enough to hold a few frames of delay with room for the send thread to fall behind.
+	static constexpr int kMaxFrames = 64;
+
+	// room for the messages of one frame, as in the output's frame buffer.
+	static constexpr int kMaxFrameBytes = 4096;
+
+	MIDIFrameScheduler();
+	~MIDIFrameScheduler();
+
+	// start sending to the device. Frames left in the queue from before are dropped.
+	void start(juce::MidiOutput* pDevice);
+
+	// send the frames still queued at once, then stop the send thread.
+	void stop();
+
+	bool isRunning() const { return mRunning.load(std::memory_order_acquire); }
+
+	// how often the send thread looks for new frames when the queue is empty. A frame
+	// added to an empty queue can be sent up to this late.
+	void setPollInterval(microseconds t) { mPollInterval.store(t.count(), std::memory_order_relaxed); }
+
+	// true if every frame added has been sent. Called from the process thread.
+	bool isEmpty() const { return mReadIdx.load(std::memory_order_acquire) == mWriteIdx.load(std::memory_order_relaxed); }
+
+	// queue the messages to be sent at sendTime. Called from the process thread.
+	// Returns false if the queue is full or the frame is too big, and the frame is dropped.
+	bool add(const juce::MidiBuffer& messages, steady_clock::time_point sendTime);
+
+	// the number of frames dropped since the last call.
+	int getDroppedFrames() { return mDroppedFrames.exchange(0, std::memory_order_relaxed); }
+
+private:
+	// messages are stored back to back, each a length byte followed by its data.
+	struct Frame
+	{
+		steady_clock::time_point sendTime{};
+		int numBytes{0};
+		std::array< uint8_t, kMaxFrameBytes > bytes{};
+	};
+
+	void run();
+	void sendFrame(const Frame& frame);
+
+	std::array< Frame, kMaxFrames > mFrames{};
+
+	// counts of frames added and sent. Only the process thread writes mWriteIdx and
+	// only the send thread writes mReadIdx.
+	std::atomic< uint32_t > mWriteIdx{0};
+	std::atomic< uint32_t > mReadIdx{0};
+
+	std::atomic< bool > mRunning{false};
+	std::atomic< int > mDroppedFrames{0};
+	std::atomic< int64_t > mPollInterval{2000};
+	std::thread mThread;
+	juce::MidiOutput* mpDevice{nullptr};
+
+	// used by the send thread to hand each frame to the device.
+	juce::MidiBuffer mSendBuffer;
+};
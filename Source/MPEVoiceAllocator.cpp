@@ -0,0 +1,202 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "MPEVoiceAllocator.h"
+
+MPEVoiceAllocator::MPEVoiceAllocator()
+{
+	mMemberChannels[kLowerZone] = 15;
+	mMemberChannels[kUpperZone] = 0;
+	clear();
+}
+
+void MPEVoiceAllocator::setZones(int lowerChannels, int upperChannels)
+{
+	int lower = (lowerChannels < 0) ? 0 : ((lowerChannels > 15) ? 15 : lowerChannels);
+	int maxUpper = (lower == 15) ? 0 : ((lower > 0) ? (14 - lower) : 15);
+	int upper = (upperChannels < 0) ? 0 : ((upperChannels > maxUpper) ? maxUpper : upperChannels);
+	mMemberChannels[kLowerZone] = lower;
+	mMemberChannels[kUpperZone] = upper;
+	clear();
+}
+
+void MPEVoiceAllocator::setSingleChannel(int c)
+{
+	mSingleChannel = (c < 0) ? 0 : ((c > 16) ? 16 : c);
+	clear();
+}
+
+int MPEVoiceAllocator::noteOn(int v, int zone, int& stolenVoice)
+{
+	stolenVoice = -1;
+	if((v < 0) || (v >= kMaxVoices)) return 0;
+	if(mVoiceZone[v] >= 0)
+	{
+		noteOff(v);
+	}
+
+	if(mSingleChannel)
+	{
+		mVoiceChannel[v] = mSingleChannel;
+		addActiveVoice(v, kLowerZone);
+		return mSingleChannel;
+	}
+
+	// if the requested zone has no channels, play in the other one.
+	zone = (zone == kUpperZone) ? kUpperZone : kLowerZone;
+	if(!mMemberChannels[zone])
+	{
+		zone = 1 - zone;
+	}
+	int c = popFreeChannel(zone);
+	if(!c)
+	{
+		int s = findVoiceToSteal(zone);
+		if(s < 0) return 0;
+		c = mVoiceChannel[s];
+		removeActiveVoice(s);
+		mVoiceChannel[s] = 0;
+		stolenVoice = s;
+	}
+
+	mVoiceChannel[v] = c;
+	addActiveVoice(v, zone);
+	return c;
+}
+
+void MPEVoiceAllocator::noteOff(int v)
+{
+	if((v < 0) || (v >= kMaxVoices)) return;
+	int zone = mVoiceZone[v];
+	if(zone < 0) return;
+
+	removeActiveVoice(v);
+	if(!mSingleChannel && mVoiceChannel[v])
+	{
+		pushFreeChannel(zone, mVoiceChannel[v]);
+	}
+	mVoiceChannel[v] = 0;
+}
+
+int MPEVoiceAllocator::getMostRecentVoice() const
+{
+	int a = mNewestVoice[kLowerZone];
+	int b = mNewestVoice[kUpperZone];
+	if(a < 0) return b;
+	if(b < 0) return a;
+
+	// compare start counts allowing for wraparound.
+	return (static_cast<int32_t>(mVoiceStartCount[a] - mVoiceStartCount[b]) > 0) ? a : b;
+}
+
+void MPEVoiceAllocator::clear()
+{
+	mPrevVoice.fill(-1);
+	mNextVoice.fill(-1);
+	mOldestVoice.fill(-1);
+	mNewestVoice.fill(-1);
+	mVoiceZone.fill(-1);
+	mVoiceChannel.fill(0);
+	mVoiceStartCount.fill(0);
+	mLevel.fill(0.f);
+
+	mFreeStart.fill(0);
+	mFreeCount.fill(0);
+	for(int zone=0; zone<kNumZones; ++zone)
+	{
+		int first = getFirstMemberChannel(zone);
+		int dir = (zone == kUpperZone) ? -1 : 1;
+		for(int i=0; i<mMemberChannels[zone]; ++i)
+		{
+			pushFreeChannel(zone, first + i*dir);
+		}
+	}
+}
+
+int MPEVoiceAllocator::findVoiceToSteal(int zone) const
+{
+	switch(mStealMode)
+	{
+		case kStealNone:
+		default:
+			return -1;
+
+		case kStealOldest:
+			return mOldestVoice[zone];
+
+		case kStealQuietest:
+		{
+			int quietest = -1;
+			for(int v = mOldestVoice[zone]; v >= 0; v = mNextVoice[v])
+			{
+				if((quietest < 0) || (mLevel[v] < mLevel[quietest]))
+				{
+					quietest = v;
+				}
+			}
+			return quietest;
+		}
+	}
+}
+
+void MPEVoiceAllocator::addActiveVoice(int v, int zone)
+{
+	int newest = mNewestVoice[zone];
+	mVoiceZone[v] = zone;
+	mPrevVoice[v] = newest;
+	mNextVoice[v] = -1;
+	if(newest >= 0)
+	{
+		mNextVoice[newest] = v;
+	}
+	else
+	{
+		mOldestVoice[zone] = v;
+	}
+	mNewestVoice[zone] = v;
+	mVoiceStartCount[v] = ++mStartCount;
+}
+
+void MPEVoiceAllocator::removeActiveVoice(int v)
+{
+	int zone = mVoiceZone[v];
+	int prev = mPrevVoice[v];
+	int next = mNextVoice[v];
+	if(prev >= 0)
+	{
+		mNextVoice[prev] = next;
+	}
+	else
+	{
+		mOldestVoice[zone] = next;
+	}
+	if(next >= 0)
+	{
+		mPrevVoice[next] = prev;
+	}
+	else
+	{
+		mNewestVoice[zone] = prev;
+	}
+	mPrevVoice[v] = -1;
+	mNextVoice[v] = -1;
+	mVoiceZone[v] = -1;
+}
+
+void MPEVoiceAllocator::pushFreeChannel(int zone, int c)
+{
+	if(mFreeCount[zone] >= 16) return;
+	mFreeChannels[zone][(mFreeStart[zone] + mFreeCount[zone]) & 15] = c;
+	mFreeCount[zone]++;
+}
+
+int MPEVoiceAllocator::popFreeChannel(int zone)
+{
+	if(!mFreeCount[zone]) return 0;
+	int c = mFreeChannels[zone][mFreeStart[zone]];
+	mFreeStart[zone] = (mFreeStart[zone] + 1) & 15;
+	mFreeCount[zone]--;
+	return c;
+}
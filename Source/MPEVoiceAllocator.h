@@ -0,0 +1,111 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <stdint.h>
+
+// Assigns MIDI channels to voices for MPE output.
+//
+// The lower MPE zone has manager channel 1 and member channels counting up from 2.
+// The upper zone has manager channel 16 and member channels counting down from 15.
+// Each zone keeps its free member channels in the order they were released, and a
+// new note gets the channel released longest ago, so that it does not land on a
+// channel where the release of an earlier note may still be sounding.
+//
+// When a zone has no free channel, a sounding voice in that zone can be stolen,
+// either the oldest or the quietest one. The caller must end the stolen voice's note
+// before the new note starts.
+//
+// In single channel mode all voices share one channel and nothing is stolen. Voices
+// are still tracked, so that the most recent voice is known in either mode.
+//
+// All operations except stealing the quietest voice are O(1).
+
+class MPEVoiceAllocator
+{
+public:
+	static constexpr int kMaxVoices = 16;
+
+	enum Zone
+	{
+		kLowerZone = 0,
+		kUpperZone,
+		kNumZones
+	};
+
+	enum StealMode
+	{
+		kStealNone = 0,
+		kStealOldest,
+		kStealQuietest
+	};
+
+	MPEVoiceAllocator();
+	~MPEVoiceAllocator() {}
+
+	// set the number of member channels in each zone. The lower zone can have up to
+	// 15. If both zones are used they share the 14 channels between their managers.
+	// This ends all voices.
+	void setZones(int lowerChannels, int upperChannels);
+
+	// use channel c for every voice, or return to MPE zones if c is 0. This ends all voices.
+	void setSingleChannel(int c);
+
+	void setStealMode(StealMode m) { mStealMode = m; }
+
+	int getMemberChannels(int zone) const { return mMemberChannels[zone]; }
+	int getManagerChannel(int zone) const { return (zone == kUpperZone) ? 16 : 1; }
+	int getFirstMemberChannel(int zone) const { return (zone == kUpperZone) ? 15 : 2; }
+
+	// start voice v in the given zone, or in the other zone if the given one has no
+	// channels. Return the voice's channel, or 0 if no channel is free and nothing
+	// could be stolen. If a voice was stolen its index is written to stolenVoice,
+	// otherwise -1.
+	int noteOn(int v, int zone, int& stolenVoice);
+
+	// end voice v and release its channel.
+	void noteOff(int v);
+
+	// the level of each voice, used to find the quietest voice to steal.
+	void setLevel(int v, float z) { mLevel[v] = z; }
+
+	int getChannel(int v) const { return mVoiceChannel[v]; }
+
+	// the voice started most recently that is still sounding, or -1.
+	int getMostRecentVoice() const;
+
+	// end all voices.
+	void clear();
+
+private:
+	int findVoiceToSteal(int zone) const;
+	void addActiveVoice(int v, int zone);
+	void removeActiveVoice(int v);
+	void pushFreeChannel(int zone, int c);
+	int popFreeChannel(int zone);
+
+	// sounding voices in each zone as linked lists, oldest first.
+	std::array< int8_t, kMaxVoices > mPrevVoice;
+	std::array< int8_t, kMaxVoices > mNextVoice;
+	std::array< int8_t, kNumZones > mOldestVoice;
+	std::array< int8_t, kNumZones > mNewestVoice;
+
+	std::array< int8_t, kMaxVoices > mVoiceZone;
+	std::array< int8_t, kMaxVoices > mVoiceChannel;
+	std::array< uint32_t, kMaxVoices > mVoiceStartCount;
+	std::array< float, kMaxVoices > mLevel;
+	uint32_t mStartCount{0};
+
+	// free member channels in each zone as ring buffers, least recently released first.
+	std::array< std::array< int8_t, 16 >, kNumZones > mFreeChannels;
+	std::array< int, kNumZones > mFreeStart;
+	std::array< int, kNumZones > mFreeCount;
+
+	std::array< int, kNumZones > mMemberChannels;
+	int mSingleChannel{0};
+	StealMode mStealMode{kStealOldest};
+};
@@ -0,0 +1,305 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "MatrixStream.h"
+
+#include <cstring>
+
+// --------------------------------------------------------------------------------
+// float16 conversion, rounding to nearest even.
+
+uint16_t MatrixStream::floatToHalf(float f)
+{
+	uint32_t x;
+	std::memcpy(&x, &f, sizeof(x));
+	uint16_t sign = (x >> 16) & 0x8000;
+	uint32_t mantissa = x & 0x7FFFFF;
+	int exponent = (x >> 23) & 0xFF;
+
+	// infinity or NaN
+	if(exponent == 0xFF)
+	{
+		return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+	}
+
+	int e = exponent - 127 + 15;
+	if(e >= 31)
+	{
+		return sign | 0x7C00;
+	}
+
+	if(e <= 0)
+	{
+		// subnormal result, or too small for one.
+		if(e < -10) return sign;
+		mantissa |= 0x800000;
+		int shift = 14 - e;
+		uint32_t h = mantissa >> shift;
+		uint32_t rem = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if((rem > halfway) || ((rem == halfway) && (h & 1))) h++;
+		return sign | static_cast<uint16_t>(h);
+	}
+
+	// a carry out of the mantissa correctly increments the exponent.
+	uint32_t h = (static_cast<uint32_t>(e) << 10) | (mantissa >> 13);
+	uint32_t rem = mantissa & 0x1FFF;
+	if((rem > 0x1000) || ((rem == 0x1000) && (h & 1))) h++;
+	return sign | static_cast<uint16_t>(h);
+}
+
+float MatrixStream::halfToFloat(uint16_t h)
+{
+	uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+	int exponent = (h >> 10) & 0x1F;
+	uint32_t mantissa = h & 0x3FF;
+	uint32_t x;
+
+	if(exponent == 0)
+	{
+		if(mantissa == 0)
+		{
+			x = sign;
+		}
+		else
+		{
+			// normalize the subnormal value.
+			int e = 1;
+			while(!(mantissa & 0x400))
+			{
+				mantissa <<= 1;
+				e--;
+			}
+			mantissa &= 0x3FF;
+			x = sign | (static_cast<uint32_t>(e - 15 + 127) << 23) | (mantissa << 13);
+		}
+	}
+	else if(exponent == 0x1F)
+	{
+		x = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else
+	{
+		x = sign | (static_cast<uint32_t>(exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+
+	float f;
+	std::memcpy(&f, &x, sizeof(f));
+	return f;
+}
+
+namespace
+{
+	int tokenBytes(int format)
+	{
+		return (format == MatrixStream::kUInt8) ? 1 : 2;
+	}
+}
+
+// --------------------------------------------------------------------------------
+// MatrixStreamEncoder
+
+void MatrixStreamEncoder::setFormat(MatrixStream::Format f)
+{
+	if(f != mFormat)
+	{
+		mFormat = f;
+		mKeyframeRequested = true;
+	}
+}
+
+void MatrixStreamEncoder::setDecimation(int d)
+{
+	d = (d < 1) ? 1 : (d > MatrixStream::kMaxDecimation) ? MatrixStream::kMaxDecimation : d;
+	if(d != mDecimation)
+	{
+		mDecimation = d;
+		mKeyframeRequested = true;
+	}
+}
+
+bool MatrixStreamEncoder::encode(const float* data, int width, int height)
+{
+	const int d = mDecimation;
+	const int w = (width + d - 1)/d;
+	const int h = (height + d - 1)/d;
+	if((width < 1) || (height < 1) || (w*h > MatrixStream::kMaxCells)) return false;
+
+	if((w != mWidth) || (h != mHeight))
+	{
+		mWidth = w;
+		mHeight = h;
+		mKeyframeRequested = true;
+	}
+
+	// average each block and quantize. Negative values are only noise below the
+	// calibrated rest level, so they are clamped to zero, which also keeps runs long.
+	for(int j=0; j<h; ++j)
+	{
+		const int y0 = j*d;
+		const int y1 = (y0 + d < height) ? y0 + d : height;
+		for(int i=0; i<w; ++i)
+		{
+			const int x0 = i*d;
+			const int x1 = (x0 + d < width) ? x0 + d : width;
+			float sum = 0.f;
+			for(int y=y0; y<y1; ++y)
+			{
+				const float* row = data + y*width;
+				for(int x=x0; x<x1; ++x)
+				{
+					sum += row[x];
+				}
+			}
+			float v = sum/((y1 - y0)*(x1 - x0));
+			v = (v > 0.f) ? v : 0.f;
+
+			uint16_t code;
+			if(mFormat == MatrixStream::kUInt8)
+			{
+				code = static_cast<uint16_t>(((v < 1.f) ? v : 1.f)*255.f + 0.5f);
+			}
+			else
+			{
+				code = MatrixStream::floatToHalf(v);
+			}
+			mCodes[j*w + i] = code;
+		}
+	}
+
+	bool keyframe = mKeyframeRequested || (++mFramesSinceKeyframe >= mKeyframeInterval);
+	if(keyframe)
+	{
+		mKeyframeRequested = false;
+		mFramesSinceKeyframe = 0;
+	}
+
+	mPayloadSize = writeTokens(keyframe ? nullptr : mPrevCodes.data());
+	std::memcpy(mPrevCodes.data(), mCodes.data(), w*h*sizeof(uint16_t));
+
+	mSequence++;
+	mFlags = (keyframe ? MatrixStream::kFlagKeyframe : 0) | (mFormat << MatrixStream::kFormatShift);
+	return true;
+}
+
+// write the token stream for the difference between mCodes and prev, or zero if
+// prev is null. Returns the payload size in bytes.
+size_t MatrixStreamEncoder::writeTokens(const uint16_t* prev)
+{
+	const int n = mWidth*mHeight;
+	const int bytes = tokenBytes(mFormat);
+	const uint16_t mask = (bytes == 2) ? 0xFFFF : 0xFF;
+	uint8_t* p = mPayload.data();
+
+	auto put = [&](uint16_t t)
+	{
+		if(bytes == 2)
+		{
+			*p++ = static_cast<uint8_t>(t >> 8);
+		}
+		*p++ = static_cast<uint8_t>(t);
+	};
+
+	int i = 0;
+	while(i < n)
+	{
+		uint16_t delta = (mCodes[i] - (prev ? prev[i] : 0)) & mask;
+		if(delta)
+		{
+			put(delta);
+			i++;
+		}
+		else
+		{
+			int run = 1;
+			while((i + run < n) && (run < mask) && (mCodes[i + run] == (prev ? prev[i + run] : 0)))
+			{
+				run++;
+			}
+			put(0);
+			put(static_cast<uint16_t>(run));
+			i += run;
+		}
+	}
+	return p - mPayload.data();
+}
+
+// --------------------------------------------------------------------------------
+// MatrixStreamDecoder
+
+bool MatrixStreamDecoder::decode(int32_t sequence, int32_t flags, int width, int height, const uint8_t* payload, size_t size)
+{
+	const int format = (flags & MatrixStream::kFormatMask) >> MatrixStream::kFormatShift;
+	const int formatFlags = flags & MatrixStream::kFormatMask;
+	const int n = width*height;
+	if((format >= MatrixStream::kNumFormats) || (width < 1) || (height < 1) || (n > MatrixStream::kMaxCells))
+	{
+		mSynced = false;
+		return false;
+	}
+
+	const bool keyframe = flags & MatrixStream::kFlagKeyframe;
+	const bool inSequence = (static_cast<uint32_t>(sequence) == static_cast<uint32_t>(mSequence) + 1);
+	mSequence = sequence;
+	if(!keyframe)
+	{
+		if(!mSynced || !inSequence || (width != mWidth) || (height != mHeight) || (formatFlags != mFormatFlags))
+		{
+			mSynced = false;
+			return false;
+		}
+	}
+	else
+	{
+		mWidth = width;
+		mHeight = height;
+		mFormatFlags = formatFlags;
+		std::memset(mCodes.data(), 0, n*sizeof(uint16_t));
+	}
+
+	const int bytes = tokenBytes(format);
+	const uint16_t mask = (bytes == 2) ? 0xFFFF : 0xFF;
+	const uint8_t* p = payload;
+	const uint8_t* end = payload + size;
+
+	auto get = [&](uint16_t& t)
+	{
+		if(end - p < bytes) return false;
+		t = (bytes == 2) ? static_cast<uint16_t>((p[0] << 8) | p[1]) : p[0];
+		p += bytes;
+		return true;
+	};
+
+	int i = 0;
+	while(i < n)
+	{
+		uint16_t t;
+		if(!get(t)) break;
+		if(t)
+		{
+			mCodes[i] = (mCodes[i] + t) & mask;
+			i++;
+		}
+		else
+		{
+			uint16_t run;
+			if(!get(run) || (run == 0) || (i + run > n)) break;
+			i += run;
+		}
+	}
+
+	if((i != n) || (p != end))
+	{
+		mSynced = false;
+		return false;
+	}
+
+	for(int c=0; c<n; ++c)
+	{
+		mData[c] = (format == MatrixStream::kUInt8) ? mCodes[c]/255.f : MatrixStream::halfToFloat(mCodes[c]);
+	}
+	mSynced = true;
+	return true;
+}
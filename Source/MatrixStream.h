@@ -0,0 +1,116 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+// Compressed pressure images for the /t3d/mtx message. Each image is optionally
+// decimated by averaging square blocks of taxels, quantized to float16 or 8-bit codes,
+// and then sent either as a keyframe or as the difference from the previous image.
+//
+// Both kinds of frame use the same token stream, with a keyframe coded as the
+// difference from an image of all zero codes. Each token is one code wide, 2 bytes
+// for float16 and 1 byte for 8-bit, big-endian. A nonzero token is the difference,
+// modulo the code size, between the new and previous code for the next cell. A zero
+// token is followed by a count token, and means that many cells are unchanged.
+
+namespace MatrixStream
+{
+	enum Format
+	{
+		kFloat16 = 0,
+		kUInt8 = 1,
+		kNumFormats
+	};
+
+	// bits of the flags argument.
+	const int kFlagKeyframe = 1 << 0;
+	const int kFormatShift = 4;
+	const int kFormatMask = 0xF << kFormatShift;
+
+	const int kMaxCells = 1024;
+	const int kMaxDecimation = 8;
+
+	// worst case token stream: every other cell is an unchanged run of one.
+	const size_t kMaxPayloadSize = kMaxCells*2*2;
+
+	uint16_t floatToHalf(float f);
+	float halfToFloat(uint16_t h);
+}
+
+class MatrixStreamEncoder
+{
+public:
+	MatrixStreamEncoder() {}
+	~MatrixStreamEncoder() {}
+
+	// changing the format or decimation starts again with a keyframe.
+	void setFormat(MatrixStream::Format f);
+	void setDecimation(int d);
+
+	// send a keyframe at least this often, in frames.
+	void setKeyframeInterval(int frames) { mKeyframeInterval = frames > 1 ? frames : 1; }
+	void requestKeyframe() { mKeyframeRequested = true; }
+
+	// encode a width x height image stored in rows. Returns false if the decimated
+	// image would not fit in kMaxCells.
+	bool encode(const float* data, int width, int height);
+
+	// the most recently encoded frame.
+	int32_t getSequence() const { return static_cast<int32_t>(mSequence); }
+	int32_t getFlags() const { return mFlags; }
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+	const uint8_t* getPayload() const { return mPayload.data(); }
+	size_t getPayloadSize() const { return mPayloadSize; }
+
+private:
+	size_t writeTokens(const uint16_t* prev);
+
+	MatrixStream::Format mFormat{MatrixStream::kFloat16};
+	int mDecimation{1};
+	int mKeyframeInterval{100};
+	int mFramesSinceKeyframe{0};
+	bool mKeyframeRequested{true};
+
+	uint32_t mSequence{0xFFFFFFFF};
+	int32_t mFlags{0};
+	int mWidth{0};
+	int mHeight{0};
+
+	std::array< uint16_t, MatrixStream::kMaxCells > mCodes{};
+	std::array< uint16_t, MatrixStream::kMaxCells > mPrevCodes{};
+	std::array< uint8_t, MatrixStream::kMaxPayloadSize > mPayload{};
+	size_t mPayloadSize{0};
+};
+
+// Reference decoder for /t3d/mtx. After a missing sequence number or a change of size
+// or format, deltas are ignored until the next keyframe.
+class MatrixStreamDecoder
+{
+public:
+	MatrixStreamDecoder() {}
+	~MatrixStreamDecoder() {}
+
+	// returns true if the frame was decoded and getData() holds a new image.
+	bool decode(int32_t sequence, int32_t flags, int width, int height, const uint8_t* payload, size_t size);
+
+	const float* getData() const { return mData.data(); }
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+	bool isSynced() const { return mSynced; }
+
+private:
+	bool mSynced{false};
+	int32_t mSequence{0};
+	int32_t mFormatFlags{0};
+	int mWidth{0};
+	int mHeight{0};
+	std::array< uint16_t, MatrixStream::kMaxCells > mCodes{};
+	std::array< float, MatrixStream::kMaxCells > mData{};
+};
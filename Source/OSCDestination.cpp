@@ -0,0 +1,88 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "OSCDestination.h"
+
+#include <cstring>
+
+#include "cJSON.h"
+
+bool parseOSCDestinations(const std::string& json, std::vector< OSCDestination >& dests)
+{
+	dests.clear();
+	cJSON* root = cJSON_Parse(json.c_str());
+	if(!root) return false;
+	if(root->type != cJSON_Array)
+	{
+		cJSON_Delete(root);
+		return false;
+	}
+
+	for(cJSON* pNode = root->child; pNode; pNode = pNode->next)
+	{
+		cJSON* pHost = cJSON_GetObjectItem(pNode, "host");
+		if(!pHost || (pHost->type != cJSON_String)) continue;
+
+		OSCDestination d;
+		d.hostName = pHost->valuestring;
+
+		int basePort = kDefaultUDPPort;
+		cJSON* pPort = cJSON_GetObjectItem(pNode, "port");
+		if(pPort && (pPort->type == cJSON_Number))
+		{
+			basePort = pPort->valueint;
+		}
+		for(int i=0; i<kNumUDPPorts; ++i)
+		{
+			d.ports[i] = basePort + i;
+		}
+
+		cJSON* pPorts = cJSON_GetObjectItem(pNode, "ports");
+		if(pPorts && (pPorts->type == cJSON_Array))
+		{
+			d.ports.fill(0);
+			int n = cJSON_GetArraySize(pPorts);
+			for(int i=0; (i < n) && (i < kNumUDPPorts); ++i)
+			{
+				d.ports[i] = cJSON_GetArrayItem(pPorts, i)->valueint;
+			}
+		}
+
+		cJSON* pRate = cJSON_GetObjectItem(pNode, "rate");
+		if(pRate && (pRate->type == cJSON_Number))
+		{
+			d.dataRate = static_cast<float>(pRate->valuedouble);
+		}
+
+		cJSON* pProtocol = cJSON_GetObjectItem(pNode, "protocol");
+		if(pProtocol && (pProtocol->type == cJSON_String) && !strcmp(pProtocol->valuestring, "kyma"))
+		{
+			d.protocol = kOSCProtocolKyma;
+		}
+
+		cJSON* pTTL = cJSON_GetObjectItem(pNode, "ttl");
+		if(pTTL && (pTTL->type == cJSON_Number))
+		{
+			d.multicastTTL = pTTL->valueint;
+		}
+
+		cJSON* pInterface = cJSON_GetObjectItem(pNode, "interface");
+		if(pInterface && (pInterface->type == cJSON_String))
+		{
+			d.multicastInterface = pInterface->valuestring;
+		}
+
+		cJSON* pMatrix = cJSON_GetObjectItem(pNode, "matrix");
+		if(pMatrix)
+		{
+			d.sendMatrix = (pMatrix->type == cJSON_True) || ((pMatrix->type == cJSON_Number) && pMatrix->valueint);
+		}
+
+		dests.push_back(d);
+	}
+
+	cJSON_Delete(root);
+	return true;
+}
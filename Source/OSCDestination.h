@@ -0,0 +1,51 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "MLT3DPorts.h"
+
+enum OSCProtocol
+{
+	kOSCProtocolT3D = 0,
+	kOSCProtocolKyma
+};
+
+// One receiver of OSC output, in addition to the one chosen in the OSC service menu.
+struct OSCDestination
+{
+	std::string hostName{};
+
+	// the port for each zone offset, or 0 to send nothing for that offset.
+	std::array< int, kNumUDPPorts > ports{};
+
+	// frames per second, or 0 to send every output frame.
+	float dataRate{0.f};
+
+	int protocol{kOSCProtocolT3D};
+	int multicastTTL{1};
+	
+	// for multicast, the address of the interface to send from, or empty for the default.
+	// All multicast destinations are sent from one interface, the first one given.
+	std::string multicastInterface{};
+	
+	bool sendMatrix{false};
+};
+
+// Parse a list of destinations from JSON text such as:
+//
+// [ { "host": "localhost", "port": 3200, "rate": 60 },
+//   { "host": "239.1.2.3", "ports": [3300, 0, 3301], "ttl": 1, "interface": "127.0.0.1", "matrix": 1 },
+//   { "host": "beslime-123.local", "port": 8000, "protocol": "kyma" } ]
+//
+// "port" is the first of kNumUDPPorts consecutive ports, one for each zone offset, and
+// defaults to kDefaultUDPPort. "ports" lists the port for each offset instead.
+// Returns false and leaves dests empty if the text is not a list of destinations.
+// Entries without a host are skipped.
+bool parseOSCDestinations(const std::string& json, std::vector< OSCDestination >& dests);
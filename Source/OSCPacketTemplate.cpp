@@ -0,0 +1,104 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "OSCPacketTemplate.h"
+
+#include <cstdio>
+
+size_t OSCPacketTemplate::putString(char* dest, const char* str)
+{
+	size_t len = strlen(str);
+	size_t padded = paddedStringSize(len);
+	std::memcpy(dest, str, len);
+	std::memset(dest + len, 0, padded - len);
+	return padded;
+}
+
+// --------------------------------------------------------------------------------
+// T3DFrameTemplate
+
+T3DFrameTemplate::T3DFrameTemplate()
+{
+	using namespace OSCPacketTemplate;
+	mBuffer.fill(0);
+
+	// bundle header. The time tag is written by begin().
+	char* p = mBuffer.data();
+	p += putString(p, "#bundle");
+	p += 8;
+
+	// /t3d/frm (int)frameID (int)deviceID
+	putInt32(p, kFrameMessageSize);
+	p += 4;
+	p += putString(p, "/t3d/frm");
+	p += putString(p, ",ii");
+
+	// each touch message begins with its element size, address and type tags.
+	// addresses up to "/t3d/tch16" fit in 12 bytes.
+	for(int i=0; i<kMaxTouches; ++i)
+	{
+		char address[16];
+		snprintf(address, sizeof(address), "/t3d/tch%d", i + 1);
+		char* t = mTouchHeaders[i].data();
+		putInt32(t, kTouchMessageSize);
+		t += 4;
+		t += putString(t, address);
+		putString(t, ",ffff");
+	}
+
+	mSize = kHeaderSize;
+}
+
+void T3DFrameTemplate::begin(uint64_t timeTag, int32_t frameID, int32_t deviceID)
+{
+	using namespace OSCPacketTemplate;
+	char* p = mBuffer.data();
+	putUInt64(p + 8, timeTag);
+	putInt32(p + kHeaderSize - 8, frameID);
+	putInt32(p + kHeaderSize - 4, deviceID);
+	mSize = kHeaderSize;
+}
+
+void T3DFrameTemplate::addTouch(int voiceIdx, float x, float y, float z, float note)
+{
+	using namespace OSCPacketTemplate;
+	if(mSize + kTouchBlockSize > kMaxSize) return;
+	char* p = mBuffer.data() + mSize;
+	std::memcpy(p, mTouchHeaders[voiceIdx].data(), kTouchArgsOffset);
+	p += kTouchArgsOffset;
+	putFloat(p, x);
+	putFloat(p + 4, y);
+	putFloat(p + 8, z);
+	putFloat(p + 12, note);
+	mSize += kTouchBlockSize;
+}
+
+// --------------------------------------------------------------------------------
+// OSCMessageTemplate
+
+bool OSCMessageTemplate::build(const char* address, const char* typeTags)
+{
+	using namespace OSCPacketTemplate;
+	clear();
+	if(strlen(address) > kMaxAddressLength) return false;
+
+	char tags[kMaxArgs + 2];
+	snprintf(tags, sizeof(tags), ",%s", typeTags);
+	int args = strlen(tags) - 1;
+
+	char* p = mBuffer.data();
+	p += putString(p, address);
+	p += putString(p, tags);
+	mArgsOffset = p - mBuffer.data();
+	mSize = mArgsOffset + 4*args;
+	return true;
+}
+
+void OSCMessageTemplate::clear()
+{
+	mBuffer.fill(0);
+	mArgsOffset = 0;
+	mSize = 0;
+}
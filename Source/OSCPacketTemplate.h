@@ -0,0 +1,125 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Touch.h"
+
+// Prebuilt OSC packets for the messages sent every frame. The addresses, type tags
+// and bundle header are serialized once, and each frame only the argument slots are
+// written, in network byte order, at fixed offsets. This replaces building each
+// packet with osc::OutboundPacketStream, which formats every address and type tag
+// string again for every frame.
+
+namespace OSCPacketTemplate
+{
+	inline void putUInt32(char* dest, uint32_t v)
+	{
+		dest[0] = static_cast<char>(v >> 24);
+		dest[1] = static_cast<char>(v >> 16);
+		dest[2] = static_cast<char>(v >> 8);
+		dest[3] = static_cast<char>(v);
+	}
+
+	inline void putInt32(char* dest, int32_t v)
+	{
+		putUInt32(dest, static_cast<uint32_t>(v));
+	}
+
+	inline void putFloat(char* dest, float f)
+	{
+		uint32_t v;
+		std::memcpy(&v, &f, sizeof(v));
+		putUInt32(dest, v);
+	}
+
+	inline void putUInt64(char* dest, uint64_t v)
+	{
+		putUInt32(dest, static_cast<uint32_t>(v >> 32));
+		putUInt32(dest + 4, static_cast<uint32_t>(v));
+	}
+
+	// size of an OSC string including its terminator and padding.
+	inline size_t paddedStringSize(size_t length)
+	{
+		return (length + 4) & ~static_cast<size_t>(3);
+	}
+
+	// write an OSC string with its padding. Returns the number of bytes written.
+	size_t putString(char* dest, const char* str);
+}
+
+// A t3d frame bundle for one port: the bundle header and /t3d/frm message, followed
+// by one /t3d/tch message per active touch. Every touch message takes exactly
+// kTouchBlockSize bytes, including its element size.
+class T3DFrameTemplate
+{
+public:
+	static constexpr size_t kBundleHeaderSize = 16;
+	static constexpr size_t kFrameMessageSize = 24;
+	static constexpr size_t kHeaderSize = kBundleHeaderSize + 4 + kFrameMessageSize;
+	static constexpr size_t kTouchMessageSize = 36;
+	static constexpr size_t kTouchBlockSize = 4 + kTouchMessageSize;
+	static constexpr size_t kTouchArgsOffset = kTouchBlockSize - 16;
+	static constexpr size_t kMaxSize = kHeaderSize + kTouchBlockSize*kMaxTouches;
+
+	T3DFrameTemplate();
+	~T3DFrameTemplate() {}
+
+	// start a new frame, removing any touches.
+	void begin(uint64_t timeTag, int32_t frameID, int32_t deviceID);
+
+	// append /t3d/tch[voiceIdx + 1] x y z note.
+	void addTouch(int voiceIdx, float x, float y, float z, float note);
+
+	const char* getData() const { return mBuffer.data(); }
+	size_t getSize() const { return mSize; }
+	
+	// the touch messages only, without the bundle header and frame message.
+	const char* getTouchData() const { return mBuffer.data() + kHeaderSize; }
+	size_t getTouchSize() const { return mSize - kHeaderSize; }
+
+private:
+	std::array< char, kMaxSize > mBuffer;
+	std::array< std::array< char, kTouchArgsOffset >, kMaxTouches > mTouchHeaders;
+	size_t mSize;
+};
+
+// A single message with up to kMaxArgs int or float arguments and a fixed address,
+// rebuilt only when the address or argument types change.
+class OSCMessageTemplate
+{
+public:
+	static constexpr size_t kMaxAddressLength = 63;
+	static constexpr int kMaxArgs = 4;
+	static constexpr size_t kMaxSize = 64 + 8 + 4*kMaxArgs;
+
+	OSCMessageTemplate() { build("/", ""); }
+	~OSCMessageTemplate() {}
+
+	// typeTags are the argument types without the leading comma, such as "ff".
+	// If the address is longer than kMaxAddressLength, returns false and leaves the
+	// template empty, with a size of 0.
+	bool build(const char* address, const char* typeTags);
+
+	// make the template empty, with a size of 0.
+	void clear();
+
+	void setFloat(int arg, float f) { OSCPacketTemplate::putFloat(mBuffer.data() + mArgsOffset + 4*arg, f); }
+	void setInt(int arg, int32_t i) { OSCPacketTemplate::putInt32(mBuffer.data() + mArgsOffset + 4*arg, i); }
+
+	const char* getData() const { return mBuffer.data(); }
+	size_t getSize() const { return mSize; }
+
+private:
+	std::array< char, kMaxSize > mBuffer;
+	size_t mArgsOffset{0};
+	size_t mSize{0};
+};
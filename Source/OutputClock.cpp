@@ -0,0 +1,45 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "OutputClock.h"
+
+void OutputClock::setRate(float hz)
+{
+	if(hz <= 0.f) return;
+	mPendingRate.store(hz, std::memory_order_relaxed);
+}
+
+void OutputClock::applyPendingRate()
+{
+	float hz = mPendingRate.exchange(0.f, std::memory_order_relaxed);
+	if(hz <= 0.f) return;
+	mPeriod = duration_cast<steady_clock::duration>(duration<double>(1.0/hz));
+	if(mPeriod.count() <= 0)
+	{
+		mPeriod = steady_clock::duration(1);
+	}
+}
+
+void OutputClock::reset(time_point<steady_clock> t)
+{
+	mNext = t;
+	mStarted = true;
+}
+
+int OutputClock::tick(time_point<steady_clock> now, time_point<steady_clock>& boundary)
+{
+	applyPendingRate();
+	if(!mStarted)
+	{
+		reset(now);
+	}
+	if(now < mNext) return 0;
+
+	// skip to the latest boundary that has passed.
+	auto missed = (now - mNext)/mPeriod;
+	boundary = mNext + mPeriod*missed;
+	mNext = boundary + mPeriod;
+	return static_cast<int>(missed) + 1;
+}
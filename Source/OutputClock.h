@@ -0,0 +1,48 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+using namespace std::chrono;
+
+// Marks off output frame periods on the steady clock. Boundaries are at exact
+// multiples of the period from the first one, so frames scheduled on them stay
+// phase-locked however late each one is noticed. If the caller falls more than a
+// period behind, the missed boundaries are skipped.
+//
+// setRate() may be called from any thread. Everything else belongs to the thread that
+// calls tick().
+
+class OutputClock
+{
+public:
+	OutputClock() {}
+	~OutputClock() {}
+
+	// set the number of periods per second, taken up by the next tick(). The next
+	// boundary is unchanged.
+	void setRate(float hz);
+
+	// put the next boundary at time t.
+	void reset(time_point<steady_clock> t);
+
+	// return the number of boundaries passed at time now since the last tick, and if
+	// there are any, set boundary to the latest one. The first call starts the clock at now.
+	int tick(time_point<steady_clock> now, time_point<steady_clock>& boundary);
+
+	time_point<steady_clock> getNextBoundary() const { return mNext; }
+	steady_clock::duration getPeriod() const { return mPeriod; }
+
+private:
+	void applyPendingRate();
+
+	std::atomic<float> mPendingRate{0.f};
+	steady_clock::duration mPeriod{duration_cast<steady_clock::duration>(milliseconds(10))};
+	time_point<steady_clock> mNext{};
+	bool mStarted{false};
+};
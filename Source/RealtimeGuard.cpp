@@ -0,0 +1,271 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "RealtimeGuard.h"
+
+#include <array>
+#include <atomic>
+
+#if SOUNDPLANE_RT_GUARD
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <execinfo.h>
+#include <pthread.h>
+#include <unistd.h>
+#if defined(__GLIBC__)
+#include <dlfcn.h>
+#endif
+#endif
+
+namespace RealtimeGuard
+{
+	namespace
+	{
+		// plain thread_local bools, which can be read from inside the allocator
+		// without any initialization or allocation of their own.
+		thread_local bool tRealtime = false;
+		thread_local bool tAllowed = false;
+
+		std::atomic<uint64_t> gViolationCount{0};
+	}
+
+	RealtimeScope::RealtimeScope() : mPrevious(tRealtime)
+	{
+		tRealtime = true;
+	}
+
+	RealtimeScope::~RealtimeScope()
+	{
+		tRealtime = mPrevious;
+	}
+
+	AllowScope::AllowScope() : mPrevious(tAllowed)
+	{
+		tAllowed = true;
+	}
+
+	AllowScope::~AllowScope()
+	{
+		tAllowed = mPrevious;
+	}
+
+	uint64_t getViolationCount()
+	{
+		return gViolationCount.load(std::memory_order_relaxed);
+	}
+
+#if SOUNDPLANE_RT_GUARD
+
+	namespace
+	{
+		const bool gAbortOnViolation = (std::getenv("SOUNDPLANE_RT_GUARD_ABORT") != nullptr);
+
+		// call sites already reported, identified by a hash of the innermost return addresses.
+		const int kMaxSites = 256;
+		std::array< std::atomic<uint64_t>, kMaxSites > gReportedSites{};
+
+		bool isNewSite(uint64_t hash)
+		{
+			if(hash == 0) hash = 1;
+			for(int i=0; i<kMaxSites; ++i)
+			{
+				std::atomic<uint64_t>& site = gReportedSites[(hash + i) % kMaxSites];
+				uint64_t prev = site.load(std::memory_order_relaxed);
+				if(prev == hash) return false;
+				if(prev == 0)
+				{
+					if(site.compare_exchange_strong(prev, hash)) return true;
+					if(prev == hash) return false;
+				}
+			}
+
+			// table full: report everything.
+			return true;
+		}
+
+		void report(const char* what)
+		{
+			const int kMaxFrames = 32;
+			const int kSiteFrames = 6;
+			void* frames[kMaxFrames];
+			int n = backtrace(frames, kMaxFrames);
+
+			// skip our own frames when identifying the site.
+			uint64_t hash = 14695981039346656037ull;
+			for(int i = 2; (i < n) && (i < kSiteFrames + 2); ++i)
+			{
+				hash = (hash ^ reinterpret_cast<uintptr_t>(frames[i]))*1099511628211ull;
+			}
+
+			if(gAbortOnViolation || isNewSite(hash))
+			{
+				char buf[128];
+				int len = snprintf(buf, sizeof(buf), "realtime violation: %s on realtime thread\n", what);
+				if(len > 0)
+				{
+					ssize_t r = write(STDERR_FILENO, buf, (len < (int)sizeof(buf)) ? len : sizeof(buf) - 1);
+					(void)r;
+				}
+				backtrace_symbols_fd(frames, n, STDERR_FILENO);
+			}
+
+			if(gAbortOnViolation)
+			{
+				abort();
+			}
+		}
+	}
+
+	// called from the interposed functions. tAllowed doubles as a reentrancy guard,
+	// because reporting may itself allocate.
+	void check(const char* what)
+	{
+		if(tRealtime && !tAllowed)
+		{
+			tAllowed = true;
+			gViolationCount.fetch_add(1, std::memory_order_relaxed);
+			report(what);
+			tAllowed = false;
+		}
+	}
+
+#endif // SOUNDPLANE_RT_GUARD
+}
+
+#if SOUNDPLANE_RT_GUARD
+
+#if defined(__GLIBC__)
+
+// glibc exports its allocator under internal names as well, so definitions of the public
+// names in the executable can check and then forward to them. The real pthread_mutex_lock
+// is found with dlsym(), before main() where possible.
+
+namespace
+{
+	typedef int (*MutexLockFn)(pthread_mutex_t*);
+	std::atomic<MutexLockFn> gRealMutexLock{nullptr};
+
+	MutexLockFn getRealMutexLock()
+	{
+		MutexLockFn f = gRealMutexLock.load(std::memory_order_acquire);
+		if(!f)
+		{
+			f = reinterpret_cast<MutexLockFn>(dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+			gRealMutexLock.store(f, std::memory_order_release);
+		}
+		return f;
+	}
+
+	__attribute__((constructor)) void resolveRealMutexLock()
+	{
+		getRealMutexLock();
+	}
+}
+
+extern "C"
+{
+	void* __libc_malloc(size_t size);
+	void* __libc_calloc(size_t n, size_t size);
+	void* __libc_realloc(void* ptr, size_t size);
+	void __libc_free(void* ptr);
+
+	void* malloc(size_t size)
+	{
+		RealtimeGuard::check("malloc");
+		return __libc_malloc(size);
+	}
+
+	void* calloc(size_t n, size_t size)
+	{
+		RealtimeGuard::check("calloc");
+		return __libc_calloc(n, size);
+	}
+
+	void* realloc(void* ptr, size_t size)
+	{
+		RealtimeGuard::check("realloc");
+		return __libc_realloc(ptr, size);
+	}
+
+	void free(void* ptr)
+	{
+		if(ptr)
+		{
+			RealtimeGuard::check("free");
+		}
+		__libc_free(ptr);
+	}
+
+	int pthread_mutex_lock(pthread_mutex_t* mutex)
+	{
+		RealtimeGuard::check("pthread_mutex_lock");
+		return getRealMutexLock()(mutex);
+	}
+}
+
+#else
+
+// elsewhere, replacing the global operator new and delete is the portable option.
+
+void* operator new(std::size_t size)
+{
+	RealtimeGuard::check("operator new");
+	void* p = std::malloc(size ? size : 1);
+	if(!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	RealtimeGuard::check("operator new[]");
+	void* p = std::malloc(size ? size : 1);
+	if(!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	RealtimeGuard::check("operator new");
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	RealtimeGuard::check("operator new[]");
+	return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept
+{
+	if(p)
+	{
+		RealtimeGuard::check("operator delete");
+	}
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	if(p)
+	{
+		RealtimeGuard::check("operator delete[]");
+	}
+	std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+	operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+	operator delete[](p);
+}
+
+#endif // __GLIBC__
+
+#endif // SOUNDPLANE_RT_GUARD
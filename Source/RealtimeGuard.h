@@ -0,0 +1,68 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+// A debugging aid that enforces the rule that code on the process thread must not
+// allocate or free memory or block on a mutex. Code is marked realtime with
+// SP_REALTIME_SCOPE(). When SOUNDPLANE_RT_GUARD is defined to 1, the allocator and
+// pthread_mutex_lock are interposed, and any call from a realtime scope prints a
+// stack trace to stderr, once per distinct call site. If the environment variable
+// SOUNDPLANE_RT_GUARD_ABORT is set, the first violation aborts instead, which makes
+// the guard usable in automated runs.
+//
+// On Linux, malloc, calloc, realloc, free and pthread_mutex_lock are checked. On other
+// platforms only operator new and delete are checked. Try-locks are always allowed.
+//
+// Without SOUNDPLANE_RT_GUARD the macros below compile to nothing.
+
+#ifndef SOUNDPLANE_RT_GUARD
+#define SOUNDPLANE_RT_GUARD 0
+#endif
+
+#include <stdint.h>
+
+namespace RealtimeGuard
+{
+	constexpr bool kCompiledIn = SOUNDPLANE_RT_GUARD;
+
+	// mark code on the calling thread as realtime for the lifetime of the scope.
+	class RealtimeScope
+	{
+	public:
+		RealtimeScope();
+		~RealtimeScope();
+		RealtimeScope(const RealtimeScope&) = delete;
+		RealtimeScope& operator=(const RealtimeScope&) = delete;
+	private:
+		bool mPrevious;
+	};
+
+	// allow allocation and locking within a realtime scope, for work that is known
+	// not to be time-critical, such as calibration.
+	class AllowScope
+	{
+	public:
+		AllowScope();
+		~AllowScope();
+		AllowScope(const AllowScope&) = delete;
+		AllowScope& operator=(const AllowScope&) = delete;
+	private:
+		bool mPrevious;
+	};
+
+	// number of violations seen since startup, including repeats from the same site.
+	uint64_t getViolationCount();
+}
+
+#if SOUNDPLANE_RT_GUARD
+#define SP_RT_CONCAT_IMPL(a, b) a##b
+#define SP_RT_CONCAT(a, b) SP_RT_CONCAT_IMPL(a, b)
+#define SP_REALTIME_SCOPE() RealtimeGuard::RealtimeScope SP_RT_CONCAT(spRealtimeScope, __LINE__)
+#define SP_REALTIME_ALLOW() RealtimeGuard::AllowScope SP_RT_CONCAT(spRealtimeAllow, __LINE__)
+#else
+#define SP_REALTIME_SCOPE()
+#define SP_REALTIME_ALLOW()
+#endif
@@ -40,6 +40,10 @@ void SoundplaneController::handleWidgetAction(MLWidget* w, ml::Symbol action, ml
 		{
 			mpSoundplaneModel->beginSelectCarriers();
 		}
+		else if (p == "dump_trace")
+		{
+			mpSoundplaneModel->dumpTrace();
+		}
 		else if (p == "restore_defaults")
 		{
 			if(confirmRestoreDefaults())
@@ -19,6 +19,7 @@
 
 #include "MLNetServiceHub.h"
 #include "MLFileCollection.h"
+#include "MLMenu.h"
 
 #include "MLTimer.h"
 
@@ -0,0 +1,127 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+// soundplaned: runs the Soundplane Model headless, with no View or Controller.
+// The Model's properties are read from the same app state file that the
+// Soundplane application writes, so a setup made in the app can be run on a
+// machine without a display. All logging goes to stdout.
+
+#include <atomic>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "MLProjectInfo.h"
+#include "MLAppState.h"
+#include "SoundplaneModel.h"
+
+#include "madronalib.h"
+
+namespace
+{
+	std::atomic<bool> gTerminate{false};
+
+	void handleTerminateSignal(int)
+	{
+		gTerminate = true;
+	}
+
+	void printUsage(const char* name)
+	{
+		std::cout << "usage: " << name << " [options]\n";
+		std::cout << "  -v, --verbose   print driver and output diagnostics\n";
+		std::cout << "  -s, --shm       publish frames to shared memory, see soundplane_shm.h\n";
+		std::cout << "  -o, --osc-destinations JSON\n";
+		std::cout << "                  also send OSC to a list of destinations, see README.md\n";
+		std::cout << "  -h, --help      print this message\n";
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool verbose = false;
+	bool shm = false;
+	const char* oscDestinations = nullptr;
+	for(int i=1; i<argc; ++i)
+	{
+		if(!strcmp(argv[i], "-v") || !strcmp(argv[i], "--verbose"))
+		{
+			verbose = true;
+		}
+		else if(!strcmp(argv[i], "-s") || !strcmp(argv[i], "--shm"))
+		{
+			shm = true;
+		}
+		else if((!strcmp(argv[i], "-o") || !strcmp(argv[i], "--osc-destinations")) && (i + 1 < argc))
+		{
+			oscDestinations = argv[++i];
+		}
+		else if(!strcmp(argv[i], "-h") || !strcmp(argv[i], "--help"))
+		{
+			printUsage(argv[0]);
+			return 0;
+		}
+		else
+		{
+			std::cout << "unknown option " << argv[i] << "\n";
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	std::signal(SIGINT, handleTerminateSignal);
+	std::signal(SIGTERM, handleTerminateSignal);
+
+	std::cout << "soundplaned v." << MLProjectInfo::versionString << " starting...\n";
+
+	// there is no main message loop here, so timers get their own thread.
+	ml::SharedResourcePointer<ml::Timers> t;
+	t->start(false);
+
+	std::unique_ptr<SoundplaneModel> pModel(new SoundplaneModel());
+
+	// read the state saved by the application. unlike the application, we never
+	// write it back: the daemon is configured by running the app on some machine and
+	// copying the state file.
+	std::unique_ptr<MLAppState> pModelState(new MLAppState(pModel.get(), "", MLProjectInfo::makerName, MLProjectInfo::projectName, MLProjectInfo::versionNumber));
+	if(!pModelState->loadStateFromAppStateFile())
+	{
+		std::cout << "no saved state found, using defaults.\n";
+	}
+	if(verbose)
+	{
+		pModel->setProperty("verbose", 1);
+	}
+	if(shm)
+	{
+		pModel->setProperty("shm_active", 1);
+	}
+	if(oscDestinations)
+	{
+		pModel->setProperty("osc_destinations", oscDestinations);
+	}
+	pModel->updateAllProperties();
+
+	// report device status changes until we are signaled to stop.
+	int prevDeviceState = -1;
+	while(!gTerminate)
+	{
+		int deviceState = pModel->getDeviceState();
+		if(deviceState != prevDeviceState)
+		{
+			std::cout << pModel->getHardwareStr() << ": " << pModel->getStatusStr() << "\n";
+			prevDeviceState = deviceState;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	}
+
+	std::cout << "soundplaned: shutting down.\n";
+
+	// destroy the state before the Model it listens to.
+	pModelState = nullptr;
+	pModel = nullptr;
+	return 0;
+}
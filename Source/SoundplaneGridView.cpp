@@ -260,16 +260,16 @@ void SoundplaneGridView::renderXYGrid()
 	const ml::Matrix& touches = mpModel->getTouchFrame();
 	for(int t=0; t<nt; ++t)
 	{
-		int age = touches(ageColumn, t);
+		int age = touches(t, ageRow);
 		if (age > 0)
 		{
-			float x = touches(xColumn, t);
-			float y = touches(yColumn, t);
+			float x = touches(t, xRow);
+			float y = touches(t, yRow);
 			
 			Vec2 gridPos(x, y);
 			float tx = mKeyRangeX.convert(gridPos.x());
 			float ty = mKeyRangeY.convert(gridPos.y());
-			float tz = touches(zColumn, t);
+			float tz = touches(t, zRow);
 			
 			Vec4 dataColor(MLGL::getIndicatorColor(t));
 			dataColor[3] = 0.75;
@@ -290,7 +290,7 @@ void SoundplaneGridView::renderXYGrid()
 	int ctr = mpModel->getHistoryCtr();
 	for(int touch=0; touch<nt; ++touch)
 	{
-		//		int currentAge = touches(ageColumn, touch);
+		//		int currentAge = touches(touch, ageRow);
 		
 		//		debug() << "age:" << currentAge << "\n";
 		//		if (age > 0)
@@ -306,9 +306,9 @@ void SoundplaneGridView::renderXYGrid()
 			
 			for(int t=0; t < kDrawHistorySize; ++t)
 			{
-				float x = touchHistory(xColumn, touch, cc);
-				float y = touchHistory(yColumn, touch, cc);
-				int age = touchHistory(ageColumn, touch, cc);
+				float x = touchHistory(touch, xRow, cc);
+				float y = touchHistory(touch, yRow, cc);
+				int age = touchHistory(touch, ageRow, cc);
 				
 				if((age > 0))
 				{
@@ -334,7 +334,7 @@ void SoundplaneGridView::renderXYGrid()
 	}
 }
 
-void SoundplaneGridView::renderTouches(const TouchArray& newTouches)
+void SoundplaneGridView::renderTouches(const TouchFrame& newTouches)
 {
 	if (!mpModel) return;
 	
@@ -349,14 +349,11 @@ void SoundplaneGridView::renderTouches(const TouchArray& newTouches)
 	glLineWidth(1.0*mViewScale);
 	
 	// draw intersections colored by group
-	auto xs = newTouches;
-	int rowInt = 0;
-	int i = 0;
-	for(auto inx : xs)
+	for(int i = 0; i < kMaxTouches; ++i)
 	{
-		float x = mKeyRangeX.convert(inx.x);
-		float y = mKeyRangeY.convert(inx.y);
-		float z = inx.z;
+		float x = mKeyRangeX.convert(newTouches.x[i]);
+		float y = mKeyRangeY.convert(newTouches.y[i]);
+		float z = newTouches.z[i];
 		
 		if(z > 0.f)
 		{
@@ -375,9 +372,6 @@ void SoundplaneGridView::renderTouches(const TouchArray& newTouches)
 			MLGL::drawLine(x - k, y, x + k, y, 2.0f*mViewScale);
 			MLGL::drawLine(x, y - k, x, y + k, 2.0f*mViewScale);
 		}
-		
-		rowInt++;
-		i++;
 	}
 }
 
@@ -597,7 +591,7 @@ void SoundplaneGridView::renderOpenGL()
 	}
 	else if (viewMode == "touches")
 	{
-		renderTouches(mpModel->getTouchArray());
+		renderTouches(mpModel->getTouches());
 		drawSurfaceOverlay();
 	}
 	else // raw, calibrated or smoothed
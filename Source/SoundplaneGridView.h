@@ -42,7 +42,7 @@ private:
 	void drawSurfaceOverlay();
 	void renderXYGrid();
 	
-	void renderTouches(const TouchArray& t);
+	void renderTouches(const TouchFrame& t);
 	
 	void renderZGrid();
 	
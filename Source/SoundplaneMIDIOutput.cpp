@@ -10,6 +10,11 @@ const std::string kSoundplaneMIDIDeviceName("Soundplane IAC out");
 
 const int kMPE_MIDI_CC = 127;
 
+// how often the scheduler's send thread looks for frames, with dejitter on and off. With
+// it off, frames are only queued while earlier ones are still waiting.
+const microseconds kDejitterPollInterval{250};
+const microseconds kIdlePollInterval{2000};
+
 const ml::Symbol startFrameSym("start_frame");
 const ml::Symbol touchSym("touch");
 const ml::Symbol retrigSym("retrig");
@@ -37,6 +42,8 @@ mMIDINote(-1),
 mPreviousMIDINote(-1),
 mMIDIVel(0), mMIDIBend(0), mMIDIXCtrl(0), mMIDIYCtrl(0), mMIDIPressure(0),
 mMIDIChannel(0),
+mMPEZone(MPEVoiceAllocator::kLowerZone),
+mNoteOffChannel(0),
 mSendNoteOff(false),
 mSendNoteOn(false),
 mSendPressure(false),
@@ -106,7 +113,6 @@ mTranspose(0),
 mHysteresis(0.5f),
 mMPEExtended(false),
 mMPEMode(true),
-mMPEChannels(0),
 mChannel(1),
 mKymaMode(false),
 mVerbose(false)
@@ -115,10 +121,13 @@ mVerbose(false)
 	//mVerbose = true;
 #endif
 	findMIDIDevices();
+	mFrameBuffer.ensureSize(kMIDIFrameBufferBytes);
+	mScheduler.setPollInterval(kIdlePollInterval);
 }
 
 SoundplaneMIDIOutput::~SoundplaneMIDIOutput()
 {
+	mScheduler.stop();
 	if(mpCurrentDevice)
 	{
 		delete mpCurrentDevice;
@@ -150,39 +159,50 @@ void SoundplaneMIDIOutput::findMIDIDevices ()
 	}
 }
 
-void SoundplaneMIDIOutput::setDevice(int deviceIdx)
+// close the current device, sending any frames still scheduled first, and open the
+// device at the index if there is one.
+void SoundplaneMIDIOutput::openDevice(int deviceIdx)
 {
+	mScheduler.stop();
 	if(mpCurrentDevice)
 	{
 		delete mpCurrentDevice;
 		mpCurrentDevice = 0;
 	}
 	
-	if(deviceIdx < mDevices.size())
+	if((deviceIdx >= 0) && (deviceIdx < mDevices.size()))
 	{
 		mpCurrentDevice = mDevices[deviceIdx]->getDevice();
-		sendMPEChannels();
-		sendPitchbendRange();
+		if(mpCurrentDevice)
+		{
+			mScheduler.start(mpCurrentDevice);
+			mConfigurationRequested = true;
+		}
 	}
 }
 
+void SoundplaneMIDIOutput::setDevice(int deviceIdx)
+{
+	openDevice(deviceIdx);
+}
+
 void SoundplaneMIDIOutput::setDevice(const std::string& deviceStr)
 {
-	if(mpCurrentDevice)
-	{
-		delete mpCurrentDevice;
-		mpCurrentDevice = 0;
-	}
-	
+	int deviceIdx = -1;
 	for(int i=0; i<mDevices.size(); ++i)
 	{
 		if (mDevices[i]->getName() == deviceStr)
 		{
-			mpCurrentDevice = mDevices[i]->getDevice();
-			sendMPEChannels();
-			sendPitchbendRange();
+			deviceIdx = i;
 		}
 	}
+	openDevice(deviceIdx);
+}
+
+void SoundplaneMIDIOutput::setDejitter(bool v)
+{
+	mDejitter = v;
+	mScheduler.setPollInterval(v ? kDejitterPollInterval : kIdlePollInterval);
 }
 
 int SoundplaneMIDIOutput::getNumDevices()
@@ -229,14 +249,6 @@ void SoundplaneMIDIOutput::sendAllMIDIChannelPressures(int p)
 }
 
 
-void SoundplaneMIDIOutput::sendAllMIDINotesOff()
-{
-	for(int c=1; c<=kMaxMIDIVoices; ++c)
-	{
-		mpCurrentDevice->sendMessageNow(juce::MidiMessage::allNotesOff(c));
-	}
-}
-
 void SoundplaneMIDIOutput::setPressureActive(bool v)
 {
 	mPressureActive = v;
@@ -268,47 +280,111 @@ void SoundplaneMIDIOutput::setMPEExtended(bool v)
 
 void SoundplaneMIDIOutput::setMPE(bool v)
 {
-	mMPEMode = v;
-	
-	// channels is always 15 now if we are in MPE mode. If we introduce splits or more complex MPE options this may change.
-	mMPEChannels = mMPEMode ? 15 : 0;
-	
-	if (!mpCurrentDevice) return;
-	sendAllMIDINotesOff();
-	sendAllMIDIChannelPressures(0);
-	sendMPEChannels();
-	sendPitchbendRange();
+	std::lock_guard<std::mutex> lock(mSettingsMutex);
+	mPendingSettings.mpe = v;
+	mSettingsChanged.store(true, std::memory_order_release);
 }
 
-void SoundplaneMIDIOutput::setStartChannel(int v)
+// set the number of member channels in the lower and upper MPE zones. Touches from zones
+// with an offset of 1 or more play in the upper zone, if it has any channels.
+void SoundplaneMIDIOutput::setMPEZones(int lowerChannels, int upperChannels)
 {
-	if(mChannel == v) return;
-	mChannel = v;
-	if (!mpCurrentDevice) return;
-	sendAllMIDINotesOff();
+	std::lock_guard<std::mutex> lock(mSettingsMutex);
+	mPendingSettings.lowerChannels = lowerChannels;
+	mPendingSettings.upperChannels = upperChannels;
+	mSettingsChanged.store(true, std::memory_order_release);
 }
 
-void SoundplaneMIDIOutput::setKymaMode(bool v)
+// when a zone runs out of channels: 0 = drop the new note, 1 = steal the oldest note,
+// 2 = steal the quietest note.
+void SoundplaneMIDIOutput::setStealMode(int m)
 {
-	MLConsole() << "SoundplaneMIDIOutput: kyma mode " << v << "\n";
-	mKymaMode = v;
+	std::lock_guard<std::mutex> lock(mSettingsMutex);
+	mPendingSettings.stealMode = ml::clamp(m, 0, 2);
+	mSettingsChanged.store(true, std::memory_order_release);
 }
 
-// MPE spec defines a split mode using main channels 1 and 16. We ignore this for now and use only channel 1
-// for the main channel, and 2 upwards for the individual voices.
-int SoundplaneMIDIOutput::getMPEMainChannel()
+void SoundplaneMIDIOutput::setStartChannel(int v)
 {
-	return 1;
+	std::lock_guard<std::mutex> lock(mSettingsMutex);
+	mPendingSettings.channel = v;
+	mSettingsChanged.store(true, std::memory_order_release);
+}
+
+// on the process thread at the start of a frame, apply the channel settings if they have
+// changed. If the setters hold the lock, they are applied at a later frame. Any sounding
+// notes are ended, and the configuration is sent ahead of the frame's other messages.
+void SoundplaneMIDIOutput::applyPendingSettings()
+{
+	bool configure = mConfigurationRequested.exchange(false);
+	bool notesOff = false;
+	bool resetPressures = false;
+	
+	if(mSettingsChanged.load(std::memory_order_acquire))
+	{
+		std::unique_lock<std::mutex> lock(mSettingsMutex, std::try_to_lock);
+		if(lock.owns_lock())
+		{
+			MIDIChannelSettings s = mPendingSettings;
+			mSettingsChanged = false;
+			lock.unlock();
+			
+			bool modeChanged = (s.mpe != mSettings.mpe);
+			bool zonesChanged = (s.lowerChannels != mSettings.lowerChannels) || (s.upperChannels != mSettings.upperChannels);
+			bool channelChanged = (s.channel != mSettings.channel);
+			mSettings = s;
+			
+			mAllocator.setStealMode(static_cast<MPEVoiceAllocator::StealMode>(s.stealMode));
+			if(modeChanged || zonesChanged || channelChanged)
+			{
+				mMPEMode = s.mpe;
+				mChannel = s.channel;
+				mAllocator.setZones(s.lowerChannels, s.upperChannels);
+				mAllocator.setSingleChannel(mMPEMode ? 0 : mChannel);
+				resetVoiceChannels();
+				
+				notesOff = true;
+				resetPressures = modeChanged;
+				configure |= modeChanged || zonesChanged;
+			}
+		}
+	}
+	
+	if(notesOff)
+	{
+		addAllNotesOff(resetPressures);
+	}
+	if(configure)
+	{
+		addMPEChannels();
+		addPitchbendRange();
+	}
 }
 
-int SoundplaneMIDIOutput::getMPEVoiceChannel(int voice)
+// end the notes on every channel, and optionally set their pressures to zero.
+void SoundplaneMIDIOutput::addAllNotesOff(bool resetPressures)
 {
-	return 2 + ml::clamp(voice, 0, 14);
+	for(int c=1; c<=kMaxMIDIVoices; ++c)
+	{
+		mFrameBuffer.addEvent(juce::MidiMessage::allNotesOff(c), kPhaseConfiguration);
+		if(resetPressures)
+		{
+			if(!mMPEExtended || mPressureActive)
+			{
+				mFrameBuffer.addEvent(juce::MidiMessage::channelPressureChange(c, 0), kPhaseConfiguration);
+			}
+			if(mMPEExtended)
+			{
+				mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(c, 11, 0), kPhaseConfiguration);
+			}
+		}
+	}
 }
 
-int SoundplaneMIDIOutput::getVoiceChannel(int v)
+void SoundplaneMIDIOutput::setKymaMode(bool v)
 {
-	return (mMPEMode) ? (getMPEVoiceChannel(v)) : mChannel;
+	MLConsole() << "SoundplaneMIDIOutput: kyma mode " << v << "\n";
+	mKymaMode = v;
 }
 
 int SoundplaneMIDIOutput::getMIDIPitchBend(MIDIVoice* pVoice)
@@ -352,30 +428,11 @@ int SoundplaneMIDIOutput::getRetriggerVelocity(MIDIVoice* pVoice)
 	return ml::clamp((int)fVel, 10, 127);
 }
 
-int SoundplaneMIDIOutput::getMostRecentVoice()
-{
-	// get active voice played most recently
-	unsigned int minAge = (unsigned int)-1;
-	int newestVoiceIdx = -1;
-	for(int i=0; i<mVoices; ++i)
-	{
-		MIDIVoice* pVoice = &mMIDIVoices[i];
-		int a = pVoice->age;
-		if(a > 0)
-		{
-			if(a < minAge)
-			{
-				minAge = a;
-				newestVoiceIdx = i;
-			}
-		}
-	}
-	return newestVoiceIdx;
-}
-
 void SoundplaneMIDIOutput::beginOutputFrame(time_point<system_clock> now)
 {
-	setupVoiceChannels();
+	mFrameTime = now;
+	mFrameBuffer.clear();
+	applyPendingSettings();
 }
 
 void SoundplaneMIDIOutput::processTouch(int i, int offset, const Touch& t)
@@ -396,6 +453,7 @@ void SoundplaneMIDIOutput::processTouch(int i, int offset, const Touch& t)
 			pVoice->startNote = t.note;
 			pVoice->mState = kTouchStateOn;
 			pVoice->age = 1;
+			pVoice->mMPEZone = (offset > 0) ? MPEVoiceAllocator::kUpperZone : MPEVoiceAllocator::kLowerZone;
 			
 			// get nearest integer note
 			pVoice->mMIDINote = ml::clamp((int)lround(pVoice->note) + mTranspose, 1, 127);
@@ -406,13 +464,26 @@ void SoundplaneMIDIOutput::processTouch(int i, int offset, const Touch& t)
 			if(mPressureActive)
 			{
 				int newPressure = ml::clamp((int)(pVoice->z*128.f), 0, 127);
-				if(newPressure != pVoice->mMIDIPressure)
+				if((newPressure != pVoice->mMIDIPressure) || mMPEMode)
 				{
 					pVoice->mMIDIPressure = newPressure;
 					pVoice->mSendPressure = true;
 				}
 			}
 			
+			// in MPE the note's channel may have been used by another note, so its
+			// controllers are always sent before the note on.
+			if(mMPEMode)
+			{
+				pVoice->mMIDIBend = getMIDIPitchBend(pVoice);
+				pVoice->mMIDIXCtrl = ml::clamp((int)(pVoice->x*128.f), 0, 127);
+				pVoice->mMIDIYCtrl = ml::clamp((int)(pVoice->y*128.f), 0, 127);
+				pVoice->mSendPitchBend = true;
+				pVoice->mSendXCtrl = true;
+				pVoice->mSendYCtrl = true;
+			}
+			mAllocator.setLevel(i, t.z);
+			
 			break;
 			
 			
@@ -425,6 +496,7 @@ void SoundplaneMIDIOutput::processTouch(int i, int offset, const Touch& t)
 				{
 					pVoice->mMIDINote = newMIDINote;
 					pVoice->mMIDIVel = getRetriggerVelocity(pVoice);
+					pVoice->mNoteOffChannel = pVoice->mMIDIChannel;
 					pVoice->mSendNoteOff = true;
 					pVoice->mSendNoteOn = true;
 				}
@@ -435,12 +507,15 @@ void SoundplaneMIDIOutput::processTouch(int i, int offset, const Touch& t)
 			if(mPressureActive)
 			{
 				int newPressure = ml::clamp((int)(pVoice->z*128.f), 0, 127);
-				pVoice->mMIDIPressure = newPressure;
-				pVoice->mSendPressure = true;
+				if(newPressure != pVoice->mMIDIPressure)
+				{
+					pVoice->mMIDIPressure = newPressure;
+					pVoice->mSendPressure = true;
+				}
 			}
 			
 			// if in MPE mode, or if this is the youngest voice, we may send pitch bend and xy controller data.
-			if((getMostRecentVoice() == i) || mMPEMode)
+			if((mAllocator.getMostRecentVoice() == i) || mMPEMode)
 			{
 				int ip = getMIDIPitchBend(pVoice);
 				if(ip != pVoice->mMIDIBend)
@@ -465,6 +540,7 @@ void SoundplaneMIDIOutput::processTouch(int i, int offset, const Touch& t)
 			}
 			
 			pVoice->age++;
+			mAllocator.setLevel(i, t.z);
 			
 			break;
 			
@@ -483,6 +559,7 @@ void SoundplaneMIDIOutput::processTouch(int i, int offset, const Touch& t)
 				pVoice->mSendPitchBend = true;
 			}
 			
+			pVoice->mNoteOffChannel = pVoice->mMIDIChannel;
 			pVoice->mSendNoteOff = true;
 			
 			// send pressure off
@@ -509,8 +586,11 @@ void SoundplaneMIDIOutput::processController(int zoneID, int h, const ZoneMessag
 
 void SoundplaneMIDIOutput::endOutputFrame()
 {
+	mSentFrame = false;
+	allocateVoiceChannels();
 	sendMIDIVoiceMessages();
 	if(mGotControllerChanges) sendMIDIControllerMessages();
+	sendFrameBuffer();
 	if(mVerbose) dumpVoices();
 	updateVoiceStates();
 }
@@ -519,130 +599,242 @@ void SoundplaneMIDIOutput::clear()
 {
 }
 
-void SoundplaneMIDIOutput::setupVoiceChannels()
+// after the allocator has been reset, voices keep no channel and stay silent until
+// their next note on.
+void SoundplaneMIDIOutput::resetVoiceChannels()
 {
+	for(auto& v : mMIDIVoices)
+	{
+		v.mMIDIChannel = 0;
+		v.mNoteOffChannel = 0;
+	}
+}
+
+// release the channels of ending notes, then give channels to starting notes, so
+// that a note starting in the same frame as another ends can use its channel.
+void SoundplaneMIDIOutput::allocateVoiceChannels()
+{
+	for(int i=0; i < mVoices; ++i)
+	{
+		MIDIVoice* pVoice = &mMIDIVoices[i];
+		if((pVoice->mState == kTouchStateOff) && pVoice->mSendNoteOff)
+		{
+			mAllocator.noteOff(i);
+		}
+	}
+	
 	for(int i=0; i < mVoices; ++i)
 	{
 		MIDIVoice* pVoice = &mMIDIVoices[i];
-		int chan = getVoiceChannel(i);
-		pVoice->mMIDIChannel = chan;
+		if((pVoice->mState == kTouchStateOn) && pVoice->mSendNoteOn)
+		{
+			int stolenVoice;
+			pVoice->mMIDIChannel = mAllocator.noteOn(i, pVoice->mMPEZone, stolenVoice);
+			if(stolenVoice >= 0)
+			{
+				stealVoice(stolenVoice);
+			}
+		}
 	}
 }
 
+// end the note of a voice whose channel was given to a new note. The voice stays
+// silent until its touch ends.
+void SoundplaneMIDIOutput::stealVoice(int v)
+{
+	if((v < 0) || (v >= kMaxMIDIVoices)) return;
+	MIDIVoice* pVoice = &mMIDIVoices[v];
+	
+	// a note starting in this frame has not been sent yet, so needs no note off.
+	if(pVoice->mState != kTouchStateOn)
+	{
+		pVoice->mNoteOffChannel = pVoice->mMIDIChannel;
+		pVoice->mSendNoteOff = true;
+	}
+	pVoice->mMIDIChannel = 0;
+}
+
 void SoundplaneMIDIOutput::sendMIDIVoiceMessages()
 {
-	// send MIDI notes and controllers for each live touch.
+	// add MIDI notes and controllers for each live touch to the frame buffer.
 	// attempt to translate the notes into MIDI notes + pitch bend.
+	// in MPE, pitch bend, pressure and timbre are sent before the note-on, so that
+	// the new note starts with its correct values. Ending notes go first, so that
+	// their last values do not follow those of a new note on the same channel.
 	for(int i=0; i < mVoices; ++i)
 	{
 		MIDIVoice* pVoice = &mMIDIVoices[i];
-		int chan = pVoice->mMIDIChannel;
-		
-		if(pVoice->mSendNoteOff)
+		if(pVoice->mState == kTouchStateOff)
 		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::noteOff(chan, pVoice->mPreviousMIDINote));
+			addVoiceMessages(pVoice);
 		}
-		
-		if(pVoice->mSendNoteOn)
-		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::noteOn(chan, pVoice->mMIDINote, (unsigned char)pVoice->mMIDIVel));
-		}
-		
-		if(pVoice->mSendPitchBend)
+	}
+	for(int i=0; i < mVoices; ++i)
+	{
+		MIDIVoice* pVoice = &mMIDIVoices[i];
+		if(pVoice->mState != kTouchStateOff)
 		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::pitchWheel(chan, pVoice->mMIDIBend));
+			addVoiceMessages(pVoice);
 		}
-		
-		if(pVoice->mSendPressure)
+	}
+}
+
+void SoundplaneMIDIOutput::addVoiceMessages(MIDIVoice* pVoice)
+{
+	if(pVoice->mSendNoteOff && pVoice->mNoteOffChannel)
+	{
+		mFrameBuffer.addEvent(juce::MidiMessage::noteOff(pVoice->mNoteOffChannel, pVoice->mPreviousMIDINote), kPhaseNoteOff);
+	}
+	
+	// an ending voice sends its last values on the channel it is releasing.
+	int chan = (pVoice->mState == kTouchStateOff) ? pVoice->mNoteOffChannel : pVoice->mMIDIChannel;
+	if(!chan) return;
+	
+	if(pVoice->mSendNoteOn)
+	{
+		mFrameBuffer.addEvent(juce::MidiMessage::noteOn(chan, pVoice->mMIDINote, (unsigned char)pVoice->mMIDIVel), kPhaseNoteOn);
+	}
+	
+	if(pVoice->mSendPitchBend)
+	{
+		mFrameBuffer.addEvent(juce::MidiMessage::pitchWheel(chan, pVoice->mMIDIBend), kPhaseChannel);
+	}
+	
+	if(pVoice->mSendPressure)
+	{
+		int p = pVoice->mMIDIPressure;
+		if(mMPEMode)
 		{
-			int p = pVoice->mMIDIPressure;
-			if(mMPEMode)
+			if(!mMPEExtended)
 			{
-				if(!mMPEExtended)
-				{
-					// normal MPE: send pressure as channel pressure
-					mpCurrentDevice->sendMessageNow(juce::MidiMessage::channelPressureChange(chan, p));
-				}
-				else
-				{
-					// MPE extensions
-					mpCurrentDevice->sendMessageNow(juce::MidiMessage::channelPressureChange(chan, p));
-					mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 11, p));
-				}
+				// normal MPE: send pressure as channel pressure
+				mFrameBuffer.addEvent(juce::MidiMessage::channelPressureChange(chan, p), kPhaseChannel);
 			}
-			else  // for single channel MIDI, send pressure as poly aftertouch
+			else
 			{
-				mpCurrentDevice->sendMessageNow(juce::MidiMessage::aftertouchChange(chan, pVoice->mMIDINote, p));
+				// MPE extensions
+				mFrameBuffer.addEvent(juce::MidiMessage::channelPressureChange(chan, p), kPhaseChannel);
+				mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 11, p), kPhaseChannel);
 			}
 		}
-		
-		if(pVoice->mSendXCtrl)
+		else  // for single channel MIDI, send pressure as poly aftertouch
 		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 73, pVoice->mMIDIXCtrl));
-		}
-		
-		if(pVoice->mSendYCtrl)
-		{
-			mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 74, pVoice->mMIDIYCtrl));
+			mFrameBuffer.addEvent(juce::MidiMessage::aftertouchChange(chan, pVoice->mMIDINote, p), kPhasePolyPressure);
 		}
 	}
+	
+	if(pVoice->mSendXCtrl)
+	{
+		mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 73, pVoice->mMIDIXCtrl), kPhaseChannel);
+	}
+	
+	if(pVoice->mSendYCtrl)
+	{
+		mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 74, pVoice->mMIDIYCtrl), kPhaseChannel);
+	}
 }
 
 void SoundplaneMIDIOutput::sendMIDIControllerMessages()
 {
-	// for each zone, send and clear any controller messages received since last frame
+	// for each zone, add any controller messages received since last frame to the frame buffer
 	for(int i=0; i<kSoundplaneAMaxZones; ++i)
 	{
-		ZoneMessage& c = mControllersByZone[i];
-		ZoneMessage& d = mSentControllersByZone[i];
+		const ZoneMessage& c = mControllersByZone[i];
+		const ZoneMessage& d = mSentControllersByZone[i];
 		
-		//if(c.active)
 		if(c != d)
 		{
-			
-			int ix = ml::clamp((int)(c.x*128.f), 0, 127);
-			int iy = ml::clamp((int)(c.y*128.f), 0, 127);
-			int iz = ml::clamp((int)(c.z*128.f), 0, 127);
-			
 			// use channel from zone, or default to channel dial setting.
 			int channel = (c.offset > 0) ? (c.offset) : (mChannel);
 			
-			if(c.type == "x")
-			{
-				mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
-			}
-			else if(c.type == "y")
-			{
-				mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, iy));
-			}
-			else if(c.type == "xy")
-			{
-				mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
-				mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number2, iy));
-			}
-			else if(c.type == "z")
-			{
-				mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, iz));
-			}
-			else if(c.type == "toggle")
+			// if anything but the values has changed, send the values even if they have not.
+			bool force = (c.type != d.type) || (c.number1 != d.number1) || (c.number2 != d.number2) ||
+				(c.offset != d.offset) || (c.hiRes != d.hiRes);
+			
+			switch(c.type)
 			{
-				mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(channel, c.number1, ix));
+				case kZoneTypeX:
+				case kZoneTypeToggle:
+					addControllerEvents(channel, c.number1, c.x, d.x, c.hiRes, force);
+					break;
+				case kZoneTypeY:
+					addControllerEvents(channel, c.number1, c.y, d.y, c.hiRes, force);
+					break;
+				case kZoneTypeXY:
+					addControllerEvents(channel, c.number1, c.x, d.x, c.hiRes, force);
+					addControllerEvents(channel, c.number2, c.y, d.y, c.hiRes, force);
+					break;
+				case kZoneTypeZ:
+					addControllerEvents(channel, c.number1, c.z, d.z, c.hiRes, force);
+					break;
+				default:
+					break;
 			}
 			
-			
 			mSentControllersByZone[i] = mControllersByZone[i];
-			
 		}
-		
-		// clear controller message
-		// mControllersByZone[i].active = false;
 	}
 	
 	mGotControllerChanges = false;
 }
 
+// add the messages for one controller value if its MIDI value has changed. A 14-bit value
+// is sent as a pair, MSB on the controller number and LSB on the number + 32.
+void SoundplaneMIDIOutput::addControllerEvents(int channel, int number, float value, float sentValue, bool hiRes, bool force)
+{
+	int v = ControllerFilter::toStep(value);
+	int sv = ControllerFilter::toStep(sentValue);
+	if(hiRes)
+	{
+		if(force || (v != sv))
+		{
+			mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(channel, number, v >> 7), kPhaseZoneControllers);
+			mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(channel, number + 32, v & 0x7F), kPhaseZoneControllers);
+		}
+	}
+	else
+	{
+		if(force || ((v >> 7) != (sv >> 7)))
+		{
+			mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(channel, number, v >> 7), kPhaseZoneControllers);
+		}
+	}
+}
+
+// send the frame's messages to the device in one block. With dejitter on, the block
+// is queued for the scheduler to send at a fixed delay after the frame time, so that
+// the time from sensor frame to MIDI does not vary with processing time. Frames also
+// go through the queue while earlier ones are still in it, so they stay in order and
+// only one thread uses the device at a time.
+void SoundplaneMIDIOutput::sendFrameBuffer()
+{
+	if(mFrameBuffer.isEmpty() || !mpCurrentDevice) return;
+	
+	bool dejitter = mDejitter.load(std::memory_order_relaxed);
+	if(dejitter || !mScheduler.isEmpty())
+	{
+		steady_clock::time_point sendTime = steady_clock::now();
+		if(dejitter)
+		{
+			sendTime += duration_cast< steady_clock::duration >(mFrameTime + kMIDIDejitterDelay - system_clock::now());
+		}
+		mScheduler.add(mFrameBuffer, sendTime);
+	}
+	else
+	{
+		mpCurrentDevice->sendBlockOfMessagesNow(mFrameBuffer);
+	}
+	mSentFrame = true;
+}
+
 void SoundplaneMIDIOutput::doInfrequentTasks()
 {
+	int dropped = mScheduler.getDroppedFrames();
+	if(dropped)
+	{
+		MLConsole() << "SoundplaneMIDIOutput: " << dropped << " frames dropped, send queue full.\n";
+	}
+
 	if(mpCurrentDevice && mKymaMode)
 	{
 		pollKymaViaMIDI();
@@ -696,7 +888,7 @@ void SoundplaneMIDIOutput::updateVoiceStates()
 void SoundplaneMIDIOutput::setBendRange(int r)
 {
 	mBendRange = r;
-	sendPitchbendRange();
+	mConfigurationRequested = true;
 }
 
 void SoundplaneMIDIOutput::setMaxTouches(int t)
@@ -709,38 +901,55 @@ void SoundplaneMIDIOutput::setMaxTouches(int t)
 	}
 }
 
-void SoundplaneMIDIOutput::sendMPEChannels()
+// send the MPE configuration message (RPN 6) on the manager channel of each zone, lower
+// zone first. Zones without member channels, and all zones outside of MPE mode, are
+// turned off.
+void SoundplaneMIDIOutput::addMPEChannels()
 {
-	int chan = getMPEMainChannel();
-	if(!mpCurrentDevice) return;
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, kMPE_MIDI_CC, mMPEChannels));
+	for(int zone = 0; zone < MPEVoiceAllocator::kNumZones; ++zone)
+	{
+		int chan = mAllocator.getManagerChannel(zone);
+		int members = mMPEMode ? mAllocator.getMemberChannels(zone) : 0;
+		mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 101, 0), kPhaseConfiguration);
+		mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 100, 6), kPhaseConfiguration);
+		mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 6, members), kPhaseConfiguration);
+	}
 }
 
-void SoundplaneMIDIOutput::sendPitchbendRange()
+void SoundplaneMIDIOutput::addPitchbendRange()
 {
-	if(!mpCurrentDevice) return;
-	int chan = mChannel;
-	int quantizedRange = mBendRange;
-	
 	if(mMPEMode)
 	{
-		chan = getMPEVoiceChannel(0);
-		
-		// MPE spec requires a multiple of 12
-		quantizedRange = (quantizedRange/12)*12;
+		// MPE spec requires a multiple of 12. The range sent to one member channel
+		// applies to the whole zone.
+		int quantizedRange = (mBendRange/12)*12;
+		for(int zone = 0; zone < MPEVoiceAllocator::kNumZones; ++zone)
+		{
+			if(mAllocator.getMemberChannels(zone) > 0)
+			{
+				addPitchbendRange(mAllocator.getFirstMemberChannel(zone), quantizedRange);
+			}
+		}
 	}
-	
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 100, 0));
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 101, 0));
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 6, quantizedRange));
-	mpCurrentDevice->sendMessageNow(juce::MidiMessage::controllerEvent(chan, 38, 0));
+	else
+	{
+		addPitchbendRange(mChannel, mBendRange);
+	}
+}
+
+void SoundplaneMIDIOutput::addPitchbendRange(int chan, int range)
+{
+	mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 100, 0), kPhaseConfiguration);
+	mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 101, 0), kPhaseConfiguration);
+	mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 6, range), kPhaseConfiguration);
+	mFrameBuffer.addEvent(juce::MidiMessage::controllerEvent(chan, 38, 0), kPhaseConfiguration);
 }
 
 void SoundplaneMIDIOutput::dumpVoices()
 {
 	// dump voices
 	debug() << "----------------------\n";
-	int newestVoiceIdx = getMostRecentVoice();
+	int newestVoiceIdx = mAllocator.getMostRecentVoice();
 	if(newestVoiceIdx >= 0)
 		debug() << "newest: " << newestVoiceIdx << "\n";
 	
@@ -751,7 +960,7 @@ void SoundplaneMIDIOutput::dumpVoices()
 		int ip = getMIDIPitchBend(pVoice);
 		int iz = ml::clamp((int)(pVoice->z*128.f), 0, 127);
 		
-		debug() << "v" << i << ": CHAN=" << getVoiceChannel(i) << " BEND = " << ip << " Z = " << iz << "\n";
+		debug() << "v" << i << ": CHAN=" << pVoice->mMIDIChannel << " BEND = " << ip << " Z = " << iz << "\n";
 	}
 }
 
@@ -8,6 +8,8 @@
 
 #include "JuceHeader.h"
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <memory>
 #include <chrono>
@@ -18,10 +20,44 @@
 //#include "TouchTracker.h"
 #include "SoundplaneModelA.h"
 #include "SoundplaneOutput.h"
+#include "MIDIFrameScheduler.h"
+#include "MPEVoiceAllocator.h"
 #include "Touch.h"
 
 const int kMaxMIDIVoices = 16;
 
+// each frame's messages are sent together, sorted by these phases. Within a phase,
+// messages keep the order they were added in.
+enum MIDIFramePhase
+{
+	kPhaseConfiguration = 0,	// all notes off and RPNs after the channel settings change
+	kPhaseNoteOff,
+	kPhaseChannel,		// pitch bend, channel pressure and per-voice controllers
+	kPhaseNoteOn,
+	kPhasePolyPressure,
+	kPhaseZoneControllers
+};
+
+// preallocated size of the per-frame message buffer, enough for every message
+// from 16 voices and many controller zones.
+const int kMIDIFrameBufferBytes = 4096;
+
+// with dejitter on, each frame is sent this long after the frame time, by the
+// scheduler's send thread.
+const milliseconds kMIDIDejitterDelay{2};
+
+// the MPE and channel settings. The setters store them as pending settings on the property
+// thread, and the process thread applies them at the start of a frame, so the allocator
+// and voice channels only change between frames.
+struct MIDIChannelSettings
+{
+	bool mpe{true};
+	int lowerChannels{15};
+	int upperChannels{0};
+	int stealMode{MPEVoiceAllocator::kStealOldest};
+	int channel{1};
+};
+
 class MIDIVoice
 {
 public:
@@ -49,6 +85,10 @@ public:
 	int mMIDIPressure;
 	int mMIDIChannel;
 	
+	// the MPE zone the voice plays in, and the channel its pending note off goes to.
+	int mMPEZone;
+	int mNoteOffChannel;
+	
 	bool mSendNoteOff;
 	bool mSendNoteOn;
 	bool mSendPressure;
@@ -111,35 +151,42 @@ public:
 	
 	void setMPEExtended(bool v);
 	void setMPE(bool v);
+	void setMPEZones(int lowerChannels, int upperChannels);
+	void setStealMode(int m);
 	void setStartChannel(int v);
 	void setKymaMode(bool v);
 	
 	void setDataRate(float r) { mDataRate = r; }
+	void setDejitter(bool v);
 	
 	void doInfrequentTasks();
 	
 private:
-	int getMPEMainChannel();
-	int getMPEVoiceChannel(int voice);
-	int getVoiceChannel(int voice);
 	int getMIDIPitchBend(MIDIVoice* pVoice);
 	int getMIDIVelocity(MIDIVoice* pVoice);
 	int getRetriggerVelocity(MIDIVoice* pVoice);
-	int getMostRecentVoice();
 	
 	int getMIDIPressure(MIDIVoice* pVoice);
 	
 	void sendMIDIChannelPressure(int chan, int p);
 	void sendAllMIDIChannelPressures(int p);
-	void sendAllMIDINotesOff();
 	
-	void sendMPEChannels();
-	void sendPitchbendRange();
+	void applyPendingSettings();
+	void addAllNotesOff(bool resetPressures);
+	void addMPEChannels();
+	void addPitchbendRange();
+	void addPitchbendRange(int chan, int range);
 	
-	void setupVoiceChannels();
+	void resetVoiceChannels();
+	void allocateVoiceChannels();
+	void stealVoice(int v);
 	void updateVoiceStates();
+	void addVoiceMessages(MIDIVoice* pVoice);
 	void sendMIDIVoiceMessages();
 	void sendMIDIControllerMessages();
+	void addControllerEvents(int channel, int number, float value, float sentValue, bool hiRes, bool force);
+	void sendFrameBuffer();
+	void openDevice(int deviceIdx);
 	void pollKymaViaMIDI();
 	void dumpVoices();
 	
@@ -157,6 +204,13 @@ private:
 	
 	bool mGotControllerChanges;
 	
+	juce::MidiBuffer mFrameBuffer;
+	time_point<system_clock> mFrameTime;
+	std::atomic<bool> mDejitter{false};
+	
+	// sends the frames to the current device while it is open.
+	MIDIFrameScheduler mScheduler;
+	
 	int mDataRate{100};
 	
 	bool mPressureActive;
@@ -168,11 +222,23 @@ private:
 	
 	bool mMPEExtended;
 	bool mMPEMode;
-	int mMPEChannels;
+	
+	// assigns channels to voices in MPE mode, and tracks the most recent voice in any mode.
+	MPEVoiceAllocator mAllocator;
 	
 	// channel to be used for single-channel output
 	int mChannel;
 	
+	// settings from the setters, waiting for the process thread, and the ones applied.
+	MIDIChannelSettings mPendingSettings;
+	MIDIChannelSettings mSettings;
+	std::mutex mSettingsMutex;
+	std::atomic<bool> mSettingsChanged{false};
+	
+	// set when a device is opened or the bend range changes, to send the MPE
+	// configuration and bend range again at the start of the next frame.
+	std::atomic<bool> mConfigurationRequested{false};
+	
 	bool mKymaMode;
 	bool mVerbose;
 };
@@ -0,0 +1,72 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "SoundplaneMetrics.h"
+
+#include <sstream>
+
+void SoundplaneMetrics::updateMax(MetricID id, uint64_t v)
+{
+	uint64_t prev = mValues[id].load(std::memory_order_relaxed);
+	while((v > prev) && !mValues[id].compare_exchange_weak(prev, v, std::memory_order_relaxed)) {}
+}
+
+void SoundplaneMetrics::clear()
+{
+	for(auto& v : mValues)
+	{
+		v.store(0, std::memory_order_relaxed);
+	}
+}
+
+const char* SoundplaneMetrics::getName(int id)
+{
+	static const char* kMetricNames[kNumMetrics] =
+	{
+		"received",
+		"dropped",
+		"gaps",
+		"resets",
+		"payload_failures",
+		"data_diff_errors",
+		"queue_high_water",
+		"processed",
+		"deadline_misses",
+		"midi_frames",
+		"osc_frames",
+		"shm_frames",
+		"ump_frames",
+		"clock_slips",
+		"baseline_updates"
+	};
+	return ((id >= 0) && (id < kNumMetrics)) ? kMetricNames[id] : "?";
+}
+
+bool SoundplaneMetrics::isFault(int id)
+{
+	switch(id)
+	{
+		case kMetricFramesDropped:
+		case kMetricSequenceGaps:
+		case kMetricDeviceResets:
+		case kMetricPayloadFailures:
+		case kMetricDataDiffErrors:
+		case kMetricDeadlineMisses:
+			return true;
+		default:
+			return false;
+	}
+}
+
+std::string SoundplaneMetrics::toString() const
+{
+	std::ostringstream s;
+	for(int i=0; i<kNumMetrics; ++i)
+	{
+		if(i > 0) s << " ";
+		s << getName(i) << " " << get(i);
+	}
+	return s.str();
+}
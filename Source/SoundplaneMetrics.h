@@ -0,0 +1,61 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+// Counters describing the health of the input and processing pipeline. All updates
+// are lock-free, so they can be made from the driver callback and the process
+// thread while the UI, OSC listener or daemon read them.
+
+enum MetricID
+{
+	kMetricFramesReceived = 0,
+	kMetricFramesDropped,
+	kMetricSequenceGaps,
+	kMetricDeviceResets,
+	kMetricPayloadFailures,
+	kMetricDataDiffErrors,
+	kMetricQueueHighWater,
+	kMetricFramesProcessed,
+	kMetricDeadlineMisses,
+	kMetricMIDIFramesSent,
+	kMetricOSCFramesSent,
+	kMetricShmFramesSent,
+	kMetricUMPFramesSent,
+	kMetricClockSlips,
+	kMetricBaselineUpdates,
+	kNumMetrics
+};
+
+class SoundplaneMetrics
+{
+public:
+	SoundplaneMetrics() { clear(); }
+	~SoundplaneMetrics() {}
+
+	void increment(MetricID id) { mValues[id].fetch_add(1, std::memory_order_relaxed); }
+
+	// raise a high-water mark to v if v is higher.
+	void updateMax(MetricID id, uint64_t v);
+
+	uint64_t get(int id) const { return mValues[id].load(std::memory_order_relaxed); }
+	void clear();
+
+	static const char* getName(int id);
+
+	// counters that indicate a problem the performer may hear or see.
+	static bool isFault(int id);
+
+	// all counters as "name value" pairs on one line.
+	std::string toString() const;
+
+private:
+	std::array< std::atomic<uint64_t>, kNumMetrics > mValues;
+};
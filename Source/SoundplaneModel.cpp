@@ -8,6 +8,11 @@
 #include "ThreadUtility.h"
 #include "SensorFrame.h"
 #include "MLProjectInfo.h"
+#include "SoundplaneTrace.h"
+#include "RealtimeGuard.h"
+#include "MLScale.h"
+
+#include <algorithm>
 
 const int kModelDefaultCarriersSize = 40;
 const unsigned char kModelDefaultCarriers[kModelDefaultCarriersSize] =
@@ -23,6 +28,12 @@ const unsigned char kModelDefaultCarriers[kModelDefaultCarriersSize] =
 	39, 40, 41, 42, 43
 };
 
+const char* getLatencyStageName(int stage)
+{
+	static const char* kStageNames[kNumLatencyStages] = {"dequeue", "preprocess", "tracking", "zones", "send"};
+	return ((stage >= 0) && (stage < kNumLatencyStages)) ? kStageNames[stage] : "?";
+}
+
 std::string makeDefaultServiceName()
 {
 	std::stringstream nameStream;
@@ -51,33 +62,37 @@ static void makeStandardCarrierSet(SoundplaneDriver::Carriers &carriers, int set
 	}
 }
 
-void touchArrayToFrame(const TouchArray* pArray, ml::Matrix* pFrame)
+// copy the history columns of a frame of touches to the rows of a signal.
+void touchFrameToSignal(const TouchFrame& touches, ml::Matrix& out)
 {
-	// get references for syntax
-	const TouchArray& array = *pArray;
-	ml::Matrix& frame = *pFrame;
-	
+	float* pOut = out.getBuffer();
+	std::copy(touches.x, touches.x + kMaxTouches, pOut + out.row(xRow));
+	std::copy(touches.y, touches.y + kMaxTouches, pOut + out.row(yRow));
+	std::copy(touches.z, touches.z + kMaxTouches, pOut + out.row(zRow));
+	std::copy(touches.dz, touches.dz + kMaxTouches, pOut + out.row(dzRow));
+	float* pAge = pOut + out.row(ageRow);
 	for(int i = 0; i < kMaxTouches; ++i)
 	{
-		Touch t = array[i];
-		frame(xColumn, i) = t.x;
-		frame(yColumn, i) = t.y;
-		frame(zColumn, i) = t.z;
-		frame(dzColumn, i) = t.dz;
-		frame(ageColumn, i) = t.age;
+		pAge[i] = touches.age[i];
 	}
 }
 
 ml::Matrix sensorFrameToSignal(const SensorFrame &f)
 {
 	ml::Matrix out(SensorGeometry::width, SensorGeometry::height);
+	sensorFrameToSignal(f, out);
+	return out;
+}
+
+// copy into an existing Matrix of the sensor's dimensions, without allocating.
+void sensorFrameToSignal(const SensorFrame &f, ml::Matrix& out)
+{
 	for(int j = 0; j < SensorGeometry::height; ++j)
 	{
 		const float* srcStart = f.data() + SensorGeometry::width*j;
 		const float* srcEnd = srcStart + SensorGeometry::width;
 		std::copy(srcStart, srcEnd, out.getBuffer() + out.row(j));
 	}
-	return out;
 }
 
 SensorFrame signalToSensorFrame(const ml::Matrix& in)
@@ -102,12 +117,12 @@ mSurface(SensorGeometry::width, SensorGeometry::height),
 mRawSignal(SensorGeometry::width, SensorGeometry::height),
 mCalibratedSignal(SensorGeometry::width, SensorGeometry::height),
 mSmoothedSignal(SensorGeometry::width, SensorGeometry::height),
+mCalibratedMatrix(SensorGeometry::width, SensorGeometry::height),
 mCalibrating(false),
 mTestTouchesOn(false),
 mTestTouchesWasOn(false),
 mSelectingCarriers(false),
 mHasCalibration(false),
-mZoneIndexMap(kSoundplaneAKeyWidth, kSoundplaneAKeyHeight),
 mHistoryCtr(0),
 mCarrierMaskDirty(false),
 mNeedsCarriersSet(false),
@@ -132,7 +147,10 @@ mKymaMode(false)
 		mCarriers[car] = kModelDefaultCarriers[car];
 	}
 	
-	clearZones();
+	mBaseline.setSampleRate(kSoundplaneFrameRate);
+	
+	mZoneMap = std::make_shared< ZoneMap >();
+	MLScale::setRootPath(getDefaultFileLocation(kScaleFiles, MLProjectInfo::makerName, MLProjectInfo::projectName).getFullPathName());
 	setAllPropertiesToDefaults();
 	
 	MLConsole() << "SoundplaneModel: listening for OSC on port " << kDefaultUDPReceivePort << "...\n";
@@ -140,27 +158,45 @@ mKymaMode(false)
 	
 	mMIDIOutput.initialize();
 	
-	mTouchFrame.setDims(kSoundplaneTouchWidth, kMaxTouches);
-	mTouchHistory.setDims(kSoundplaneTouchWidth, kMaxTouches, kSoundplaneHistorySize);
+	mTouchFrame.setDims(kMaxTouches, kNumTouchSignalRows);
+	mTouchFrameWorking.setDims(kMaxTouches, kNumTouchSignalRows);
+	mTouchHistory.setDims(kMaxTouches, kNumTouchSignalRows, kSoundplaneHistorySize);
 	
 	// make zone presets collection
 	File zoneDir = getDefaultFileLocation(kPresetFiles, MLProjectInfo::makerName, MLProjectInfo::projectName).getChildFile("ZonePresets");
 	debug() << "LOOKING for zones in " << zoneDir.getFileName() << "\n";
 	mZonePresets = std::unique_ptr<MLFileCollection>(new MLFileCollection("zone_preset", zoneDir, "json"));
-	mZonePresets->processFilesImmediate();
+	
+	// index and compile the presets in the background. The compiled presets are cached
+	// in the app data folder, so only new or changed files are parsed at startup.
+	File zoneCache = getDefaultFileLocation(kAppPresetFiles, MLProjectInfo::makerName, MLProjectInfo::projectName).getChildFile("ZonePresets.cache");
+	mZonePresetIndex = std::unique_ptr<ZonePresetIndex>(new ZonePresetIndex(zoneCache));
+	mZonePresets->addListener(mZonePresetIndex.get());
+	mZonePresets->processFilesInBackground();
 	//mZonePresets->dump();
 	
+	File calibrationDir = getDefaultFileLocation(kAppPresetFiles, MLProjectInfo::makerName, MLProjectInfo::projectName).getChildFile("Calibrations");
+	mCalibrationStore = std::unique_ptr<CalibrationStore>(new CalibrationStore(calibrationDir));
+	
 	// now that the driver is active, start polling for changes in properties
 	mTerminating = false;
 	
 	startModelTimer();
 	
-	mSensorFrameQueue = std::unique_ptr< Queue<SensorFrame> >(new Queue<SensorFrame>(kSensorFrameQueueSize));
+	mSensorFrameQueue = std::unique_ptr< Queue<InputFrame> >(new Queue<InputFrame>(kSensorFrameQueueSize));
 	
 	mProcessThread = std::thread(&SoundplaneModel::processThread, this);
 	SetPriorityRealtimeAudio(mProcessThread.native_handle());
 	
+	mCalibrationFileTimer.start([&](){ doCalibrationFileTasks(); }, milliseconds(100));
+	
 	mpDriver->start();
+	
+	// write out traces requested by the process thread from a lower-priority thread.
+	if(SoundplaneTrace::kCompiledIn)
+	{
+		mTraceTimer.start([&](){ dumpTraceIfRequested(); }, milliseconds(1000));
+	}
 }
 
 SoundplaneModel::~SoundplaneModel()
@@ -246,6 +282,7 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const ml::Value & new
 			else if (p == "data_rate")
 			{
 				mDataRate = v;
+				mOutputClock.setRate(v);
 				mOSCOutput.setDataRate(v);
 				mMIDIOutput.setDataRate(v);
 			}
@@ -261,9 +298,22 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const ml::Value & new
 			{
 				mMIDIOutput.setMPEExtended(bool(v));
 			}
+			else if ((p == "midi_mpe_lower") || (p == "midi_mpe_upper"))
+			{
+				mMIDIOutput.setMPEZones(getFloatProperty("midi_mpe_lower"), getFloatProperty("midi_mpe_upper"));
+			}
+			else if (p == "midi_mpe_steal")
+			{
+				mMIDIOutput.setStealMode(int(v));
+			}
 			else if (p == "midi_channel")
 			{
 				mMIDIOutput.setStartChannel(int(v));
+				mUMPOutput.setChannel(int(v));
+			}
+			else if (p == "midi_dejitter")
+			{
+				mMIDIOutput.setDejitter(bool(v));
 			}
 			else if (p == "midi_pressure_active")
 			{
@@ -279,6 +329,44 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const ml::Value & new
 				bool b = v;
 				mSendMatrixData = b;
 			}
+			else if (p == "osc_matrix_rate")
+			{
+				mOSCOutput.setMatrixRate(v);
+			}
+			else if (p == "osc_matrix_decimation")
+			{
+				mOSCOutput.setMatrixDecimation(int(v));
+			}
+			else if (p == "osc_matrix_format")
+			{
+				mOSCOutput.setMatrixFormat(int(v));
+			}
+			else if (p == "ump_active")
+			{
+				mUMPOutput.setActive(bool(v));
+			}
+			else if (p == "thin_active")
+			{
+				sendParametersToThinner(true);
+			}
+			else if ((p == "thin_pitch_cents") || (p == "thin_z_steps") || (p == "thin_xy_steps")
+				|| (p == "thin_interval") || (p == "thin_min_interval"))
+			{
+				sendParametersToThinner(false);
+			}
+			else if (p == "shm_active")
+			{
+				mShmOutput.setActive(bool(v));
+			}
+			else if (p == "shm_send_sensor")
+			{
+				mShmSendSensor = bool(v);
+			}
+			else if (p == "osc_send_stats")
+			{
+				bool b = v;
+				mSendStats = b;
+			}
 			else if (p == "quantize")
 			{
 				sendParametersToZones();
@@ -293,8 +381,17 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const ml::Value & new
 				mMIDIOutput.setGlissando(bool(v));
 				sendParametersToZones();
 			}
+			else if (p == "z_scale")
+			{
+				mZScale = v;
+			}
+			else if (p == "z_curve")
+			{
+				mZCurve = v;
+			}
 			else if (p == "hysteresis")
 			{
+				mHysteresis = v;
 				mMIDIOutput.setHysteresis(v);
 				sendParametersToZones();
 			}
@@ -307,11 +404,25 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const ml::Value & new
 				mMIDIOutput.setBendRange(v);
 				sendParametersToZones();
 			}
+			else if (p == "track_baseline")
+			{
+				bool b = v;
+				mTrackBaseline = b;
+			}
 			else if (p == "verbose")
 			{
 				bool b = v;
 				mVerbose = b;
 			}
+			else if (p == "trace")
+			{
+				bool b = v;
+				if(b && !SoundplaneTrace::kCompiledIn)
+				{
+					MLConsole() << "tracing is not available in this build.\n";
+				}
+				SoundplaneTrace::setEnabled(b);
+			}
 			else if (p == "override_carriers")
 			{
 				bool b = v;
@@ -385,9 +496,52 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const ml::Value & new
 			{
 				mMIDIOutput.setDevice(str);
 			}
+			else if (p == "ump_device")
+			{
+				// switch to the loopback first, so the process thread is done with the
+				// device before it is closed or reopened.
+				mUMPOutput.setTransport(&mUMPLoopback);
+				if(str.empty())
+				{
+					mUMPDevice.close();
+				}
+				else if(mUMPDevice.open(str))
+				{
+					MLConsole() << "UMP output: sending to " << str << "\n";
+					mUMPOutput.setTransport(&mUMPDevice);
+				}
+				else
+				{
+					MLConsole() << "UMP output: could not open " << str << ", using loopback.\n";
+				}
+			}
+			else if (p == "osc_destinations")
+			{
+				// more OSC receivers as a JSON list, see OSCDestination.h.
+				std::vector< OSCDestination > dests;
+				if(!str.empty() && !parseOSCDestinations(str, dests))
+				{
+					MLConsole() << "osc_destinations: could not parse destination list.\n";
+				}
+				mOSCOutput.clear();
+				mOSCOutput.setDestinations(dests);
+				if(!mOSCOutput.getHostName().empty())
+				{
+					mOSCOutput.reconnect();
+				}
+			}
 			else if (p == "zone_JSON")
 			{
-				loadZonesFromString(str);
+				// a preset chosen from the menu has been compiled already.
+				if(mSelectedZonePreset && (mSelectedZonePreset->json == str))
+				{
+					loadZonesFromPreset(*mSelectedZonePreset);
+				}
+				else
+				{
+					loadZonesFromString(str);
+				}
+				mSelectedZonePreset.reset();
 			}
 			else if (p == "zone_preset")
 			{
@@ -404,15 +558,33 @@ void SoundplaneModel::doPropertyChangeAction(ml::Symbol p, const ml::Value & new
 				{
 					setProperty("zone_JSON", (SoundplaneBinaryData::rows_in_octaves_json));
 				}
-				// if not built in, load a zone map file.
+				// if not built in, use the compiled preset from the index. If it has not
+				// been indexed yet, or the file or its scales have changed since, read
+				// and compile the file.
 				else
 				{
+					std::shared_ptr< const ZonePreset > pPreset = mZonePresetIndex->find(str);
 					const MLFile& f = mZonePresets->getFileByPath(str);
 					if(f.exists())
 					{
-						File zoneFile = f.getJuceFile();
-						String stateStr(zoneFile.loadFileAsString());
-						setPropertyImmediate("zone_JSON", (stateStr.toUTF8()));
+						int64_t fileTime = f.getJuceFile().getLastModificationTime().toMilliseconds();
+						if(!pPreset || !zonePresetIsCurrent(*pPreset, fileTime))
+						{
+							pPreset = nullptr;
+							std::shared_ptr< ZonePreset > pNew = std::make_shared< ZonePreset >();
+							String stateStr(f.getJuceFile().loadFileAsString());
+							if(compileZonePreset(std::string(stateStr.toUTF8()), *pNew))
+							{
+								pNew->fileTime = fileTime;
+								pPreset = pNew;
+								mZonePresetIndex->replace(str, pPreset);
+							}
+						}
+					}
+					if(pPreset)
+					{
+						mSelectedZonePreset = pPreset;
+						setPropertyImmediate("zone_JSON", pPreset->json.c_str());
 					}
 				}
 			}
@@ -450,17 +622,21 @@ void SoundplaneModel::onStartup()
 	
 	// connected but not calibrated -- disable output.
 	enableOutput(false);
-	// output will be enabled at end of calibration.
+	// output will be enabled when a saved calibration is loaded, or at end of calibration.
 	mNeedsCalibrate = true;
 }
 
 // we need to return as quickly as possible from driver callback.
-// just put the new frame in the queue.
+// just put the new frame in the queue, tagged with its arrival time.
 void SoundplaneModel::onFrame(const SensorFrame& frame)
 {
+	mMetrics.increment(kMetricFramesReceived);
 	if(!mTestTouchesOn)
 	{
-		mSensorFrameQueue->push(frame);
+		if(!mSensorFrameQueue->push(InputFrame{frame, steady_clock::now()}))
+		{
+			mMetrics.increment(kMetricFramesDropped);
+		}
 	}
 }
 
@@ -469,26 +645,31 @@ void SoundplaneModel::onError(int error, const char* errStr)
 	switch(error)
 	{
 		case kDevDataDiffTooLarge:
+			mMetrics.increment(kMetricDataDiffErrors);
 			MLConsole() << "error: frame difference too large: " << errStr << "\n";
 			beginCalibrate();
 			break;
 		case kDevGapInSequence:
+			mMetrics.increment(kMetricSequenceGaps);
 			if(mVerbose)
 			{
 				MLConsole() << "note: gap in sequence " << errStr << "\n";
 			}
 			break;
 		case kDevReset:
+			mMetrics.increment(kMetricDeviceResets);
 			if(mVerbose)
 			{
 				MLConsole() << "isoch stalled, resetting " << errStr << "\n";
 			}
 			break;
 		case kDevPayloadFailed:
+			mMetrics.increment(kMetricPayloadFailures);
 			if(mVerbose)
 			{
 				MLConsole() << "payload failed at sequence " << errStr << "\n";
 			}
+			break;
     case kDevNoInterface:
       MLConsole() << "error: could not create device interface: " << errStr << "\n";
       break;
@@ -512,20 +693,25 @@ void SoundplaneModel::onClose()
 
 void SoundplaneModel::processThread()
 {
+	SP_TRACE_THREAD("process");
 	time_point<system_clock> previous, now;
 	previous = now = system_clock::now();
-	mPrevProcessTouchesTime = now; // TODO interval timer object
 	
 	while(!mTerminating)
 	{
 		now = system_clock::now();
-		process(now);
+		{
+			SP_REALTIME_SCOPE();
+			process(now);
+			sendScheduledFrame();
+		}
 		mProcessCounter++;
 		
 		size_t queueSize = mSensorFrameQueue->elementsAvailable();
 		if(queueSize > mMaxRecentQueueSize)
 		{
 			mMaxRecentQueueSize = queueSize;
+			mMetrics.updateMax(kMetricQueueHighWater, queueSize);
 		}
 		
 		if(mProcessCounter >= 1000)
@@ -542,8 +728,13 @@ void SoundplaneModel::processThread()
 			mMaxRecentQueueSize = 0;
 		}
 		
-		// sleep, less than one frame interval
-		std::this_thread::sleep_for(std::chrono::microseconds(500));
+		// sleep, less than one frame interval, waking for the next output boundary.
+		time_point<steady_clock> wake = steady_clock::now() + microseconds(500);
+		if(mOutputClock.getNextBoundary() < wake)
+		{
+			wake = mOutputClock.getNextBoundary();
+		}
+		std::this_thread::sleep_until(wake);
 		
 		// do infrequent tasks every second
 		int secondsInterval = duration_cast<seconds>(now - previous).count();
@@ -558,31 +749,54 @@ void SoundplaneModel::processThread()
 
 void SoundplaneModel::process(time_point<system_clock> now)
 {
+	SP_TRACE_SCOPE("process");
 	static int tc = 0;
 	tc++;
 	
-	TouchArray touches{};
+	installPendingZoneMap(now);
+	installPendingCalibration();
+	installPendingThinnerParameters();
+	
 	if(mTestTouchesOn || mTestTouchesWasOn)
 	{
-		touches = getTestTouchesFromTracker(now);
+		mFrameArrivalTime = steady_clock::now();
+		getTestTouchesFromTracker(now, mTouches0);
 		mTestTouchesWasOn = mTestTouchesOn;
-		outputTouches(touches, now);
+		outputTouches(mTouches0, now);
 	}
 	else
 	{
-		if(mSensorFrameQueue->pop(mSensorFrame))
+		if(mSensorFrameQueue->pop(mInputFrame))
 		{
-			mSurface = sensorFrameToSignal(mSensorFrame);
+			const SensorFrame& frame = mInputFrame.data;
+			mFrameArrivalTime = mInputFrame.arrivalTime;
+			recordLatency(kLatencyDequeue);
+			mMetrics.increment(kMetricFramesProcessed);
 			
-			// store surface for raw output
+			// output time is the frame's arrival time, not the time we got around to processing it.
+			time_point<system_clock> frameTime = system_clock::now() - duration_cast<system_clock::duration>(steady_clock::now() - mFrameArrivalTime);
+			
+			// calibration and carrier selection frames are not played, so they have no deadline.
+			// Checked before processing, because the last frame of either ends it.
+			const bool measuring = mCalibrating || mSelectingCarriers;
+			
+			sensorFrameToSignal(frame, mSurface);
+			
+			// store surface for raw output. If the UI is reading it, skip this frame.
 			{
-				std::lock_guard<std::mutex> lock(mRawSignalMutex);
-				mRawSignal.copy(mSurface);
+				std::unique_lock<std::mutex> lock(mRawSignalMutex, std::try_to_lock);
+				if(lock.owns_lock())
+				{
+					mRawSignal.copy(mSurface);
+				}
 			}
 			
 			if(mCalibrating)
 			{
-				mStats.accumulate(mSensorFrame);
+				// calibration steps print and allocate, and are not time-critical.
+				SP_REALTIME_ALLOW();
+				SP_TRACE_SCOPE("calibrate");
+				mStats.accumulate(frame);
 				if (mStats.getCount() >= kSoundplaneCalibrateSize)
 				{
 					endCalibrate();
@@ -590,7 +804,9 @@ void SoundplaneModel::process(time_point<system_clock> now)
 			}
 			else if (mSelectingCarriers)
 			{
-				mStats.accumulate(mSensorFrame);
+				SP_REALTIME_ALLOW();
+				SP_TRACE_SCOPE("selectCarriers");
+				mStats.accumulate(frame);
 				
 				if (mStats.getCount() >= kSoundplaneCalibrateSize)
 				{
@@ -601,119 +817,190 @@ void SoundplaneModel::process(time_point<system_clock> now)
 			{
 				if (mHasCalibration)
 				{
-					mCalibratedFrame = subtract(multiply(mSensorFrame, mCalibrateMeanInv), 1.0f);
+					mCalibratedFrame = subtract(multiply(frame, mCalibrateMeanInv), 1.0f);
+					{
+						std::unique_lock<std::mutex> lock(mCalibratedSignalMutex, std::try_to_lock);
+						if(lock.owns_lock())
+						{
+							sensorFrameToSignal(mCalibratedFrame, mCalibratedSignal);
+						}
+					}
+					
+					trackTouches(mCalibratedFrame, mTouches0);
+					outputTouches(mTouches0, frameTime);
+					
+					// the new mean is used from the next frame on.
+					if(mTrackBaseline && mBaseline.process(frame, mTouches0))
+					{
+						SensorFrame mean = clamp(mBaseline.getMean(), 0.0001f, 1.f);
+						mCalibrateMeanInv = divide(fill(1.f), mean);
+						mMetrics.increment(kMetricBaselineUpdates);
+					}
 					
-					TouchArray touches = trackTouches(mCalibratedFrame);
-					outputTouches(touches, now);
+					// check a saved calibration against frames with nothing touching.
+					if(mValidatingCalibration && !mTouches0.masks.active)
+					{
+						mStats.accumulate(frame);
+						if(mStats.getCount() >= kSoundplaneCalibrateSize)
+						{
+							endValidateCalibration();
+						}
+					}
+				}
+			}
+			
+			if(!measuring && (steady_clock::now() - mFrameArrivalTime > kFrameDeadline))
+			{
+				mMetrics.increment(kMetricDeadlineMisses);
+				
+				// when tracing, capture the timeline around the late frame.
+				if(SoundplaneTrace::isEnabled())
+				{
+					mTraceDumpRequested = true;
 				}
 			}
 		}
 	}
 }
 
-void SoundplaneModel::outputTouches(TouchArray touches, time_point<system_clock> now)
+void SoundplaneModel::outputTouches(const TouchFrame& touches, time_point<system_clock> now)
 {
 	saveTouchHistory(touches);
 	
 	// let Zones process touches. This is always done at the controller's frame rate.
 	sendTouchesToZones(touches);
+	recordLatency(kLatencyZones);
 	
 	// determine if incoming frame could start or end a touch
-	bool notesChangedThisFrame = findNoteChanges(touches, mTouchArray1);
-	mTouchArray1 = touches;
+	bool notesChangedThisFrame = findNoteChanges(touches.masks, mTouches1.masks);
+	mTouches1 = touches;
+	mLastTrackerTime = steady_clock::now();
 	
-	const int dataPeriodMicrosecs = 1000*1000 / mDataRate;
-	int microsSinceSend = duration_cast<microseconds>(now - mPrevProcessTouchesTime).count();
-	bool timeForNewFrame = (microsSinceSend >= dataPeriodMicrosecs);
-	if(notesChangedThisFrame || timeForNewFrame || mRequireSendNextFrame)
+	// note changes go out right away. Everything else waits for the output clock.
+	if(notesChangedThisFrame || mRequireSendNextFrame)
 	{
 		mRequireSendNextFrame = false;
-		mPrevProcessTouchesTime = now;
 		sendFrameToOutputs(now);
+		recordLatency(kLatencySend);
+		mHeldFrameSent = true;
+	}
+	else
+	{
+		mHeldFrameSent = false;
+	}
+}
+
+// on each boundary of the output clock, send the newest state of the Zones, stamped with the
+// boundary time so that receivers see an even frame rate. Between tracker frames the state is
+// held and sent again.
+//
+void SoundplaneModel::sendScheduledFrame()
+{
+	time_point<steady_clock> boundary;
+	time_point<steady_clock> steadyNow = steady_clock::now();
+	int boundaries = mOutputClock.tick(steadyNow, boundary);
+	if(!boundaries) return;
+	for(int i=1; i<boundaries; ++i)
+	{
+		mMetrics.increment(kMetricClockSlips);
+	}
+	
+	// output is stopped, or the input has gone away.
+	if(steadyNow - mLastTrackerTime > kHeldFrameLimit) return;
+	
+	time_point<system_clock> frameTime = system_clock::now() - duration_cast<system_clock::duration>(steadyNow - boundary);
+	sendFrameToOutputs(frameTime, mHeldFrameSent);
+	
+	// a held frame sent again has no new arrival time to measure from.
+	if(!mHeldFrameSent)
+	{
+		recordLatency(kLatencySend);
 	}
+	mHeldFrameSent = true;
 }
 
 // send raw touches to zones in order to generate touch and controller states within the Zones.
 //
-void SoundplaneModel::sendTouchesToZones(TouchArray touches)
+void SoundplaneModel::sendTouchesToZones(const TouchFrame& touches)
 {
+	SP_TRACE_SCOPE("sendTouchesToZones");
 	// const int maxTouches = getFloatProperty("max_touches");
-	const float hysteresis = getFloatProperty("hysteresis");
+	const float hysteresis = mHysteresis;
+	ZoneMap& zoneMap = *mZoneMap;
 	
 	// clear incoming touches and push touch history in each zone
-	for(auto& zone : mZones)
+	for(auto& zone : zoneMap.zones)
 	{
 		zone.newFrame();
 	}
 	
-	// add any active touches to the Zones they are over
-	// MLTEST for(int i=0; i<maxTouches; ++i)
-	
-	// iterate on all possible touches so touches will turn off when max_touches is lowered
-	for(int i=0; i<kMaxTouches; ++i)
+	// add any active touches to the Zones they are over. The mask covers all possible
+	// touches, so touches will turn off when max_touches is lowered.
+	forEachTouch(touches.masks.active, [&](int i)
 	{
-		float x = touches[i].x;
-		float y = touches[i].y;
+		float x = touches.x[i];
+		float y = touches.y[i];
 		
-		if(touchIsActive(touches[i]))
+		//std::cout << i << ":" << age << "\n";
+		// get fractional key grid position (Soundplane A)
+		Vec2 keyXY (x, y);
+		
+		// get integer key
+		int ix = (int)x;
+		int iy = (int)y;
+		
+		// apply hysteresis to raw position to get current key
+		// hysteresis: make it harder to move out of current key
+		if(touches.state[i] == kTouchStateOn)
 		{
-			//std::cout << i << ":" << age << "\n";
-			// get fractional key grid position (Soundplane A)
-			Vec2 keyXY (x, y);
-			
-			// get integer key
-			int ix = (int)x;
-			int iy = (int)y;
-			
-			// apply hysteresis to raw position to get current key
-			// hysteresis: make it harder to move out of current key
-			if(touches[i].state == kTouchStateOn)
+			mCurrentKeyX[i] = ix;
+			mCurrentKeyY[i] = iy;
+		}
+		else
+		{
+			float hystWidth = hysteresis*0.25f;
+			MLRect currentKeyRect(mCurrentKeyX[i], mCurrentKeyY[i], 1, 1);
+			currentKeyRect.expand(hystWidth);
+			if(!currentKeyRect.contains(keyXY))
 			{
 				mCurrentKeyX[i] = ix;
 				mCurrentKeyY[i] = iy;
 			}
-			else
-			{
-				float hystWidth = hysteresis*0.25f;
-				MLRect currentKeyRect(mCurrentKeyX[i], mCurrentKeyY[i], 1, 1);
-				currentKeyRect.expand(hystWidth);
-				if(!currentKeyRect.contains(keyXY))
-				{
-					mCurrentKeyX[i] = ix;
-					mCurrentKeyY[i] = iy;
-				}
-			}
-			
-			// send index, xyz, dz to zone
-			int zoneIdx = mZoneIndexMap(mCurrentKeyX[i], mCurrentKeyY[i]);
-			if((zoneIdx >= 0) && (zoneIdx < mZones.size()))
-			{
-				Touch t = touches[i];
-				t.kx = mCurrentKeyX[i];
-				t.ky = mCurrentKeyY[i];
-				mZones[zoneIdx].addTouchToFrame(i, t);
-			}
 		}
-	}
+		
+		// send index, xyz, dz to each zone over the key
+		Touch t = touches[i];
+		t.kx = mCurrentKeyX[i];
+		t.ky = mCurrentKeyY[i];
+		zoneMap.getZonesAtKey(t.kx, t.ky).forEach([&](int zoneIdx)
+		{
+			zoneMap.zones[zoneIdx].addTouchToFrame(i, t);
+		});
+	});
 	
-	for(auto& zone : mZones)
+	for(auto& zone : zoneMap.zones)
 	{
 		zone.storeAnyNewTouches();
 	}
 	
-	std::bitset<kMaxTouches> freedTouches;
+	// touches ended by a new layout retrigger like touches moving from zone to zone.
+	std::bitset<kMaxTouches> freedTouches = mTouchesFreedBySwap;
+	mTouchesFreedBySwap.reset();
 	
 	// process note offs for each zone
 	// this happens before processTouches() to allow touches to be freed for reuse in this frame
-	for(auto& zone : mZones)
+	for(auto& zone : zoneMap.zones)
 	{
 		zone.processTouchesNoteOffs(freedTouches);
 	}
 	
-	// process touches for each zone
-	for(auto& zone : mZones)
+	// process touches for each zone, all the zones of each type together
+	for(const auto& zones : zoneMap.zonesByType)
 	{
-		zone.processTouches(freedTouches);
+		for(int zoneIdx : zones)
+		{
+			zoneMap.zones[zoneIdx].processTouches(freedTouches);
+		}
 	}
 }
 
@@ -721,17 +1008,9 @@ void SoundplaneModel::dumpOutputsByZone()
 {
 	// count touches in zones
 	int activeTouches = 0;
-	for(auto& zone : mZones)
+	for(auto& zone : mZoneMap->zones)
 	{
-		// touches
-		for(int i=0; i<kMaxTouches; ++i)
-		{
-			Touch t = zone.mOutputTouches[i];
-			if(touchIsActive(t))
-			{
-				activeTouches++;
-			}
-		}
+		activeTouches += countTouches(zone.getOutputMask());
 	}
 	
 	if(activeTouches)
@@ -739,7 +1018,7 @@ void SoundplaneModel::dumpOutputsByZone()
 		int zc = 0;
 		
 		// send messages to outputs about each zone
-		for(auto& zone : mZones)
+		for(auto& zone : mZoneMap->zones)
 		{
 			
 			std::cout << "[zone " << zc++ << ": ";
@@ -760,93 +1039,111 @@ void SoundplaneModel::dumpOutputsByZone()
 	}
 }
 
-void SoundplaneModel::sendFrameToOutputs(time_point<system_clock> now)
+void SoundplaneModel::sendFrameToOutputs(time_point<system_clock> now, bool repeat)
 {
+	SP_TRACE_SCOPE("sendFrameToOutputs");
 	beginOutputFrame(now);
 	
-	// send messages to outputs about each zone
-	for(auto& zone : mZones)
+	sendZonesToOutputs(*mZoneMap, now, repeat);
+	
+	// send optional calibrated matrix to OSC output
+	if(mSendMatrixData && mOSCOutput.isMatrixFrameDue())
+	{
+		// send to OSC output only
+		sensorFrameToSignal(mCalibratedFrame, mCalibratedMatrix);
+		mOSCOutput.processMatrix(mCalibratedMatrix);
+	}
+	
+	if(mShmSendSensor && mShmOutput.isActive())
+	{
+		mShmOutput.processSensorFrame(mCalibratedFrame);
+	}
+	
+	endOutputFrame();
+}
+
+// send messages to outputs about each zone. If repeat is set, the Zones' state has been sent
+// before: touches that started are continued and touches that ended are not sent again.
+//
+void SoundplaneModel::sendZonesToOutputs(ZoneMap& zoneMap, time_point<system_clock> now, bool repeat)
+{
+	for(auto& zone : zoneMap.zones)
 	{
 		// touches
-		for(int i=0; i<kMaxTouches; ++i)
+		forEachTouch(zone.getOutputMask(), [&](int i)
 		{
 			Touch t = zone.mOutputTouches[i];
-			if(touchIsActive(t))
+			if(repeat)
 			{
-				sendTouchToOutputs(i, zone.mOffset, t);
+				if(t.state == kTouchStateOff) return;
+				if(t.state == kTouchStateOn)
+				{
+					t.state = kTouchStateContinue;
+				}
 			}
-		}
+			if(mThinTouches)
+			{
+				t = mThinner.process(i, t, now);
+			}
+			sendTouchToOutputs(i, zone.mOffset, t);
+		});
 		
 		// controllers
 		//if(zone.mOutputController.active)
 		
-		if(isControllerZoneType(zone.mType))
+		if(zone.isController())
 		{
 			sendControllerToOutputs(zone.mZoneID, zone.mOffset, zone.mOutputController);
 		}
-		
-		
-	}
-	
-	// send optional calibrated matrix to OSC output
-	if(mSendMatrixData)
-	{
-		ml::Matrix calibratedPressure = getCalibratedSignal();
-		if(calibratedPressure.getHeight() == SensorGeometry::height)
-		{
-			// send to OSC output only
-			mOSCOutput.processMatrix(calibratedPressure);
-		}
 	}
-	
-	endOutputFrame();
 }
 
 void SoundplaneModel::beginOutputFrame(time_point<system_clock> now)
 {
-	if(mMIDIOutput.isActive())
-	{
-		mMIDIOutput.beginOutputFrame(now);
-	}
-	if(mOSCOutput.isActive())
+	for(SoundplaneOutput* pOutput : mOutputs)
 	{
-		mOSCOutput.beginOutputFrame(now);
+		if(pOutput->isActive())
+		{
+			pOutput->beginOutputFrame(now);
+		}
 	}
 }
 
 void SoundplaneModel::sendTouchToOutputs(int i, int offset, const Touch& t)
 {
-	if(mMIDIOutput.isActive())
-	{
-		mMIDIOutput.processTouch(i, offset, t);
-	}
-	if(mOSCOutput.isActive())
+	for(SoundplaneOutput* pOutput : mOutputs)
 	{
-		mOSCOutput.processTouch(i, offset, t);
+		if(pOutput->isActive())
+		{
+			pOutput->processTouch(i, offset, t);
+		}
 	}
 }
 
 void SoundplaneModel::sendControllerToOutputs(int zoneID, int offset, const ZoneMessage& m)
 {
-	if(mMIDIOutput.isActive())
+	for(SoundplaneOutput* pOutput : mOutputs)
 	{
-		mMIDIOutput.processController(zoneID, offset, m);
-	}
-	if(mOSCOutput.isActive())
-	{
-		mOSCOutput.processController(zoneID, offset, m);
+		if(pOutput->isActive())
+		{
+			pOutput->processController(zoneID, offset, m);
+		}
 	}
 }
 
 void SoundplaneModel::endOutputFrame()
 {
-	if(mMIDIOutput.isActive())
+	for(size_t i=0; i<mOutputs.size(); ++i)
 	{
-		mMIDIOutput.endOutputFrame();
-	}
-	if(mOSCOutput.isActive())
-	{
-		mOSCOutput.endOutputFrame();
+		SoundplaneOutput* pOutput = mOutputs[i];
+		if(pOutput->isActive())
+		{
+			pOutput->endOutputFrame();
+			if(pOutput->sentFrame())
+			{
+				mMetrics.increment(mOutputFrameMetrics[i]);
+			}
+		}
 	}
 }
 
@@ -871,7 +1168,11 @@ void SoundplaneModel::setAllPropertiesToDefaults()
 	setProperty("midi_active", 0);
 	setProperty("midi_mpe", 1);
 	setProperty("midi_mpe_extended", 0);
+	setProperty("midi_mpe_lower", 15);
+	setProperty("midi_mpe_upper", 0);
+	setProperty("midi_mpe_steal", 1);
 	setProperty("midi_channel", 1);
+	setProperty("midi_dejitter", 0);
 	
 	setProperty("data_rate", 250.);
 	
@@ -884,6 +1185,22 @@ void SoundplaneModel::setAllPropertiesToDefaults()
 
 	setProperty("osc_active", 1);
 	setProperty("osc_raw", 0);
+	setProperty("osc_matrix_rate", 0);
+	setProperty("osc_matrix_decimation", 1);
+	setProperty("osc_matrix_format", 0);
+	setProperty("osc_send_stats", 0);
+	setProperty("osc_destinations", "");
+	setProperty("thin_active", 0);
+	setProperty("thin_pitch_cents", 2.);
+	setProperty("thin_z_steps", 1.);
+	setProperty("thin_xy_steps", 1.);
+	setProperty("thin_interval", 50);
+	setProperty("thin_min_interval", 2);
+	setProperty("ump_active", 0);
+	setProperty("ump_device", "");
+	setProperty("shm_active", 0);
+	setProperty("shm_send_sensor", 0);
+	setProperty("trace", 0);
 	
 	setProperty("bend_range", 48);
 	setProperty("transpose", 0);
@@ -891,6 +1208,7 @@ void SoundplaneModel::setAllPropertiesToDefaults()
 	
 	setProperty("hysteresis", 0.5);
 	setProperty("lo_thresh", 0.1);
+	setProperty("track_baseline", 1);
 	
 	// menu param defaults
 	setProperty("viewmode", "calibrated");
@@ -929,6 +1247,17 @@ void SoundplaneModel::ProcessMessage(const osc::ReceivedMessage& m, const IpEndp
 			
 			mKymaIsConnected = true;
 		}
+		else if (std::strcmp( m.AddressPattern(), "/t3d/metrics" ) == 0 )
+		{
+			// reply to the sender, on the port given as an optional argument.
+			int replyPort = remoteEndpoint.port;
+			if(!args.Eos())
+			{
+				args >> a1;
+				replyPort = a1;
+			}
+			sendMetrics(IpEndpointName(remoteEndpoint.address, replyPort));
+		}
 		else if (std::strcmp( m.AddressPattern(), "/osc/notify/midi/Soundplane" ) == 0 )
 		{
 			args >> a1 >> osc::EndMessage;
@@ -954,6 +1283,66 @@ void SoundplaneModel::ProcessMessage(const osc::ReceivedMessage& m, const IpEndp
 	}
 }
 
+// send all metrics in one message as pairs of (string)name (int64)value.
+void SoundplaneModel::sendMetrics(const IpEndpointName& destination)
+{
+	const int kMetricsBufferSize = 1024;
+	char buf[kMetricsBufferSize];
+	osc::OutboundPacketStream p(buf, kMetricsBufferSize);
+	p << osc::BeginMessage( "/t3d/metrics" );
+	for(int i=0; i<kNumMetrics; ++i)
+	{
+		p << SoundplaneMetrics::getName(i) << (osc::int64)mMetrics.get(i);
+	}
+	p << osc::EndMessage;
+	
+	UdpTransmitSocket socket(destination);
+	socket.Send(p.Data(), p.Size());
+}
+
+// print the metrics every so often in verbose mode, and whenever a fault
+// counter has gone up since the last check.
+void SoundplaneModel::reportMetrics()
+{
+	const int kMetricsReportInterval = 10;
+	if(++mMetricsReportCounter < kMetricsReportInterval) return;
+	mMetricsReportCounter = 0;
+	
+	uint64_t faults = 0;
+	for(int i=0; i<kNumMetrics; ++i)
+	{
+		if(SoundplaneMetrics::isFault(i))
+		{
+			faults += mMetrics.get(i);
+		}
+	}
+	
+	if(mVerbose || (faults > mPrevMetricsFaults))
+	{
+		MLConsole() << "metrics: " << mMetrics.toString() << "\n";
+	}
+	
+	if(mVerbose && mOSCOutput.isActive())
+	{
+		const UDPBatchSender& b = mOSCOutput.getBatchSender();
+		MLConsole() << "OSC: " << std::to_string(b.getDatagramCount()) << " datagrams in " << std::to_string(b.getSyscallCount()) << " sends, bytes by port:";
+		for(int i=0; i<b.getNumPorts(); ++i)
+		{
+			MLConsole() << " " << std::to_string(b.getBytesSent(i));
+		}
+		MLConsole() << ", by destination:";
+		for(int d=0; d<UDPBatchSender::kMaxDestinations; ++d)
+		{
+			if(b.hasDestination(d))
+			{
+				MLConsole() << " " << std::to_string(b.getBytesSentTo(d));
+			}
+		}
+		MLConsole() << "\n";
+	}
+	mPrevMetricsFaults = faults;
+}
+
 void SoundplaneModel::ProcessBundle(const osc::ReceivedBundle &b, const IpEndpointName& remoteEndpoint)
 {
 	
@@ -1063,123 +1452,225 @@ const char* SoundplaneModel::getClientStr()
 	return mClientStr;
 }
 
-// remove all zones from the zone list.
-void SoundplaneModel::clearZones()
+std::shared_ptr< const ZoneMap > SoundplaneModel::getZoneMap()
 {
-	mZones.clear();
-	mZoneIndexMap.fill(-1);
+	std::shared_ptr< ZoneMap > pRetired;
+	std::lock_guard<std::mutex> lock(mZoneMapMutex);
+	
+	// release any old layout here, off the process thread.
+	pRetired.swap(mRetiredZoneMap);
+	return mZoneMap;
 }
 
-void SoundplaneModel::loadZonesFromString(const std::string& zoneStr)
+// hand a new zone layout to the process thread, which installs it between frames.
+void SoundplaneModel::publishZoneMap(std::shared_ptr< ZoneMap > pZoneMap)
 {
-	clearZones();
-	cJSON* root = cJSON_Parse(zoneStr.c_str());
-	if(!root)
-	{
-		MLConsole() << "zone file parse failed!\n";
-		const char* errStr = cJSON_GetErrorPtr();
-		MLConsole() << "    error at: " << errStr << "\n";
-		return;
-	}
-	cJSON* pNode = root->child;
-	while(pNode)
+	std::shared_ptr< ZoneMap > pRetired, pUnused;
+	std::lock_guard<std::mutex> lock(mZoneMapMutex);
+	pRetired.swap(mRetiredZoneMap);
+	pUnused.swap(mPendingZoneMap);
+	mPendingZoneMap = pZoneMap;
+	mZoneMapPending.store(true, std::memory_order_release);
+}
+
+// called by the process thread between frames. Touches in the old layout are ended and
+// sent in a frame of their own. On the next frame the new zones start them again, with
+// retrigger velocities as if the touches had moved from one zone to another.
+//
+void SoundplaneModel::installPendingZoneMap(time_point<system_clock> now)
+{
+	if(mZoneMapPending.load(std::memory_order_acquire))
 	{
-		if(!strcmp(pNode->string, "zone"))
+		// if another thread has the lock or has not released the last layout yet, try next time.
+		std::unique_lock<std::mutex> lock(mZoneMapMutex, std::try_to_lock);
+		if(lock.owns_lock() && !mRetiredZoneMap)
 		{
-			mZones.emplace_back(Zone());
-			Zone* pz = &mZones.back();
-			
-			cJSON* pZoneType = cJSON_GetObjectItem(pNode, "type");
-			if(pZoneType)
+			ZoneMap& oldZones = *mZoneMap;
+			for(auto& zone : oldZones.zones)
 			{
-				// get zone type and type specific attributes
-				pz->mType = pZoneType->valuestring;
+				zone.newFrame();
 			}
-			else
+			for(auto& zone : oldZones.zones)
 			{
-				MLConsole() << "No type for zone!\n";
+				zone.processTouchesNoteOffs(mTouchesFreedBySwap);
 			}
-			
-			// get zone rect in keys
-			cJSON* pZoneRect = cJSON_GetObjectItem(pNode, "rect");
-			if(pZoneRect)
+			if(mTouchesFreedBySwap.any())
 			{
-				int size = cJSON_GetArraySize(pZoneRect);
-				if(size == 4)
-				{
-					int x = cJSON_GetArrayItem(pZoneRect, 0)->valueint;
-					int y = cJSON_GetArrayItem(pZoneRect, 1)->valueint;
-					int w = cJSON_GetArrayItem(pZoneRect, 2)->valueint;
-					int h = cJSON_GetArrayItem(pZoneRect, 3)->valueint;
-					pz->setBounds(MLRect(x, y, w, h));
-				}
-				else
-				{
-					MLConsole() << "Bad rect for zone!\n";
-				}
+				beginOutputFrame(now);
+				sendZonesToOutputs(oldZones, now, false);
+				endOutputFrame();
 			}
-			else
+			
+			mRetiredZoneMap = std::move(mZoneMap);
+			mZoneMap = std::move(mPendingZoneMap);
+			mZoneMapPending.store(false, std::memory_order_relaxed);
+			mRequireSendNextFrame = true;
+		}
+	}
+	
+	if(mZoneParametersChanged.load(std::memory_order_acquire))
+	{
+		std::unique_lock<std::mutex> lock(mZoneMapMutex, std::try_to_lock);
+		if(lock.owns_lock())
+		{
+			ZoneParameters params = mPendingZoneParameters;
+			mZoneParametersChanged.store(false, std::memory_order_relaxed);
+			lock.unlock();
+			applyParametersToZones(*mZoneMap, params);
+		}
+	}
+}
+
+// build a new zone layout from JSON. If the text can't be parsed, the current layout is kept.
+void SoundplaneModel::loadZonesFromString(const std::string& zoneStr)
+{
+	ZonePreset preset;
+	if(compileZonePreset(zoneStr, preset))
+	{
+		loadZonesFromPreset(preset);
+	}
+}
+
+// build a zone map from a compiled preset and hand it to the process thread.
+void SoundplaneModel::loadZonesFromPreset(const ZonePreset& preset)
+{
+	std::shared_ptr< ZoneMap > pZoneMap = std::make_shared< ZoneMap >();
+	ZoneMap& zoneMap = *pZoneMap;
+	for(const ZoneRecord& r : preset.zones)
+	{
+		int zoneIdx = zoneMap.zones.size();
+		if(zoneIdx >= kSoundplaneAMaxZones)
+		{
+			MLConsole() << "SoundplaneModel::loadZonesFromPreset: out of zones!\n";
+			break;
+		}
+		
+		zoneMap.zones.emplace_back(Zone());
+		Zone* pz = &zoneMap.zones.back();
+		pz->mType = r.type;
+		pz->setBounds(MLRect(r.x, r.y, r.w, r.h));
+		pz->mName = TextFragment(r.name.c_str());
+		pz->mNameSymbol = Symbol(r.name.c_str());
+		pz->mStartNote = r.note;
+		pz->mOffset = r.offset;
+		pz->mControllerNum1 = r.ctrl1;
+		pz->mControllerNum2 = r.ctrl2;
+		pz->mControllerNum3 = r.ctrl3;
+		if(!r.scaleNotes.empty())
+		{
+			pz->setScaleNotes(r.scaleNotes);
+		}
+		pz->setControllerResponse(r.smooth, r.slew, r.deadband, r.hiRes);
+		pz->setZoneID(zoneIdx);
+		zoneMap.zonesByType[pz->mType].push_back(zoneIdx);
+		
+		auto addKey = [&](int i, int j)
+		{
+			int replaced = zoneMap.addZoneAtKey(zoneIdx, i, j);
+			if(replaced >= 0)
 			{
-				MLConsole() << "No rect for zone\n";
+				MLConsole() << "zone " << pz->mName.getText() << " replaces note zone " << zoneMap.zones[replaced].mName.getText() << " at key " << i << ", " << j << "\n";
 			}
-			
-			pz->mName = TextFragment(getJSONString(pNode, "name"));
-			pz->mStartNote = getJSONInt(pNode, "note");
-			pz->mOffset = getJSONInt(pNode, "offset");
-			pz->mControllerNum1 = getJSONInt(pNode, "ctrl1");
-			pz->mControllerNum2 = getJSONInt(pNode, "ctrl2");
-			pz->mControllerNum3 = getJSONInt(pNode, "ctrl3");
-			
-			int zoneIdx = mZones.size() - 1;
-			if(zoneIdx < kSoundplaneAMaxZones)
+		};
+		if(r.keys.empty())
+		{
+			for(int j=r.y; j < r.y + r.h; ++j)
 			{
-				pz->setZoneID(zoneIdx);
-				
-				MLRect b(pz->getBounds());
-				int x = b.x();
-				int y = b.y();
-				int w = b.width();
-				int h = b.height();
-				
-				for(int j=y; j < y + h; ++j)
+				for(int i=r.x; i < r.x + r.w; ++i)
 				{
-					for(int i=x; i < x + w; ++i)
-					{
-						mZoneIndexMap(i, j) = zoneIdx;
-					}
+					addKey(i, j);
 				}
 			}
-			else
+		}
+		else
+		{
+			for(const auto& k : r.keys)
 			{
-				MLConsole() << "SoundplaneModel::loadZonesFromString: out of zones!\n";
+				addKey(k.first, k.second);
 			}
 		}
-		pNode = pNode->next;
 	}
-	sendParametersToZones();
+	applyParametersToZones(zoneMap, getZoneParameters());
+	publishZoneMap(pZoneMap);
 }
 
+// the zones in use belong to the process thread, so the parameters are read here and
+// the process thread copies them into its zones between frames.
+void SoundplaneModel::sendParametersToZones()
+{
+	ZoneParameters params = getZoneParameters();
+	std::lock_guard<std::mutex> lock(mZoneMapMutex);
+	mPendingZoneParameters = params;
+	mZoneParametersChanged.store(true, std::memory_order_release);
+}
+
+// the thinner belongs to the process thread, so its settings are read here and the
+// process thread applies them between frames, like the zone parameters.
+void SoundplaneModel::sendParametersToThinner(bool clear)
+{
+	ThinnerParameters params;
+	params.active = bool(getFloatProperty("thin_active"));
+	params.pitchCents = getFloatProperty("thin_pitch_cents");
+	params.zSteps = getFloatProperty("thin_z_steps");
+	params.xySteps = getFloatProperty("thin_xy_steps");
+	params.maxInterval = int(getFloatProperty("thin_interval"));
+	params.minInterval = int(getFloatProperty("thin_min_interval"));
+	
+	std::lock_guard<std::mutex> lock(mThinnerMutex);
+	params.clear = clear || mPendingThinnerParameters.clear;
+	mPendingThinnerParameters = params;
+	mThinnerParametersChanged.store(true, std::memory_order_release);
+}
+
+// called by process routine before each frame.
+//
+void SoundplaneModel::installPendingThinnerParameters()
+{
+	if(!mThinnerParametersChanged.load(std::memory_order_acquire)) return;
+	std::unique_lock<std::mutex> lock(mThinnerMutex, std::try_to_lock);
+	if(!lock.owns_lock()) return;
+	ThinnerParameters params = mPendingThinnerParameters;
+	mPendingThinnerParameters.clear = false;
+	mThinnerParametersChanged.store(false, std::memory_order_relaxed);
+	lock.unlock();
+	
+	mThinTouches = params.active;
+	mThinner.setPitchThreshold(params.pitchCents);
+	mThinner.setPressureThreshold(params.zSteps);
+	mThinner.setPositionThreshold(params.xySteps);
+	mThinner.setMaxInterval(milliseconds(params.maxInterval));
+	mThinner.setMinInterval(milliseconds(params.minInterval));
+	if(params.clear)
+	{
+		mThinner.clear();
+	}
+}
+
+// read the zone parameters from the Model's properties. Not for the process thread.
+ZoneParameters SoundplaneModel::getZoneParameters()
+{
+	ZoneParameters params;
+	params.vibrato = getFloatProperty("vibrato");
+	params.hysteresis = getFloatProperty("hysteresis");
+	params.quantize = getFloatProperty("quantize");
+	params.noteLock = getFloatProperty("lock");
+	params.transpose = getFloatProperty("transpose");
+	params.snap = getFloatProperty("snap");
+	return params;
+}
 
 // copy relevant parameters from Model to zones
-void SoundplaneModel::sendParametersToZones()
+void SoundplaneModel::applyParametersToZones(ZoneMap& zoneMap, const ZoneParameters& params)
 {
 	// TODO zones should have parameters (really attributes) too, so they can be inspected.
-	int zones = mZones.size();
-	const float v = getFloatProperty("vibrato");
-	const float h = getFloatProperty("hysteresis");
-	bool q = getFloatProperty("quantize");
-	bool nl = getFloatProperty("lock");
-	int t = getFloatProperty("transpose");
-	float sf = getFloatProperty("snap");
-	
-	for(int i=0; i<zones; ++i)
+	for(auto& zone : zoneMap.zones)
 	{
-		mZones[i].mVibrato = v;
-		mZones[i].mHysteresis = h;
-		mZones[i].mQuantize = q;
-		mZones[i].mNoteLock = nl;
-		mZones[i].mTranspose = t;
-		mZones[i].setSnapFreq(sf);
+		zone.mVibrato = params.vibrato;
+		zone.mHysteresis = params.hysteresis;
+		zone.mQuantize = params.quantize;
+		zone.mNoteLock = params.noteLock;
+		zone.mTranspose = params.transpose;
+		zone.setSnapFreq(params.snap);
 	}
 }
 
@@ -1199,82 +1690,172 @@ float responseCurve(float x, float c)
 	return y;
 }
 
-bool SoundplaneModel::findNoteChanges(TouchArray t0, TouchArray t1)
+// a touch changes state on every frame it starts or ends, and on the frame after, when
+// it continues or becomes inactive.
+bool SoundplaneModel::findNoteChanges(const TouchMasks& m0, const TouchMasks& m1)
 {
-	bool anyChanges = false;
-	
-	for(int i=0; i<kMaxTouches; ++i)
-	{
-		if((t0[i].state) != (t1[i].state))
-		{
-			anyChanges = true;
-			break;
-		}
-	}
-	
-	return anyChanges;
+	return (m0.on | m0.off | m1.on | m1.off) != 0;
 }
 
-TouchArray SoundplaneModel::scaleTouchPressureData(TouchArray in)
+void SoundplaneModel::scaleTouchPressureData(TouchFrame& touches)
 {
-	TouchArray out = in;
-	
-	const float zscale = getFloatProperty("z_scale");
-	const float zcurve = getFloatProperty("z_curve");
+	const float zscale = mZScale;
+	const float zcurve = mZCurve;
 	const float dzScale = 0.125f;
 	
 	for(int i=0; i<kMaxTouches; ++i)
 	{
-		float z = in[i].z;
+		float z = touches.z[i];
 		z *= zscale;
 		z = ml::clamp(z, 0.f, 4.f);
-		z = responseCurve(z, zcurve);
-		out[i].z = z;
-		
-		// for note-ons, use same z scale controls as pressure
-		float dz = in[i].dz*dzScale;
+		touches.z[i] = responseCurve(z, zcurve);
+	}
+	
+	// for note-ons, use same z scale controls as pressure
+	for(int i=0; i<kMaxTouches; ++i)
+	{
+		float dz = touches.dz[i]*dzScale;
 		dz *= zscale;
 		dz = ml::clamp(dz, 0.f, 1.f);
-		dz = responseCurve(dz, zcurve);
-		out[i].dz = dz;
+		touches.dz[i] = responseCurve(dz, zcurve);
 	}
-	return out;
 }
 
-TouchArray SoundplaneModel::trackTouches(const SensorFrame& frame)
+void SoundplaneModel::trackTouches(const SensorFrame& frame, TouchFrame& touches)
 {
+	SP_TRACE_SCOPE("trackTouches");
 	SensorFrame curvature = mTracker.preprocess(frame);
-	TouchArray t = mTracker.process(curvature, mMaxTouches);
-	mSmoothedSignal = sensorFrameToSignal(curvature);
-	t = scaleTouchPressureData(t);
-	return t;
+	recordLatency(kLatencyPreprocess);
+	touches = mTracker.process(curvature, mMaxTouches);
+	recordLatency(kLatencyTracking);
+	{
+		std::unique_lock<std::mutex> lock(mSmoothedSignalMutex, std::try_to_lock);
+		if(lock.owns_lock())
+		{
+			sensorFrameToSignal(curvature, mSmoothedSignal);
+		}
+	}
+	scaleTouchPressureData(touches);
 }
 
-TouchArray SoundplaneModel::getTestTouchesFromTracker(time_point<system_clock> now)
+void SoundplaneModel::getTestTouchesFromTracker(time_point<system_clock> now, TouchFrame& touches)
 {
-	TouchArray t = mTracker.getTestTouches(now, mMaxTouches);
-	t = scaleTouchPressureData(t);
-	return t;
+	touches = mTracker.getTestTouches(now, mMaxTouches);
+	scaleTouchPressureData(touches);
 }
 
-void SoundplaneModel::saveTouchHistory(const TouchArray& t)
+void SoundplaneModel::saveTouchHistory(const TouchFrame& t)
 {
-	// convert array of touches to Signal for display, history
+	// copy touches to Signal for history, and for display if the UI is not reading it.
+	touchFrameToSignal(t, mTouchFrameWorking);
 	{
-		std::lock_guard<std::mutex> lock(mTouchFrameMutex);
-		touchArrayToFrame(&t, &mTouchFrame);
+		std::unique_lock<std::mutex> lock(mTouchFrameMutex, std::try_to_lock);
+		if(lock.owns_lock())
+		{
+			mTouchFrame.copy(mTouchFrameWorking);
+		}
 	}
 	
 	mHistoryCtr++;
 	if (mHistoryCtr >= kSoundplaneHistorySize) mHistoryCtr = 0;
-	mTouchHistory.setFrame(mHistoryCtr, mTouchFrame);
+	mTouchHistory.setFrame(mHistoryCtr, mTouchFrameWorking);
+}
+
+void SoundplaneModel::recordLatency(LatencyStage stage)
+{
+	auto micros = duration_cast<microseconds>(steady_clock::now() - mFrameArrivalTime).count();
+	mLatencyHistograms[stage].record(static_cast<uint32_t>(micros));
+}
+
+void SoundplaneModel::clearLatencyHistograms()
+{
+	for(auto& h : mLatencyHistograms)
+	{
+		h.clear();
+	}
+}
+
+// write the trace buffers to a new file in the temp directory.
+void SoundplaneModel::dumpTrace()
+{
+	if(!SoundplaneTrace::kCompiledIn)
+	{
+		MLConsole() << "tracing is not available in this build.\n";
+		return;
+	}
+	
+	String fileName = "soundplane_trace_" + Time::getCurrentTime().formatted("%Y%m%d_%H%M%S") + ".json";
+	File traceFile = File::getSpecialLocation(File::tempDirectory).getChildFile(fileName);
+	std::string path = traceFile.getFullPathName().toStdString();
+	if(SoundplaneTrace::dumpToFile(path))
+	{
+		MLConsole() << "wrote trace to " << path << "\n";
+	}
+	else
+	{
+		MLConsole() << "couldn't write trace to " << path << "\n";
+	}
+}
+
+// called from mTraceTimer. After a deadline miss, wait a bit so the trace shows
+// what happened afterwards too, and don't write more than one file every few seconds.
+void SoundplaneModel::dumpTraceIfRequested()
+{
+	const int kMinSecondsBetweenDumps = 10;
+	if(mTraceDumpRequested)
+	{
+		time_point<steady_clock> now = steady_clock::now();
+		if(now - mPrevTraceDumpTime > seconds(kMinSecondsBetweenDumps))
+		{
+			MLConsole() << "processing deadline missed.\n";
+			dumpTrace();
+			mPrevTraceDumpTime = now;
+		}
+		mTraceDumpRequested = false;
+	}
+}
+
+// print latency statistics to the console every so often in verbose mode, and send them
+// to OSC receivers every second if requested.
+void SoundplaneModel::reportLatency()
+{
+	const int kConsoleReportInterval = 10;
+	bool printReport = false;
+	if(mVerbose)
+	{
+		if(++mLatencyReportCounter >= kConsoleReportInterval)
+		{
+			mLatencyReportCounter = 0;
+			printReport = true;
+			MLConsole() << "latency from frame arrival, ms (p50 / p99 / max):\n";
+		}
+	}
+	
+	for(int i=0; i<kNumLatencyStages; ++i)
+	{
+		const LatencyHistogram& h = mLatencyHistograms[i];
+		float p50 = h.getPercentile(50.f)*0.001f;
+		float p99 = h.getPercentile(99.f)*0.001f;
+		float pMax = h.getMax()*0.001f;
+		if(printReport)
+		{
+			MLConsole() << "    " << getLatencyStageName(i) << ": " << p50 << " / " << p99 << " / " << pMax << "\n";
+		}
+		if(mSendStats)
+		{
+			mOSCOutput.sendLatencyStats(getLatencyStageName(i), p50, p99, pMax, (int)h.getCount());
+		}
+	}
 }
 
 void SoundplaneModel::doInfrequentTasks()
 {
+	SP_TRACE_SCOPE("doInfrequentTasks");
 	MLNetServiceHub::PollNetServices();
 	mOSCOutput.doInfrequentTasks();
 	mMIDIOutput.doInfrequentTasks();
+	reportLatency();
+	reportMetrics();
 
 	if(getDeviceState() == kDeviceHasIsochSync)
 	{
@@ -1296,9 +1877,15 @@ void SoundplaneModel::doInfrequentTasks()
 			
 			mNeedsCalibrate = true;
 		}
-		else if (mNeedsCalibrate && (!mSelectingCarriers))
+		else if (mNeedsCalibrate && (!mSelectingCarriers) && (mCalibrationLoad == kCalibrationLoadIdle))
 		{
 			mNeedsCalibrate = false;
+			requestSavedCalibration();
+		}
+		
+		if(mCalibrationLoad == kCalibrationLoadNotFound)
+		{
+			mCalibrationLoad = kCalibrationLoadIdle;
 			beginCalibrate();
 		}
 	}
@@ -1360,8 +1947,12 @@ void SoundplaneModel::clear()
 //
 void SoundplaneModel::beginCalibrate()
 {
+	SP_TRACE_SCOPE("beginCalibrate");
 	if(getDeviceState() == kDeviceHasIsochSync)
 	{
+		mValidatingCalibration = false;
+		mCalibrationSerial = mpDriver->getSerialNumber();
+		mCalibrationCarriers = getCarriersInUse();
 		mStats.clear();
 		mCalibrating = true;
 	}
@@ -1371,13 +1962,145 @@ void SoundplaneModel::beginCalibrate()
 //
 void SoundplaneModel::endCalibrate()
 {
+	SP_TRACE_SCOPE("endCalibrate");
 	SensorFrame mean = clamp(mStats.mean(), 0.0001f, 1.f);
 	mCalibrateMeanInv = divide(fill(1.f), mean);
+	mBaseline.reset(mStats.mean(), mStats.standardDeviation());
+	requestCalibrationSave(mStats.mean(), mStats.standardDeviation());
 	mCalibrating = false;
 	mHasCalibration = true;
+	clearLatencyHistograms();
 	enableOutput(true);
 }
 
+const SoundplaneDriver::Carriers& SoundplaneModel::getCarriersInUse() const
+{
+	return mDoOverrideCarriers ? mOverrideCarriers : mCarriers;
+}
+
+// ask doCalibrationFileTasks() for the calibration saved for the device and the
+// carriers in use.
+//
+void SoundplaneModel::requestSavedCalibration()
+{
+	mCalibrationToLoadSerial = mpDriver->getSerialNumber();
+	mCalibrationToLoadCarriers = getCarriersInUse();
+	mCalibrationLoad.store(kCalibrationLoadRequested, std::memory_order_release);
+}
+
+// called from mCalibrationFileTimer. Load the requested calibration for the process
+// thread to start playing with right away. Returns false if there is none.
+//
+bool SoundplaneModel::loadSavedCalibration()
+{
+	if(mPendingCalibration) return false;
+	uint32_t serial = mCalibrationToLoadSerial;
+	if(!mCalibrationStore->load(serial, mCalibrationToLoadCarriers, mPendingCalibrationMean, mPendingCalibrationStdDev)) return false;
+	
+	MLConsole() << "SoundplaneModel: using saved calibration for " << static_cast<int>(serial) << ".\n";
+	mPendingCalibration = true;
+	return true;
+}
+
+// called from mCalibrationFileTimer, so that the files are never read or written
+// on the process thread.
+//
+void SoundplaneModel::doCalibrationFileTasks()
+{
+	if(mCalibrationLoad.load(std::memory_order_acquire) == kCalibrationLoadRequested)
+	{
+		mCalibrationLoad = loadSavedCalibration() ? kCalibrationLoadIdle : kCalibrationLoadNotFound;
+	}
+	reportCalibrationCheck();
+	saveCalibrationIfNeeded();
+}
+
+// called by process routine before each frame.
+//
+void SoundplaneModel::installPendingCalibration()
+{
+	if(!mPendingCalibration) return;
+	mCalibrationSerial = mCalibrationToLoadSerial;
+	mCalibrationCarriers = mCalibrationToLoadCarriers;
+	SensorFrame mean = clamp(mPendingCalibrationMean, 0.0001f, 1.f);
+	mCalibrateMeanInv = divide(fill(1.f), mean);
+	mBaseline.reset(mPendingCalibrationMean, mPendingCalibrationStdDev);
+	mPendingCalibration = false;
+	
+	mStats.clear();
+	mValidatingCalibration = true;
+	mHasCalibration = true;
+	clearLatencyHistograms();
+	enableOutput(true);
+}
+
+// called by process routine when enough untouched samples have been collected after
+// loading a saved calibration. If the surface has drifted from it, switch to the new one.
+//
+void SoundplaneModel::endValidateCalibration()
+{
+	SP_TRACE_SCOPE("endValidateCalibration");
+	const float kMaxCalibrationDrift = 0.02f;
+	
+	mValidatingCalibration = false;
+	SensorFrame mean = mStats.mean();
+	SensorFrame current = mBaseline.getMean();
+	int drifted = 0;
+	for(size_t i=0; i<mean.size(); ++i)
+	{
+		if(fabsf(mean[i] - current[i]) > kMaxCalibrationDrift*current[i])
+		{
+			drifted++;
+		}
+	}
+	
+	if(drifted)
+	{
+		SensorFrame stdDev = mStats.standardDeviation();
+		mCalibrateMeanInv = divide(fill(1.f), clamp(mean, 0.0001f, 1.f));
+		mBaseline.reset(mean, stdDev);
+		requestCalibrationSave(mean, stdDev);
+	}
+	mCalibrationDrift.store(drifted, std::memory_order_release);
+}
+
+// print the result of the last check of a saved calibration, off the process thread.
+//
+void SoundplaneModel::reportCalibrationCheck()
+{
+	int drifted = mCalibrationDrift.exchange(-1, std::memory_order_acq_rel);
+	if(drifted > 0)
+	{
+		MLConsole() << "SoundplaneModel: " << drifted << " taxels have drifted from the saved calibration, replacing it.\n";
+	}
+	else if(drifted == 0)
+	{
+		MLConsole() << "SoundplaneModel: saved calibration checked.\n";
+	}
+}
+
+// hand a new calibration to doCalibrationFileTasks() to be written, unless one is still waiting.
+//
+void SoundplaneModel::requestCalibrationSave(const SensorFrame& mean, const SensorFrame& stdDev)
+{
+	if(mCalibrationToSave) return;
+	mCalibrationToSaveMean = mean;
+	mCalibrationToSaveStdDev = stdDev;
+	mCalibrationToSaveSerial = mCalibrationSerial;
+	mCalibrationToSaveCarriers = mCalibrationCarriers;
+	mCalibrationToSave = true;
+}
+
+void SoundplaneModel::saveCalibrationIfNeeded()
+{
+	if(!mCalibrationToSave) return;
+	if(!mCalibrationStore->save(mCalibrationToSaveSerial, mCalibrationToSaveCarriers, mCalibrationToSaveMean, mCalibrationToSaveStdDev))
+	{
+		MLConsole() << "SoundplaneModel: could not save calibration.\n";
+	}
+	mCalibrationToSave = false;
+}
+
 float SoundplaneModel::getCalibrateProgress()
 {
 	return mStats.getCount() / (float)kSoundplaneCalibrateSize;
@@ -1392,9 +2115,11 @@ void SoundplaneModel::beginSelectCarriers()
 	// has the lowest overall noise.
 	// each step collects kSoundplaneCalibrateSize frames of data.
 	//
+	SP_TRACE_SCOPE("beginSelectCarriers");
 	if(getDeviceState() == kDeviceHasIsochSync)
 	{
 		mSelectCarriersStep = 0;
+		mValidatingCalibration = false;
 		mStats.clear();
 		mSelectingCarriers = true;
 		mTracker.clear();
@@ -1426,6 +2151,7 @@ float SoundplaneModel::getSelectCarriersProgress()
 
 void SoundplaneModel::nextSelectCarriersStep()
 {
+	SP_TRACE_SCOPE("nextSelectCarriersStep");
 	// analyze calibration data just collected.
 	SensorFrame mean = clamp(mStats.mean(), 0.0001f, 1.f);
 	SensorFrame stdDev = mStats.standardDeviation();
@@ -1477,6 +2203,7 @@ void SoundplaneModel::nextSelectCarriersStep()
 
 void SoundplaneModel::endSelectCarriers()
 {
+	SP_TRACE_SCOPE("endSelectCarriers");
 	// get minimum of collected noise sums
 	float minNoise = 99999.f;
 	int minIdx = -1;
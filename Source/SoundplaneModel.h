@@ -6,8 +6,12 @@
 #ifndef __SOUNDPLANE_MODEL__
 #define __SOUNDPLANE_MODEL__
 
+#include <atomic>
+#include <bitset>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <stdint.h>
 
@@ -25,25 +29,68 @@
 #include "TouchTracker.h"
 #include "SoundplaneMIDIOutput.h"
 #include "SoundplaneOSCOutput.h"
+#include "SoundplaneShmOutput.h"
+#include "SoundplaneUMPOutput.h"
+#include "TouchThinner.h"
+#include "BaselineTracker.h"
+#include "CalibrationStore.h"
+#include "OutputClock.h"
 #include "SoundplaneBinaryData.h"
 #include "Zone.h"
+#include "ZoneMap.h"
+#include "ZonePresetIndex.h"
+#include "LatencyHistogram.h"
+#include "SoundplaneTrace.h"
+#include "SoundplaneMetrics.h"
+#include "MLTimer.h"
 
 using namespace ml;
 using namespace std::chrono;
 
 Matrix sensorFrameToSignal(const SensorFrame &f);
+void sensorFrameToSignal(const SensorFrame &f, ml::Matrix& out);
 
+// rows of the touch frame and history signals, which have one column per touch so that
+// the columns of a TouchFrame can be copied in as rows.
 typedef enum
 {
-	xColumn = 0,
-	yColumn = 1,
-	zColumn = 2,
-	dzColumn = 3,
-	ageColumn = 4
-} TouchSignalColumns;
+	xRow = 0,
+	yRow = 1,
+	zRow = 2,
+	dzRow = 3,
+	ageRow = 4,
+	kNumTouchSignalRows
+} TouchSignalRows;
+
+// points in the processing of each frame at which we measure the time since the frame arrived.
+typedef enum
+{
+	kLatencyDequeue = 0,
+	kLatencyPreprocess,
+	kLatencyTracking,
+	kLatencyZones,
+	kLatencySend,
+	kNumLatencyStages
+} LatencyStage;
+
+const char* getLatencyStageName(int stage);
+
+// a frame of sensor data tagged with the time it was received from the driver.
+struct InputFrame
+{
+	SensorFrame data;
+	time_point<steady_clock> arrivalTime;
+};
 
 const int kSensorFrameQueueSize = 16;
 
+// a frame taking longer than this from arrival to output counts as a deadline miss,
+// and triggers a trace dump when tracing.
+const microseconds kFrameDeadline{2000};
+
+// the output clock stops repeating the tracker's state when no new touches have arrived for this long.
+const milliseconds kHeldFrameLimit{100};
+
 class SoundplaneModel :
 public SoundplaneDriverListener,
 public MLOSCListener,
@@ -118,18 +165,18 @@ public:
 	
 	const ml::Matrix& getTouchFrame() { return mTouchFrame; }
 	const ml::Matrix& getTouchHistory() { return mTouchHistory; }
-	const ml::Matrix getRawSignal() { std::lock_guard<std::mutex> lock(mRawSignalMutex); return mRawSignal; }
-	const ml::Matrix getCalibratedSignal() { std::lock_guard<std::mutex> lock(mCalibratedSignalMutex); return sensorFrameToSignal(mCalibratedFrame); }
+	const ml::Matrix getRawSignal() { SP_TRACE_SCOPE("getRawSignal"); std::lock_guard<std::mutex> lock(mRawSignalMutex); return mRawSignal; }
+	const ml::Matrix getCalibratedSignal() { SP_TRACE_SCOPE("getCalibratedSignal"); std::lock_guard<std::mutex> lock(mCalibratedSignalMutex); return mCalibratedSignal; }
 	
-	const ml::Matrix getSmoothedSignal() { std::lock_guard<std::mutex> lock(mSmoothedSignalMutex); return mSmoothedSignal; }
+	const ml::Matrix getSmoothedSignal() { SP_TRACE_SCOPE("getSmoothedSignal"); std::lock_guard<std::mutex> lock(mSmoothedSignalMutex); return mSmoothedSignal; }
 	
-	const TouchArray& getTouchArray() { return mTouchArray1; }
+	const TouchFrame& getTouches() { return mTouches1; }
 	
 	bool isWithinTrackerCalibrateArea(int i, int j);
 	const int getHistoryCtr() { return mHistoryCtr; }
 	
-	const std::vector< Zone >::const_iterator getZonesBegin(){ return mZones.begin(); }
-	const std::vector< Zone >::const_iterator getZonesEnd(){ return mZones.end(); }
+	// the zone layout in use. The map stays valid while the caller holds it.
+	std::shared_ptr< const ZoneMap > getZoneMap();
 	
 	void setStateFromJSON(cJSON* pNode, int depth);
 	bool loadZonePresetByName(const std::string& name);
@@ -139,44 +186,91 @@ public:
 	
 	SoundplaneMIDIOutput& getMIDIOutput() { return mMIDIOutput; }
 	
+	// latency from frame arrival to each stage of processing. Safe to read from any thread.
+	const LatencyHistogram& getLatencyHistogram(int stage) const { return mLatencyHistograms[stage]; }
+	void clearLatencyHistograms();
+	
+	// write the processing timeline to a file. Does nothing unless built with SP_TRACE.
+	void dumpTrace();
+	
+	// pipeline health counters. Safe to read from any thread.
+	const SoundplaneMetrics& getMetrics() const { return mMetrics; }
+	
+	// UMP packets sent while no UMP device is open, for readers in this process.
+	UMPLoopbackTransport& getUMPLoopback() { return mUMPLoopback; }
+	
 private:
-	TouchArray mTouchArray1{};
+	TouchFrame mTouches0{};
+	TouchFrame mTouches1{};
 	TouchArray mZoneOutputTouches{};
 	
 	std::unique_ptr< SoundplaneDriver > mpDriver;
-	std::unique_ptr< Queue< SensorFrame > > mSensorFrameQueue;
+	std::unique_ptr< Queue< InputFrame > > mSensorFrameQueue;
 	
 	// TODO order!
 	void process(time_point<system_clock> now);
-	void outputTouches(TouchArray touches, time_point<system_clock> now);
+	void outputTouches(const TouchFrame& touches, time_point<system_clock> now);
 	void dumpOutputsByZone();
 	
-	TouchArray trackTouches(const SensorFrame& frame);
-	TouchArray getTestTouchesFromTracker(time_point<system_clock> now);
-	void saveTouchHistory(const TouchArray& t);
+	void trackTouches(const SensorFrame& frame, TouchFrame& touches);
+	void getTestTouchesFromTracker(time_point<system_clock> now, TouchFrame& touches);
+	void saveTouchHistory(const TouchFrame& t);
 
 	void initialize();
-	bool findNoteChanges(TouchArray t0, TouchArray t1);
-	TouchArray scaleTouchPressureData(TouchArray in);
+	bool findNoteChanges(const TouchMasks& m0, const TouchMasks& m1);
+	void scaleTouchPressureData(TouchFrame& touches);
 	
-	void sendTouchesToZones(TouchArray touches);
+	void sendTouchesToZones(const TouchFrame& touches);
 	
-	void sendFrameToOutputs(time_point<system_clock> now);
+	void sendFrameToOutputs(time_point<system_clock> now, bool repeat = false);
+	void sendScheduledFrame();
 	void beginOutputFrame(time_point<system_clock> now);
 	void sendTouchToOutputs(int i, int offset, const Touch& t);
 	void sendControllerToOutputs(int zoneID, int offset, const ZoneMessage& m);
 	void endOutputFrame();
 	
-	void clearZones();
-	void sendParametersToZones();
+	void sendZonesToOutputs(ZoneMap& zoneMap, time_point<system_clock> now, bool repeat);
 	
-	std::vector< Zone > mZones;
-	ml::Matrix mZoneIndexMap;
+	void sendParametersToZones();
+	ZoneParameters getZoneParameters();
+	void sendParametersToThinner(bool clear);
+	void installPendingThinnerParameters();
+	void applyParametersToZones(ZoneMap& zoneMap, const ZoneParameters& params);
+	void publishZoneMap(std::shared_ptr< ZoneMap > pZoneMap);
+	void installPendingZoneMap(time_point<system_clock> now);
+	
+	const SoundplaneDriver::Carriers& getCarriersInUse() const;
+	void requestSavedCalibration();
+	bool loadSavedCalibration();
+	void installPendingCalibration();
+	void endValidateCalibration();
+	void requestCalibrationSave(const SensorFrame& mean, const SensorFrame& stdDev);
+	void saveCalibrationIfNeeded();
+	void reportCalibrationCheck();
+	
+	// the zones in use by the process thread. Only the process thread replaces it, with
+	// mZoneMapMutex held so that getZoneMap() can share it.
+	std::shared_ptr< ZoneMap > mZoneMap;
+	
+	// a new layout waiting for the process thread, and the old one it replaced,
+	// waiting to be released by another thread.
+	std::shared_ptr< ZoneMap > mPendingZoneMap;
+	std::shared_ptr< ZoneMap > mRetiredZoneMap;
+	std::mutex mZoneMapMutex;
+	std::atomic< bool > mZoneMapPending{false};
+	
+	// new zone parameters waiting for the process thread, also guarded by mZoneMapMutex.
+	ZoneParameters mPendingZoneParameters;
+	std::atomic< bool > mZoneParametersChanged{false};
+	
+	// touches ended by a change of layout, which start again in the new zones.
+	std::bitset< kMaxTouches > mTouchesFreedBySwap;
 	
 	bool mOutputEnabled;
 	
 	static const int kMiscStringSize{256};
 	void loadZonesFromString(const std::string& zoneStr);
+	void loadZonesFromPreset(const ZonePreset& preset);
 	
 	void doInfrequentTasks();
 	uint64_t mLastInfrequentTaskTime;
@@ -185,16 +279,56 @@ private:
 	
 	SoundplaneMIDIOutput mMIDIOutput;
 	SoundplaneOSCOutput mOSCOutput;
-	
-	SensorFrame mSensorFrame{};
+	SoundplaneShmOutput mShmOutput;
+	SoundplaneUMPOutput mUMPOutput;
+	
+	// the UMP output sends to the device if one is open, or else to the loopback.
+	UMPLoopbackTransport mUMPLoopback;
+	UMPDeviceTransport mUMPDevice;
+	
+	// optional thinning of touch changes between the zones and all outputs.
+	TouchThinner mThinner;
+	bool mThinTouches{false};
+	
+	// thinner settings from the properties, waiting for the process thread. If clear
+	// is set, the thinner forgets the values it has sent before taking them.
+	struct ThinnerParameters
+	{
+		bool active{false};
+		float pitchCents{2.f};
+		float zSteps{1.f};
+		float xySteps{1.f};
+		int maxInterval{50};
+		int minInterval{2};
+		bool clear{false};
+	};
+	ThinnerParameters mPendingThinnerParameters;
+	std::mutex mThinnerMutex;
+	std::atomic< bool > mThinnerParametersChanged{false};
+	
+	// all outputs, in the order each frame is sent to them.
+	std::array< SoundplaneOutput*, 4 > mOutputs{{&mMIDIOutput, &mOSCOutput, &mShmOutput, &mUMPOutput}};
+	
+	// the metric counting the frames each output has sent, in the same order.
+	const std::array< MetricID, 4 > mOutputFrameMetrics{{kMetricMIDIFramesSent, kMetricOSCFramesSent, kMetricShmFramesSent, kMetricUMPFramesSent}};
+	bool mShmSendSensor{false};
+	
+	InputFrame mInputFrame{};
 	SensorFrame mCalibratedFrame{};
 	
 	ml::Matrix mSurface;
 	
 	int	mMaxTouches;
 	
+	// properties read by the process thread every frame, copied here when they change
+	// so that the process thread never reads the property map.
+	std::atomic< float > mHysteresis{0.5f};
+	std::atomic< float > mZScale{1.f};
+	std::atomic< float > mZCurve{0.5f};
+	
 	ml::Matrix mTouchFrame;
 	std::mutex mTouchFrameMutex;
+	ml::Matrix mTouchFrameWorking;
 	ml::Matrix mTouchHistory;
 	
 	bool mCalibrating;
@@ -212,6 +346,46 @@ private:
 	SensorFrameStats mStats;
 	SensorFrame mCalibrateMeanInv{};
 	
+	// follows drift in the calibration while playing.
+	BaselineTracker mBaseline;
+	bool mTrackBaseline{true};
+	
+	// calibrations saved for each device and set of carriers, and the device and
+	// carriers of the calibration being made or checked.
+	std::unique_ptr< CalibrationStore > mCalibrationStore;
+	uint32_t mCalibrationSerial{0};
+	SoundplaneDriver::Carriers mCalibrationCarriers{};
+	
+	// a saved calibration waiting for the process thread. It is checked against a new
+	// one, measured while nothing is touching, and replaced if the surface has drifted.
+	std::atomic<bool> mPendingCalibration{false};
+	SensorFrame mPendingCalibrationMean{};
+	SensorFrame mPendingCalibrationStdDev{};
+	std::atomic<bool> mValidatingCalibration{false};
+	
+	// a saved calibration for doCalibrationFileTasks() to look for, with the device and
+	// carriers it is for. If none is found, doInfrequentTasks() starts calibrating.
+	enum
+	{
+		kCalibrationLoadIdle = 0,
+		kCalibrationLoadRequested,
+		kCalibrationLoadNotFound
+	};
+	std::atomic<int> mCalibrationLoad{kCalibrationLoadIdle};
+	uint32_t mCalibrationToLoadSerial{0};
+	SoundplaneDriver::Carriers mCalibrationToLoadCarriers{};
+	
+	// the number of taxels found to have drifted by the last check, for
+	// doCalibrationFileTasks() to report, or -1 if there is nothing to report.
+	std::atomic<int> mCalibrationDrift{-1};
+	
+	// a new calibration waiting to be written by doCalibrationFileTasks().
+	std::atomic<bool> mCalibrationToSave{false};
+	SensorFrame mCalibrationToSaveMean{};
+	SensorFrame mCalibrationToSaveStdDev{};
+	uint32_t mCalibrationToSaveSerial{0};
+	SoundplaneDriver::Carriers mCalibrationToSaveCarriers{};
+	
 	ml::Matrix mRawSignal;
 	std::mutex mRawSignalMutex;
 	
@@ -222,6 +396,9 @@ private:
 	ml::Matrix mSmoothedSignal;
 	std::mutex mSmoothedSignalMutex;
 	
+	// calibrated frame for matrix output, allocated once.
+	ml::Matrix mCalibratedMatrix;
+	
 	int mCalibrateStep; // calibrate step from 0 - end
 	int mTotalCalibrateSteps;
 	int mSelectCarriersStep;
@@ -255,8 +432,14 @@ private:
 	int mKymaIsConnected; // TODO more custom clients
 	
 	std::unique_ptr<MLFileCollection> mTouchPresets;
+	
+	// declared before the collection, so that it outlives the collection's search thread.
+	std::unique_ptr<ZonePresetIndex> mZonePresetIndex;
 	std::unique_ptr<MLFileCollection> mZonePresets;
 	
+	// the preset last chosen from the menu, whose zone_JSON need not be compiled again.
+	std::shared_ptr< const ZonePreset > mSelectedZonePreset;
+	
 	bool mVerbose;
 	
 	bool mTerminating{false};
@@ -267,7 +450,37 @@ private:
 	size_t mMaxRecentQueueSize{0};
 	
 	int mDataRate{100};
-	time_point<system_clock> mPrevProcessTouchesTime{};
+	
+	// output frames are sent on this clock's boundaries, except for immediate note changes.
+	OutputClock mOutputClock;
+	
+	// the time touches were last sent to the Zones, and whether their state has gone out since.
+	time_point<steady_clock> mLastTrackerTime{};
+	bool mHeldFrameSent{true};
+	
+	// arrival time of the frame currently being processed.
+	time_point<steady_clock> mFrameArrivalTime{};
+	std::array< LatencyHistogram, kNumLatencyStages > mLatencyHistograms;
+	void recordLatency(LatencyStage stage);
+	void reportLatency();
+	bool mSendStats{false};
+	int mLatencyReportCounter{0};
+	
+	// set by the process thread on a deadline miss while tracing.
+	void dumpTraceIfRequested();
+	std::atomic<bool> mTraceDumpRequested{false};
+	time_point<steady_clock> mPrevTraceDumpTime{};
+	ml::Timer mTraceTimer;
+	
+	// reads and writes the saved calibrations, away from the process thread.
+	void doCalibrationFileTasks();
+	ml::Timer mCalibrationFileTimer;
+	
+	SoundplaneMetrics mMetrics;
+	void sendMetrics(const IpEndpointName& destination);
+	void reportMetrics();
+	int mMetricsReportCounter{0};
+	uint64_t mPrevMetricsFaults{0};
 };
 
 #endif // __SOUNDPLANE_MODEL__
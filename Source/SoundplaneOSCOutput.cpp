@@ -6,6 +6,8 @@
 #include "SoundplaneOSCOutput.h"
 #include "MLTextUtils.h"
 
+#include <cstdio>
+#include <cstring>
 #include <thread>
 
 using namespace ml;
@@ -79,6 +81,7 @@ void SoundplaneOSCOutput::reconnect()
 			MLConsole() << "                     connected to port " << mCurrentBaseUDPPort + portOffset << "\n";
 		}
 		
+		setupDestinations();
 		setActive(true);
 	}
 	catch(std::runtime_error err)
@@ -88,6 +91,125 @@ void SoundplaneOSCOutput::reconnect()
 	}
 }
 
+// open the batch sender with the primary destination and any others. Frames are sent
+// through the batch sender to all destinations. If the primary destination can't be
+// opened there, its packets are sent individually through the per-port sockets.
+void SoundplaneOSCOutput::setupDestinations()
+{
+	OSCDestination primary;
+	primary.hostName = mHostName;
+	for(int i=0; i<kNumUDPPorts; ++i)
+	{
+		primary.ports[i] = mCurrentBaseUDPPort + i;
+	}
+	primary.protocol = mKymaMode ? kOSCProtocolKyma : kOSCProtocolT3D;
+	primary.sendMatrix = true;
+	
+	if(!mBatchSender.open())
+	{
+		MLConsole() << "                     batch sender unavailable, sending packets individually.\n";
+	}
+	
+	mT3DDestinations = 0;
+	mKymaDestinations = 0;
+	mMatrixDestinations = 0;
+	for(int d=0; d<kMaxDestinations; ++d)
+	{
+		DestinationState& s = mDestinations[d];
+		s = DestinationState();
+		if(d == 0)
+		{
+			s.config = primary;
+		}
+		else if(d - 1 < static_cast<int>(mExtraDestinations.size()))
+		{
+			s.config = mExtraDestinations[d - 1];
+		}
+		else
+		{
+			continue;
+		}
+		
+		bool opened = mBatchSender.setDestination(d, s.config.hostName, s.config.ports.data(), kNumUDPPorts, s.config.multicastTTL);
+		if(d > 0)
+		{
+			if(!opened)
+			{
+				MLConsole() << "                     could not resolve destination " << s.config.hostName << "\n";
+				continue;
+			}
+			MLConsole() << "                     also sending to " << s.config.hostName << " port " << s.config.ports[0] <<
+				(mBatchSender.isMulticast(d) ? " (multicast)" : "") << ((s.config.protocol == kOSCProtocolKyma) ? " (Kyma)" : "") << "\n";
+			// the interface is shared by all multicast destinations, so the first one set is used.
+			if(mBatchSender.isMulticast(d) && !s.config.multicastInterface.empty())
+			{
+				const std::string& current = mBatchSender.getMulticastInterface();
+				if(current.empty())
+				{
+					if(!mBatchSender.setMulticastInterface(s.config.multicastInterface))
+					{
+						MLConsole() << "                     could not use multicast interface " << s.config.multicastInterface << "\n";
+					}
+				}
+				else if(current != s.config.multicastInterface)
+				{
+					MLConsole() << "                     multicast interface " << s.config.multicastInterface <<
+						" ignored, all multicast is sent from " << current << "\n";
+				}
+			}
+		}
+		
+		uint32_t bit = 1u << d;
+		if(s.config.protocol == kOSCProtocolKyma)
+		{
+			mKymaDestinations |= bit;
+		}
+		else
+		{
+			mT3DDestinations |= bit;
+			if(s.config.sendMatrix)
+			{
+				mMatrixDestinations |= bit;
+			}
+		}
+	}
+	if(static_cast<int>(mExtraDestinations.size()) > kMaxDestinations - 1)
+	{
+		MLConsole() << "                     only the first " << kMaxDestinations - 1 << " extra destinations are used.\n";
+	}
+	
+	mPrevTouchSize.fill(0);
+	mPortVersion.fill(0);
+}
+
+// the destinations in the given set that are due for a frame at their data rates.
+uint32_t SoundplaneOSCOutput::getDueDestinations(uint32_t destinations)
+{
+	uint32_t due = 0;
+	for(int d=0; d<kMaxDestinations; ++d)
+	{
+		uint32_t bit = 1u << d;
+		if(!(destinations & bit)) continue;
+		DestinationState& s = mDestinations[d];
+		float rate = s.config.dataRate;
+		if(rate <= 0.f)
+		{
+			due |= bit;
+			continue;
+		}
+		
+		// advance by whole intervals so the average rate is right, unless far behind.
+		system_clock::duration interval = duration_cast<system_clock::duration>(duration<float>(1.f/rate));
+		system_clock::duration elapsed = mFrameTime - s.prevFrameTime;
+		if(elapsed >= interval)
+		{
+			s.prevFrameTime = (elapsed >= interval*2) ? mFrameTime : (s.prevFrameTime + interval);
+			due |= bit;
+		}
+	}
+	return due;
+}
+
 int SoundplaneOSCOutput::getKymaMode()
 {
 	return mKymaMode;
@@ -105,6 +227,7 @@ void SoundplaneOSCOutput::setActive(bool v)
 	
 	// reset frame ID
 	mFrameId = 0;
+	mMatrixEncoder.requestKeyframe();
 }
 
 osc::OutboundPacketStream* SoundplaneOSCOutput::getPacketStreamForOffset(int portOffset)
@@ -119,7 +242,7 @@ osc::OutboundPacketStream* SoundplaneOSCOutput::getPacketStreamForOffset(int por
 
 UdpTransmitSocket* SoundplaneOSCOutput::getTransmitSocketForOffset(int portOffset)
 {
-	return &(*mUDPSockets[portOffset]);
+	return mUDPSockets[portOffset].get();
 }
 
 const ml::Symbol startFrameSym("start_frame");
@@ -128,11 +251,6 @@ const ml::Symbol onSym("on");
 const ml::Symbol continueSym("continue");
 const ml::Symbol offSym("off");
 const ml::Symbol controllerSym("controller");
-const ml::Symbol xSym("x");
-const ml::Symbol ySym("y");
-const ml::Symbol xySym("xy");
-const ml::Symbol zSym("z");
-const ml::Symbol toggleSym("toggle");
 const ml::Symbol endFrameSym("end_frame");
 const ml::Symbol matrixSym("matrix");
 const ml::Symbol nullSym;
@@ -142,17 +260,18 @@ void SoundplaneOSCOutput::beginOutputFrame(time_point<system_clock> now)
 	if(!mActive) return;
 	mFrameTime = now;
 	
-	// update all voice states
+	// update the states of voices in use
 	for(int offset=0; offset < kNumUDPPorts; ++offset)
 	{
-		for(int voiceIdx=0; voiceIdx < kMaxTouches; ++voiceIdx)
+		forEachTouch(mActiveByPort[offset], [&](int voiceIdx)
 		{
 			Touch& t = (mTouchesByPort[offset])[voiceIdx];
 			if (t.state == kTouchStateOff)
 			{
 				t.state = kTouchStateInactive;
+				mActiveByPort[offset] &= ~touchBit(voiceIdx);
 			}
-		}
+		});
 	}
 	
 	// clear controller message array
@@ -168,6 +287,14 @@ void SoundplaneOSCOutput::processTouch(int i, int offset, const Touch& t)
 	if(!mActive) return;
 	// store incoming touch by port offset and index
 	mTouchesByPort[offset][i] = t;
+	if(touchIsActive(t))
+	{
+		mActiveByPort[offset] |= touchBit(i);
+	}
+	else
+	{
+		mActiveByPort[offset] &= ~touchBit(i);
+	}
 }
 
 void SoundplaneOSCOutput::processController(int zoneID, int h, const ZoneMessage& m)
@@ -183,13 +310,14 @@ void SoundplaneOSCOutput::processController(int zoneID, int h, const ZoneMessage
 
 void SoundplaneOSCOutput::endOutputFrame()
 {
+	mSentFrame = false;
 	if(!mActive) return;
 	
-	if(mKymaMode)
+	if(mKymaDestinations)
 	{
 		sendFrameToKyma();
 	}
-	else
+	if(mT3DDestinations)
 	{
 		sendFrame();
 	}
@@ -204,14 +332,13 @@ void SoundplaneOSCOutput::clear()
 	// allow process thread frames to finish
 	std::this_thread::sleep_for(std::chrono::microseconds(2000));
 	
-	if(mKymaMode)
+	clearTouches();
+	if(mKymaDestinations)
 	{
-		clearTouches();
 		sendFrameToKyma();
 	}
-	else
+	if(mT3DDestinations)
 	{
-		clearTouches();
 		sendFrame();
 	}
 }
@@ -219,7 +346,8 @@ void SoundplaneOSCOutput::clear()
 void SoundplaneOSCOutput::sendFrame()
 {
 	// for each zone, send and clear any controller messages received since last frame
-	// to the output port for that zone. controller messages are not sent in bundles.
+	// to the output port for that zone. controller messages are not sent in bundles,
+	// and go to every destination as soon as they change.
 	for(int i=0; i<kSoundplaneAMaxZones; ++i)
 	{
 		const ZoneMessage c = mControllersByZone[i];
@@ -229,68 +357,65 @@ void SoundplaneOSCOutput::sendFrame()
 			int portOffset = c.offset;
 			
 			// send controller message: /zoneName val1 (val2) on port (kDefaultUDPPort + offset).
-			osc::OutboundPacketStream* p = getPacketStreamForOffset(portOffset);
-			UdpTransmitSocket* socket = getTransmitSocketForOffset(portOffset);
-			if((!p) || (!socket)) return;
-			
-			TextFragment ctrlStr(TextFragment("/"), c.name.getTextFragment());
-			
-			*p << osc::BeginMessage( ctrlStr.getText() );
-			
-			Symbol t = c.type;
-			
-			if(t == "x")
+			// remake the message template only when the zone's name or type changes.
+			OSCMessageTemplate& m = mControllerTemplates[i];
+			if((c.name != mControllerTemplateNames[i]) || (c.type != mControllerTemplateTypes[i]))
 			{
-				*p << c.x;
+				buildControllerTemplate(i, c);
 			}
-			else if(t == "y")
-			{
-				*p << c.y;
-			}
-			else if(t == "xy")
-			{
-				*p << c.x << c.y;
-			}
-			else if(t == "z")
+			
+			switch(c.type)
 			{
-				*p << c.z;
+				case kZoneTypeX:
+					m.setFloat(0, c.x);
+					break;
+				case kZoneTypeY:
+					m.setFloat(0, c.y);
+					break;
+				case kZoneTypeXY:
+					m.setFloat(0, c.x);
+					m.setFloat(1, c.y);
+					break;
+				case kZoneTypeZ:
+					m.setFloat(0, c.z);
+					break;
+				case kZoneTypeToggle:
+					m.setInt(0, (c.x > 0.5f));
+					break;
+				default:
+					break;
 			}
-			else if(t == "toggle")
+			
+			if(m.getSize() > 0)
 			{
-				int t = (c.x > 0.5f);
-					*p << t;
+				sendPacket(portOffset, m.getData(), m.getSize(), mT3DDestinations);
+				mSentFrame = true;
 			}
-			
-			*p << osc::EndMessage;
-			
-			socket->Send( p->Data(), p->Size() );
 			mSentControllersByZone[i] = c;
 		}
 	}
 	
-	// for each port, send an OSC bundle containing any touches.
+	uint32_t dueDestinations = getDueDestinations(mT3DDestinations);
+	
+	// for each port, make an OSC bundle containing any touches and send it to each
+	// destination that is due for a frame. Ports without touches get one empty frame
+	// after their touches end, then only a periodic heartbeat. Frames whose touches are
+	// exactly the same as the last ones a destination got are also skipped until the
+	// heartbeat, which happens when touch thinning holds all values.
 	for(int portOffset=0; portOffset<kNumUDPPorts; ++portOffset)
 	{
 		// begin OSC bundle for this frame
 		// timestamp is now stored in the bundle, synchronizing all info for this frame.
-		osc::OutboundPacketStream* p = getPacketStreamForOffset(portOffset);
-		UdpTransmitSocket* socket = getTransmitSocketForOffset(portOffset);
-		if((!p) || (!socket)) return;
-		
-		osc::uint64 micros = duration_cast<microseconds>(mFrameTime.time_since_epoch()).count();
-		*p << osc::BeginBundle(micros);
-		
-		// send frame start message
-		*p << osc::BeginMessage( "/t3d/frm" );
-		*p << mFrameId++ << mSerialNumber;
-		*p << osc::EndMessage;
+		// the frame message is part of the template, so only the time and IDs are written.
+		T3DFrameTemplate& frame = mFrameTemplates[portOffset];
+		uint64_t micros = duration_cast<microseconds>(mFrameTime.time_since_epoch()).count();
+		frame.begin(micros, mFrameId, mSerialNumber);
+		bool hasTouches = (mActiveByPort[portOffset] != 0);
 		
-		for(int voiceIdx=0; voiceIdx < kMaxTouches; ++voiceIdx)
+		forEachTouch(mActiveByPort[portOffset], [&](int voiceIdx)
 		{
 			Touch& t = mTouchesByPort[portOffset][voiceIdx];
 			
-			if(t.state != kTouchStateInactive)
-			{
         // send dz on first frame of a new touch for note on.
         // when scaled the dz values are close to z, so when using z directly
         // the error in the first frame is not a problem
@@ -304,19 +429,99 @@ void SoundplaneOSCOutput::sendFrame()
         }
       */
         
-				osc::int32 touchID = voiceIdx + 1; // 1-based for OSC
-				TextFragment address("/t3d/tch", ml::textUtils::naturalNumberToText(touchID));
-				*p << osc::BeginMessage( address.getText() );
-				*p << t.x << t.y << zOut << t.note;
-				*p << osc::EndMessage;
+			frame.addTouch(voiceIdx, t.x, t.y, zOut, t.note);
+		});
+		
+		// count changes to the port's touches, so each destination can tell if it has the latest.
+		size_t touchSize = frame.getTouchSize();
+		if((touchSize != mPrevTouchSize[portOffset]) || memcmp(frame.getTouchData(), mPrevTouchData[portOffset].data(), touchSize))
+		{
+			memcpy(mPrevTouchData[portOffset].data(), frame.getTouchData(), touchSize);
+			mPrevTouchSize[portOffset] = touchSize;
+			mPortVersion[portOffset]++;
+		}
+		
+		uint32_t sendTo = 0;
+		for(int d=0; d<kMaxDestinations; ++d)
+		{
+			uint32_t bit = 1u << d;
+			if(!(dueDestinations & bit)) continue;
+			DestinationState& s = mDestinations[d];
+			bool touchesEnded = s.portHadTouches[portOffset] && !hasTouches;
+			bool heartbeatDue = (mFrameTime - s.prevPortSendTime[portOffset] >= kHeartbeatInterval);
+			bool touchesChanged = hasTouches && (s.sentPortVersion[portOffset] != mPortVersion[portOffset]);
+			s.portHadTouches[portOffset] = hasTouches;
+			if(touchesChanged || touchesEnded || heartbeatDue)
+			{
+				s.sentPortVersion[portOffset] = mPortVersion[portOffset];
+				s.prevPortSendTime[portOffset] = mFrameTime;
+				sendTo |= bit;
 			}
 		}
 		
-		*p << osc::EndBundle;
-		socket->Send( p->Data(), p->Size() );
+		if(sendTo)
+		{
+			sendPacket(portOffset, frame.getData(), frame.getSize(), sendTo);
+			mFrameId++;
+			mSentFrame = true;
+		}
+	}
+	
+	mBatchSender.flush();
+}
+
+void SoundplaneOSCOutput::sendPacket(int portOffset, const char* data, size_t size, uint32_t destinations)
+{
+	mBatchSender.add(portOffset, data, size, destinations);
+	if((destinations & 1u) && !mBatchSender.hasDestination(0))
+	{
+		UdpTransmitSocket* socket = getTransmitSocketForOffset(portOffset);
+		if(socket)
+		{
+			socket->Send(data, size);
+		}
 	}
 }
 
+// controller messages are /zoneName followed by one or two arguments, depending on the zone type.
+void SoundplaneOSCOutput::buildControllerTemplate(int zoneID, const ZoneMessage& c)
+{
+	char address[OSCMessageTemplate::kMaxAddressLength + 1];
+	int length = snprintf(address, sizeof(address), "/%s", c.name.getTextFragment().getText());
+	
+	const char* typeTags = "";
+	switch(c.type)
+	{
+		case kZoneTypeX:
+		case kZoneTypeY:
+		case kZoneTypeZ:
+			typeTags = "f";
+			break;
+		case kZoneTypeXY:
+			typeTags = "ff";
+			break;
+		case kZoneTypeToggle:
+			typeTags = "i";
+			break;
+		default:
+			break;
+	}
+	
+	// rather than send a truncated address, leave the template empty so that nothing is
+	// sent for the zone. compileZonePreset() warns about names that are too long.
+	OSCMessageTemplate& m = mControllerTemplates[zoneID];
+	if((length < 0) || (length >= static_cast<int>(sizeof(address))))
+	{
+		m.clear();
+	}
+	else
+	{
+		m.build(address, typeTags);
+	}
+	mControllerTemplateNames[zoneID] = c.name;
+	mControllerTemplateTypes[zoneID] = c.type;
+}
+
 void SoundplaneOSCOutput::clearTouches()
 {
 	for(int portOffset=0; portOffset<kNumUDPPorts; ++portOffset)
@@ -329,17 +534,29 @@ void SoundplaneOSCOutput::clearTouches()
 			t.z = 0.f;
 			t.state = kTouchStateOff;
 		}
+		mActiveByPort[portOffset] = kAllTouches;
 	}
 }
 
 void SoundplaneOSCOutput::sendFrameToKyma()
 {
+	// Kyma gets a frame at its data rate, and whenever a touch starts or ends.
+	uint32_t dueDestinations = getDueDestinations(mKymaDestinations);
+	forEachTouch(mActiveByPort[0], [&](int voiceIdx)
+	{
+		int state = mTouchesByPort[0][voiceIdx].state;
+		if((state == kTouchStateOn) || (state == kTouchStateOff))
+		{
+			dueDestinations = mKymaDestinations;
+		}
+	});
+	if(!dueDestinations) return;
+	
 	osc::OutboundPacketStream* p = getPacketStreamForOffset(0);
-	UdpTransmitSocket* socket = getTransmitSocketForOffset(0);
-	if((!p) || (!socket)) return;
+	if(!p) return;
 	
 	*p << osc::BeginBundleImmediate;
-	for(int voiceIdx=0; voiceIdx < kMaxTouches; ++voiceIdx)
+	forEachTouch(mActiveByPort[0], [&](int voiceIdx)
 	{
 		Touch& t = mTouchesByPort[0][voiceIdx];
 		osc::int32 touchID = voiceIdx; // 0-based for Kyma
@@ -354,25 +571,24 @@ void SoundplaneOSCOutput::sendFrameToKyma()
 			offOn = 0; // TODO periodically turn off silent voices
 		}
 		// note this is called for on and off
-		if(t.state != kTouchStateInactive)
-		{
-			*p << osc::BeginMessage( "/key" );
-			*p << touchID << offOn << t.note << t.z << t.y;
-			*p << osc::EndMessage;
-		}
-	}
+		*p << osc::BeginMessage( "/key" );
+		*p << touchID << offOn << t.note << t.z << t.y;
+		*p << osc::EndMessage;
+	});
 	
 	*p << osc::EndBundle;
-	socket->Send( p->Data(), p->Size() );
+	sendPacket(0, p->Data(), p->Size(), dueDestinations);
+	mBatchSender.flush();
+	mSentFrame = true;
 }
 
 void SoundplaneOSCOutput::doInfrequentTasks()
 {
-	if(mKymaMode)
+	if(mKymaDestinations)
 	{
 		sendInfrequentDataToKyma();
 	}
-	else
+	if(mT3DDestinations)
 	{
 		sendInfrequentData();
 	}
@@ -380,27 +596,35 @@ void SoundplaneOSCOutput::doInfrequentTasks()
 
 void SoundplaneOSCOutput::sendInfrequentData()
 {
-	for(int portOffset = 0; portOffset < kNumUDPPorts; portOffset++)
+	// each destination is told its own data rate.
+	for(int d=0; d<kMaxDestinations; ++d)
 	{
-		osc::OutboundPacketStream* p = getPacketStreamForOffset(portOffset);
-		UdpTransmitSocket* socket = getTransmitSocketForOffset(portOffset);
-		if((!p) || (!socket)) return;
+		uint32_t bit = 1u << d;
+		if(!(mT3DDestinations & bit)) continue;
+		float rate = mDestinations[d].config.dataRate;
+		osc::int32 dataRate = ((rate > 0.f) && (rate < mDataRate)) ? (osc::int32)rate : (osc::int32)mDataRate;
 		
-		// send data rate to receiver
-		*p << osc::BeginBundleImmediate;
-		*p << osc::BeginMessage( "/t3d/dr" );
-		*p << (osc::int32)mDataRate;
-		*p << osc::EndMessage;
-		*p << osc::EndBundle;
-		socket->Send( p->Data(), p->Size() );
+		for(int portOffset = 0; portOffset < kNumUDPPorts; portOffset++)
+		{
+			osc::OutboundPacketStream* p = getPacketStreamForOffset(portOffset);
+			if(!p) return;
+			
+			// send data rate to receiver
+			*p << osc::BeginBundleImmediate;
+			*p << osc::BeginMessage( "/t3d/dr" );
+			*p << dataRate;
+			*p << osc::EndMessage;
+			*p << osc::EndBundle;
+			sendPacket(portOffset, p->Data(), p->Size(), bit);
+		}
+		mBatchSender.flush();
 	}
 }
 
 void SoundplaneOSCOutput::sendInfrequentDataToKyma()
 {
 	osc::OutboundPacketStream* p = getPacketStreamForOffset(0);
-	UdpTransmitSocket* socket = getTransmitSocketForOffset(0);
-	if((!p) || (!socket)) return;
+	if(!p) return;
 	
 	// tell the Kyma that we want to receive info on our listening port
 	*p << osc::BeginBundleImmediate;
@@ -413,29 +637,85 @@ void SoundplaneOSCOutput::sendInfrequentDataToKyma()
 	*p << (osc::int32)1;
 	*p << osc::EndMessage;
 	*p << osc::EndBundle;
-	socket->Send( p->Data(), p->Size() );
+	sendPacket(0, p->Data(), p->Size(), mKymaDestinations);
+	mBatchSender.flush();
 	
 	// send data rate to receiver
+	p = getPacketStreamForOffset(0);
 	*p << osc::BeginBundleImmediate;
 	*p << osc::BeginMessage( "/t3d/dr" );
 	*p << (osc::int32)mDataRate;
 	*p << osc::EndMessage;
 	*p << osc::EndBundle;
-	socket->Send( p->Data(), p->Size() );
+	sendPacket(0, p->Data(), p->Size(), mKymaDestinations);
+	mBatchSender.flush();
+}
+
+
+void SoundplaneOSCOutput::setMatrixRate(float hz)
+{
+	mMatrixRate = (hz > 0.f) ? hz : 0.f;
+	updateMatrixKeyframeInterval();
+}
+
+void SoundplaneOSCOutput::setMatrixFormat(int f)
+{
+	mMatrixFormat = ml::clamp(f, (int)kMatrixFloat, (int)kMatrixUInt8);
+	mMatrixEncoder.setFormat((mMatrixFormat == kMatrixUInt8) ? MatrixStream::kUInt8 : MatrixStream::kFloat16);
+}
+
+// send a keyframe about once per second.
+void SoundplaneOSCOutput::updateMatrixKeyframeInterval()
+{
+	float framesPerSecond = (mMatrixRate > 0.f) ? mMatrixRate : mDataRate;
+	mMatrixEncoder.setKeyframeInterval(static_cast<int>(framesPerSecond));
 }
 
+bool SoundplaneOSCOutput::isMatrixFrameDue() const
+{
+	if(!mActive) return false;
+	if(mMatrixRate <= 0.f) return true;
+	return (mFrameTime - mPrevMatrixTime >= duration<float>(1.f/mMatrixRate));
+}
 
 void SoundplaneOSCOutput::processMatrix(const ml::Matrix& m)
 {
+	if(!mMatrixDestinations) return;
 	osc::OutboundPacketStream* p = getPacketStreamForOffset(0);
-	UdpTransmitSocket* socket = getTransmitSocketForOffset(0);
-	if((!p) || (!socket)) return;
+	if(!p) return;
+	mPrevMatrixTime = mFrameTime;
 	
-	*p << osc::BeginMessage( "/t3d/matrix" );
-	*p << osc::Blob( m.getConstBuffer(), m.getSize()*sizeof(float) );
-	*p << osc::EndMessage;
+	if(mMatrixFormat == kMatrixFloat)
+	{
+		*p << osc::BeginMessage( "/t3d/matrix" );
+		*p << osc::Blob( m.getConstBuffer(), m.getSize()*sizeof(float) );
+		*p << osc::EndMessage;
+	}
+	else
+	{
+		// /t3d/mtx (int)sequence (int)flags (int)width (int)height (blob)data
+		if(!mMatrixEncoder.encode(m.getConstBuffer(), m.getWidth(), m.getHeight())) return;
+		*p << osc::BeginMessage( "/t3d/mtx" );
+		*p << (osc::int32)mMatrixEncoder.getSequence() << (osc::int32)mMatrixEncoder.getFlags();
+		*p << (osc::int32)mMatrixEncoder.getWidth() << (osc::int32)mMatrixEncoder.getHeight();
+		*p << osc::Blob( mMatrixEncoder.getPayload(), mMatrixEncoder.getPayloadSize() );
+		*p << osc::EndMessage;
+	}
 	
-	socket->Send( p->Data(), p->Size() );
+	sendPacket(0, p->Data(), p->Size(), mMatrixDestinations);
+	mBatchSender.flush();
 }
 
-
+void SoundplaneOSCOutput::sendLatencyStats(const char* stage, float p50, float p99, float pMax, int count)
+{
+	if(!mActive) return;
+	osc::OutboundPacketStream* p = getPacketStreamForOffset(0);
+	if(!p) return;
+	
+	*p << osc::BeginMessage( "/t3d/lat" );
+	*p << stage << p50 << p99 << pMax << (osc::int32)count;
+	*p << osc::EndMessage;
+	
+	sendPacket(0, p->Data(), p->Size(), mT3DDestinations);
+	mBatchSender.flush();
+}
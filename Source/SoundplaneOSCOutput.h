@@ -19,6 +19,10 @@
 #include "JuceHeader.h"
 
 #include "Touch.h"
+#include "OSCPacketTemplate.h"
+#include "UDPBatchSender.h"
+#include "MatrixStream.h"
+#include "OSCDestination.h"
 
 #include "OscOutboundPacketStream.h"
 #include "UdpSocket.h"
@@ -29,6 +33,18 @@ const int kUDPOutputBufferSize = 4096;
 
 using namespace std::chrono;
 
+// ports with no touches get a frame at least this often.
+const milliseconds kHeartbeatInterval{250};
+
+// formats for the optional matrix output. kMatrixFloat sends the legacy /t3d/matrix
+// message, the others send the compressed /t3d/mtx stream.
+enum SoundplaneMatrixFormat
+{
+	kMatrixFloat = 0,
+	kMatrixFloat16,
+	kMatrixUInt8
+};
+
 class SoundplaneOSCOutput :
 public SoundplaneOutput
 {
@@ -40,7 +56,12 @@ public:
 	void setKymaMode(bool m);
 	
 	void setHostName(const std::string& str) { mHostName = str; }
+	const std::string& getHostName() const { return mHostName; }
 	void setPort(int p) { mCurrentBaseUDPPort = p; }
+	
+	// destinations to send to in addition to the primary one set by host name and port.
+	// Takes effect at the next reconnect().
+	void setDestinations(const std::vector< OSCDestination >& d) { mExtraDestinations = d; }
 	void reconnect();
 	
 	// SoundplaneOutput
@@ -50,7 +71,7 @@ public:
 	void endOutputFrame() override;
 	void clear() override;
 
-	void setDataRate(int r) { mDataRate = r; }
+	void setDataRate(int r) { mDataRate = r; updateMatrixKeyframeInterval(); }
 	
 	void setActive(bool v);
 	void setMaxTouches(int t) { mMaxTouches = ml::clamp(t, 0, kMaxTouches); }
@@ -59,8 +80,18 @@ public:
 	void notify(int connected);
 	void doInfrequentTasks();
 	
+	// matrix output settings. A rate of 0 sends the matrix with every output frame.
+	void setMatrixRate(float hz);
+	void setMatrixDecimation(int d) { mMatrixEncoder.setDecimation(d); }
+	void setMatrixFormat(int f);
+	bool isMatrixFrameDue() const;
 	void processMatrix(const ml::Matrix& m);
 	
+	const UDPBatchSender& getBatchSender() const { return mBatchSender; }
+	
+	// send latency statistics for one processing stage, in milliseconds.
+	void sendLatencyStats(const char* stage, float p50, float p99, float pMax, int count);
+	
 private:
 	void initializeSocket(int port);
 	osc::OutboundPacketStream* getPacketStreamForOffset(int offset);
@@ -74,15 +105,61 @@ private:
 	void sendInfrequentData();
 	void sendInfrequentDataToKyma();
 	
+	void setupDestinations();
+	uint32_t getDueDestinations(uint32_t destinations);
+	
 	int mMaxTouches;
 	
 	std::array< TouchArray, kNumUDPPorts > mTouchesByPort;
+	std::array< TouchMask, kNumUDPPorts > mActiveByPort{};
 	std::array< ZoneMessage, kSoundplaneAMaxZones > mControllersByZone;
 	std::array< ZoneMessage, kSoundplaneAMaxZones > mSentControllersByZone;
 	
+	// prebuilt packets for touches and controllers, patched each frame.
+	std::array< T3DFrameTemplate, kNumUDPPorts > mFrameTemplates;
+	std::array< OSCMessageTemplate, kSoundplaneAMaxZones > mControllerTemplates;
+	std::array< ml::Symbol, kSoundplaneAMaxZones > mControllerTemplateNames{};
+	std::array< ZoneType, kSoundplaneAMaxZones > mControllerTemplateTypes{};
+	void buildControllerTemplate(int zoneID, const ZoneMessage& c);
+	
+	// queue a packet for the batch sender to each destination whose bit is set. The
+	// primary destination's packets are sent right away if the batch sender can't reach it.
+	void sendPacket(int portOffset, const char* data, size_t size, uint32_t destinations);
+	UDPBatchSender mBatchSender;
+	
+	// each destination that frames are sent to: the primary one at index 0, then the
+	// ones from setDestinations(). Each packet is encoded once and sent to all the
+	// destinations that want it.
+	struct DestinationState
+	{
+		OSCDestination config{};
+		time_point<system_clock> prevFrameTime{};
+		std::array< bool, kNumUDPPorts > portHadTouches{};
+		std::array< time_point<system_clock>, kNumUDPPorts > prevPortSendTime{};
+		std::array< uint32_t, kNumUDPPorts > sentPortVersion{};
+	};
+	static constexpr int kMaxDestinations = UDPBatchSender::kMaxDestinations;
+	std::array< DestinationState, kMaxDestinations > mDestinations{};
+	std::vector< OSCDestination > mExtraDestinations;
+	uint32_t mT3DDestinations{0};
+	uint32_t mKymaDestinations{0};
+	uint32_t mMatrixDestinations{0};
+	
+	// the touch messages of each port's last frame, and a count of their changes, so
+	// that destinations can skip frames where nothing changed.
+	std::array< std::array< char, T3DFrameTemplate::kMaxSize - T3DFrameTemplate::kHeaderSize >, kNumUDPPorts > mPrevTouchData{};
+	std::array< size_t, kNumUDPPorts > mPrevTouchSize{};
+	std::array< uint32_t, kNumUDPPorts > mPortVersion{};
+	
 	int mDataRate{100};
 	time_point<system_clock> mFrameTime;
 	
+	void updateMatrixKeyframeInterval();
+	MatrixStreamEncoder mMatrixEncoder;
+	int mMatrixFormat{kMatrixFloat};
+	float mMatrixRate{0.f};
+	time_point<system_clock> mPrevMatrixTime;
+	
 	std::vector< std::vector < char > > mUDPBuffers;
 	std::vector< std::unique_ptr< osc::OutboundPacketStream > > mUDPPacketStreams;
 	std::vector< std::unique_ptr< UdpTransmitSocket > > mUDPSockets;
@@ -17,11 +17,14 @@ using namespace std::chrono;
 class SoundplaneOutput
 {
 public:
-	SoundplaneOutput() : mActive(false) {}
+	SoundplaneOutput() : mActive(false), mSentFrame(false) {}
 	virtual ~SoundplaneOutput() {}
 	
 	bool isActive() { return mActive; }
 	
+	// true if the last endOutputFrame() sent anything.
+	bool sentFrame() const { return mSentFrame; }
+	
 	virtual void beginOutputFrame(time_point<system_clock> now) = 0;
 	virtual void processTouch(int i, int offset, const Touch& m) = 0;
 	virtual void processController(int z, int offset, const ZoneMessage& m) = 0;
@@ -30,5 +33,6 @@ public:
 	
 protected:
 	bool mActive;
+	bool mSentFrame;
 };
 
@@ -0,0 +1,182 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "SoundplaneShmOutput.h"
+#include "MLDebug.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SOUNDPLANE_SHM_AVAILABLE 1
+#else
+#define SOUNDPLANE_SHM_AVAILABLE 0
+#endif
+
+namespace
+{
+	int32_t controllerTypeCode(ZoneType t)
+	{
+		switch(t)
+		{
+			case kZoneTypeX: return SOUNDPLANE_SHM_CONTROLLER_X;
+			case kZoneTypeY: return SOUNDPLANE_SHM_CONTROLLER_Y;
+			case kZoneTypeXY: return SOUNDPLANE_SHM_CONTROLLER_XY;
+			case kZoneTypeZ: return SOUNDPLANE_SHM_CONTROLLER_Z;
+			case kZoneTypeToggle: return SOUNDPLANE_SHM_CONTROLLER_TOGGLE;
+			default: return 0;
+		}
+	}
+}
+
+// --------------------------------------------------------------------------------
+#pragma mark SoundplaneShmOutput
+
+SoundplaneShmOutput::SoundplaneShmOutput()
+{
+}
+
+SoundplaneShmOutput::~SoundplaneShmOutput()
+{
+#if SOUNDPLANE_SHM_AVAILABLE
+	if(mpHeader)
+	{
+		munmap(mpHeader, sizeof(soundplane_shm_header));
+		shm_unlink(mName.c_str());
+	}
+#endif
+}
+
+void SoundplaneShmOutput::setActive(bool v)
+{
+	if(v && !mpHeader)
+	{
+		if(!create())
+		{
+			MLConsole() << "SoundplaneShmOutput: could not create shared memory " << mName << "\n";
+			v = false;
+		}
+	}
+	mActive = v;
+}
+
+// create or reuse the segment and write a fresh header. The magic number is written
+// last, so readers never accept a header that is only partly written.
+bool SoundplaneShmOutput::create()
+{
+#if SOUNDPLANE_SHM_AVAILABLE
+	const size_t size = sizeof(soundplane_shm_header);
+	int fd = shm_open(mName.c_str(), O_CREAT | O_RDWR, 0644);
+	if(fd < 0) return false;
+	if(ftruncate(fd, size) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if(p == MAP_FAILED) return false;
+
+	soundplane_shm_header* h = static_cast<soundplane_shm_header*>(p);
+	__atomic_store_n(&h->magic, 0u, __ATOMIC_RELEASE);
+	__atomic_store_n(&h->frames_written, 0, __ATOMIC_RELEASE);
+	for(int i=0; i<SOUNDPLANE_SHM_SLOTS; ++i)
+	{
+		__atomic_store_n(&h->slots[i].seq, 0, __ATOMIC_RELEASE);
+	}
+	h->version = SOUNDPLANE_SHM_VERSION;
+	h->slot_count = SOUNDPLANE_SHM_SLOTS;
+	h->slot_size = sizeof(soundplane_shm_slot);
+	__atomic_store_n(&h->magic, SOUNDPLANE_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	mpHeader = h;
+	mFrameCount = 0;
+	MLConsole() << "SoundplaneShmOutput: publishing to " << mName << "\n";
+	return true;
+#else
+	return false;
+#endif
+}
+
+// claim the next slot. Its seq is made odd before anything in it changes.
+void SoundplaneShmOutput::beginOutputFrame(time_point<system_clock> now)
+{
+	if(!mActive) return;
+	mpSlot = &mpHeader->slots[mFrameCount % SOUNDPLANE_SHM_SLOTS];
+	__atomic_store_n(&mpSlot->seq, 2*mFrameCount + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	soundplane_shm_frame& f = mpSlot->frame;
+	f.frame = mFrameCount;
+	f.time_ns = duration_cast<nanoseconds>(now.time_since_epoch()).count();
+	f.num_touches = 0;
+	f.num_controllers = 0;
+	f.has_sensor = 0;
+}
+
+void SoundplaneShmOutput::processTouch(int i, int offset, const Touch& t)
+{
+	if(!mpSlot) return;
+	soundplane_shm_frame& f = mpSlot->frame;
+	if(f.num_touches >= SOUNDPLANE_SHM_MAX_TOUCHES) return;
+
+	soundplane_shm_touch& st = f.touches[f.num_touches++];
+	st.voice = i;
+	st.offset = offset;
+	st.state = t.state;
+	st.x = t.x;
+	st.y = t.y;
+	st.z = t.z;
+	st.dz = t.dz;
+	st.note = t.note;
+	st.vibrato = t.vibrato;
+	st.reserved = 0;
+}
+
+void SoundplaneShmOutput::processController(int zoneID, int offset, const ZoneMessage& m)
+{
+	if(!mpSlot) return;
+	soundplane_shm_frame& f = mpSlot->frame;
+	if(f.num_controllers >= SOUNDPLANE_SHM_MAX_CONTROLLERS) return;
+
+	soundplane_shm_controller& c = f.controllers[f.num_controllers++];
+	c.zone = zoneID;
+	c.offset = offset;
+	c.type = controllerTypeCode(m.type);
+	c.number1 = m.number1;
+	c.number2 = m.number2;
+	c.x = m.x;
+	c.y = m.y;
+	c.z = m.z;
+	snprintf(c.name, sizeof(c.name), "%s", m.name.getTextFragment().getText());
+}
+
+void SoundplaneShmOutput::processSensorFrame(const SensorFrame& sf)
+{
+	if(!mpSlot) return;
+	soundplane_shm_frame& f = mpSlot->frame;
+	static_assert(sizeof(f.sensor) == sizeof(float)*SensorGeometry::width*SensorGeometry::height,
+		"shared memory sensor frame must match the sensor geometry");
+	std::memcpy(f.sensor, sf.data(), sizeof(f.sensor));
+	f.has_sensor = 1;
+}
+
+// publish the frame: complete its seq, then advance the frame count readers poll.
+void SoundplaneShmOutput::endOutputFrame()
+{
+	mSentFrame = (mpSlot != nullptr);
+	if(!mpSlot) return;
+	__atomic_store_n(&mpSlot->seq, 2*mFrameCount + 2, __ATOMIC_RELEASE);
+	mFrameCount++;
+	__atomic_store_n(&mpHeader->frames_written, mFrameCount, __ATOMIC_RELEASE);
+	mpSlot = nullptr;
+}
+
+void SoundplaneShmOutput::clear()
+{
+}
@@ -0,0 +1,46 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <string>
+
+#include "SoundplaneOutput.h"
+#include "soundplane_shm.h"
+
+// Publishes each output frame into a shared memory segment, described by
+// soundplane_shm.h, for readers on the same host. Writing never waits for readers.
+//
+// The segment is created on the first activation and stays mapped until the output is
+// destroyed, so that deactivating never unmaps memory the process thread is writing.
+
+class SoundplaneShmOutput :
+public SoundplaneOutput
+{
+public:
+	SoundplaneShmOutput();
+	~SoundplaneShmOutput();
+
+	void setName(const std::string& name) { mName = name; }
+	void setActive(bool v);
+
+	// SoundplaneOutput
+	void beginOutputFrame(time_point<system_clock> now) override;
+	void processTouch(int i, int offset, const Touch& m) override;
+	void processController(int z, int offset, const ZoneMessage& m) override;
+	void endOutputFrame() override;
+	void clear() override;
+
+	// add the calibrated pressure to the current frame.
+	void processSensorFrame(const SensorFrame& f);
+
+private:
+	bool create();
+
+	std::string mName{SOUNDPLANE_SHM_DEFAULT_NAME};
+	soundplane_shm_header* mpHeader{nullptr};
+	soundplane_shm_slot* mpSlot{nullptr};
+	uint64_t mFrameCount{0};
+};
@@ -92,7 +92,7 @@ void SoundplaneTouchGraphView::renderTouchBarGraphs()
     glColor4fv(indLight);
     MLRect r(0, 0, numSize, numSize);
     MLRect tr = r.translated(Vec2(margin, margin + j*frameOffset + (frameHeight - numSize)/2));
-    int age = currentTouch(ageColumn, j);
+    int age = currentTouch(j, ageRow);
     if (age > 0)
     {
       glColor4fv(indLight);
@@ -120,7 +120,7 @@ void SoundplaneTouchGraphView::renderTouchBarGraphs()
     for(int i=fr.left() + 1; i<fr.right()-1; ++i)
     {
       int time = frameXRange(i);
-      float force = touchHistory(2, j, time);
+      float force = touchHistory(j, zRow, time);
       force =  ml::clamp(force, 0.f, 1.f);
       float y = frameYRange.convert(force);
       // draw line
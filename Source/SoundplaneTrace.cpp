@@ -0,0 +1,179 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "SoundplaneTrace.h"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace SoundplaneTrace
+{
+	std::atomic<bool> gEnabled{false};
+
+	namespace
+	{
+		// a ring of events with a single writer, the owning thread. Readers copy events
+		// out and then check the write count again to discard any that were overwritten
+		// while copying.
+		struct ThreadRing
+		{
+			std::array<Event, kEventsPerThread> events;
+			std::atomic<uint32_t> writeCount{0};
+			int threadID;
+			std::string threadName;
+		};
+
+		// rings are never freed, so that events from threads that have exited can still be dumped.
+		std::mutex& getRegistryMutex()
+		{
+			static std::mutex m;
+			return m;
+		}
+
+		std::vector< std::unique_ptr<ThreadRing> >& getRegistry()
+		{
+			static std::vector< std::unique_ptr<ThreadRing> > r;
+			return r;
+		}
+
+		thread_local ThreadRing* tRing = nullptr;
+
+		// a reference point pairing the tick counter with steady_clock, taken when tracing
+		// is enabled. A second pair taken when writing gives the tick period.
+		struct ClockReference
+		{
+			uint64_t ticks;
+			int64_t nanos;
+		};
+
+		ClockReference gClockReference{0, 0};
+
+		ClockReference getClockReference()
+		{
+			ClockReference c;
+			c.ticks = now();
+			c.nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			return c;
+		}
+
+		ThreadRing* addRing(const char* threadName)
+		{
+			std::lock_guard<std::mutex> lock(getRegistryMutex());
+			auto& registry = getRegistry();
+			std::unique_ptr<ThreadRing> r(new ThreadRing());
+			r->threadID = static_cast<int>(registry.size()) + 1;
+			r->threadName = threadName;
+			registry.push_back(std::move(r));
+			return registry.back().get();
+		}
+
+		void writeEscaped(std::ostream& out, const char* str)
+		{
+			for(const char* c = str; *c; ++c)
+			{
+				if((*c == '"') || (*c == '\\'))
+				{
+					out << '\\';
+				}
+				out << *c;
+			}
+		}
+	}
+
+	void setEnabled(bool b)
+	{
+		if(kCompiledIn && b)
+		{
+			std::lock_guard<std::mutex> lock(getRegistryMutex());
+			gClockReference = getClockReference();
+		}
+		gEnabled.store(kCompiledIn && b, std::memory_order_relaxed);
+	}
+
+	void registerThread(const char* threadName)
+	{
+		if(!tRing)
+		{
+			tRing = addRing(threadName);
+		}
+	}
+
+	void record(const char* name, uint64_t beginTicks, uint64_t endTicks)
+	{
+		if(!tRing)
+		{
+			tRing = addRing("thread");
+		}
+		uint32_t n = tRing->writeCount.load(std::memory_order_relaxed);
+		Event& e = tRing->events[n & (kEventsPerThread - 1)];
+		e.name = name;
+		e.beginTicks = beginTicks;
+		e.endTicks = endTicks;
+		tRing->writeCount.store(n + 1, std::memory_order_release);
+	}
+
+	void writeJSON(std::ostream& out)
+	{
+		std::lock_guard<std::mutex> lock(getRegistryMutex());
+		std::vector<Event> events;
+		events.reserve(kEventsPerThread);
+		bool first = true;
+
+		ClockReference ref = gClockReference;
+		ClockReference current = getClockReference();
+		double microsPerTick = 0.001;
+		if(current.ticks > ref.ticks)
+		{
+			microsPerTick = 0.001*(current.nanos - ref.nanos)/(double)(current.ticks - ref.ticks);
+		}
+
+		out << std::fixed;
+		out.precision(3);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		for(auto& r : getRegistry())
+		{
+			if(!first) out << ",\n";
+			first = false;
+			out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << r->threadID << ",\"args\":{\"name\":\"";
+			writeEscaped(out, r->threadName.c_str());
+			out << "\"}}";
+
+			uint32_t end = r->writeCount.load(std::memory_order_acquire);
+			uint32_t count = (end < kEventsPerThread) ? end : kEventsPerThread;
+			uint32_t start = end - count;
+			events.clear();
+			for(uint32_t i = start; i != end; ++i)
+			{
+				events.push_back(r->events[i & (kEventsPerThread - 1)]);
+			}
+
+			// skip any events the writer may have overwritten, or been writing, while we were copying.
+			uint32_t endAfterCopy = r->writeCount.load(std::memory_order_acquire);
+			for(uint32_t i = 0; i < count; ++i)
+			{
+				if(endAfterCopy - (start + i) >= kEventsPerThread) continue;
+				const Event& e = events[i];
+				out << ",\n{\"name\":\"";
+				writeEscaped(out, e.name);
+				out << "\",\"cat\":\"soundplane\",\"ph\":\"X\",\"pid\":1,\"tid\":" << r->threadID;
+				out << ",\"ts\":" << ((int64_t)(e.beginTicks - ref.ticks))*microsPerTick;
+				out << ",\"dur\":" << (e.endTicks - e.beginTicks)*microsPerTick << "}";
+			}
+		}
+		out << "\n]}\n";
+	}
+
+	bool dumpToFile(const std::string& path)
+	{
+		std::ofstream out(path);
+		if(!out) return false;
+		writeJSON(out);
+		return out.good();
+	}
+}
@@ -0,0 +1,110 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// A timeline tracer for the processing threads. Each traced scope records one event
+// with its begin and end times into a ring buffer owned by the calling thread, so
+// recording takes no locks and makes no allocations. The most recent events of all
+// threads can be written out in the Chrome trace_event JSON format and viewed in
+// chrome://tracing or Perfetto.
+//
+// Tracing is compiled in only when SOUNDPLANE_TRACE is defined to 1, in which case
+// it can be turned on and off at runtime with setEnabled(). Otherwise the macros
+// below compile to nothing.
+
+#ifndef SOUNDPLANE_TRACE
+#define SOUNDPLANE_TRACE 0
+#endif
+
+namespace SoundplaneTrace
+{
+	constexpr bool kCompiledIn = SOUNDPLANE_TRACE;
+
+	// events kept per thread. Older events are overwritten.
+	constexpr int kEventsPerThreadBits = 15;
+	constexpr uint32_t kEventsPerThread = 1u << kEventsPerThreadBits;
+
+	struct Event
+	{
+		const char* name;
+		uint64_t beginTicks;
+		uint64_t endTicks;
+	};
+
+	extern std::atomic<bool> gEnabled;
+
+	inline bool isEnabled() { return kCompiledIn && gEnabled.load(std::memory_order_relaxed); }
+	void setEnabled(bool b);
+
+	// read the CPU's cycle or virtual counter where we can, which is several times
+	// cheaper than steady_clock. Ticks are converted to time when events are written out.
+	inline uint64_t now()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#elif defined(__aarch64__)
+		uint64_t t;
+		asm volatile("mrs %0, cntvct_el0" : "=r"(t));
+		return t;
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// name the calling thread and allocate its ring buffer. Threads that record
+	// events without calling this first are registered on their first event.
+	void registerThread(const char* threadName);
+
+	// name must point to static storage, typically a string literal.
+	void record(const char* name, uint64_t beginTicks, uint64_t endTicks);
+
+	// write all buffered events as trace_event JSON.
+	void writeJSON(std::ostream& out);
+	bool dumpToFile(const std::string& path);
+
+	class Scope
+	{
+	public:
+		explicit Scope(const char* name) :
+			mName(isEnabled() ? name : nullptr),
+			mBeginTicks(mName ? now() : 0) {}
+
+		~Scope()
+		{
+			if(mName)
+			{
+				record(mName, mBeginTicks, now());
+			}
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		const char* mName;
+		uint64_t mBeginTicks;
+	};
+}
+
+#if SOUNDPLANE_TRACE
+#define SP_TRACE_CONCAT_IMPL(a, b) a##b
+#define SP_TRACE_CONCAT(a, b) SP_TRACE_CONCAT_IMPL(a, b)
+#define SP_TRACE_SCOPE(name) SoundplaneTrace::Scope SP_TRACE_CONCAT(spTraceScope, __LINE__)(name)
+#define SP_TRACE_THREAD(name) SoundplaneTrace::registerThread(name)
+#else
+#define SP_TRACE_SCOPE(name)
+#define SP_TRACE_THREAD(name)
+#endif
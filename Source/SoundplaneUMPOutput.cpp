@@ -0,0 +1,226 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "SoundplaneUMPOutput.h"
+
+#include <cmath>
+#include <thread>
+
+// --------------------------------------------------------------------------------
+#pragma mark SoundplaneUMPOutput
+
+// the process thread only calls an active output, so voices can be reset here before
+// starting. Stopping is done by the process thread at the end of its next frame.
+void SoundplaneUMPOutput::setActive(bool v)
+{
+	if(v)
+	{
+		mStopRequested.store(false, std::memory_order_release);
+		if(!mActive)
+		{
+			mVoices.fill(UMPVoice());
+			mNumWords = 0;
+			mActive = true;
+		}
+	}
+	else if(mActive)
+	{
+		mStopRequested.store(true, std::memory_order_release);
+	}
+}
+
+// endOutputFrame() sets mSending before it reads the transport, so once mSending is
+// seen clear after the new transport is stored, any later frame will use the new one.
+// A send takes microseconds, so waiting for one to finish is brief.
+void SoundplaneUMPOutput::setTransport(UMPTransport* t)
+{
+	mpTransport.store(t);
+	while(mSending.load())
+	{
+		std::this_thread::yield();
+	}
+}
+
+void SoundplaneUMPOutput::beginOutputFrame(time_point<system_clock> now)
+{
+	mNumWords = 0;
+}
+
+void SoundplaneUMPOutput::processTouch(int i, int offset, const Touch& t)
+{
+	if((i < 0) || (i >= kMaxTouches)) return;
+	UMPVoice& v = mVoices[i];
+	float pitch = ml::clamp(t.note + t.vibrato, 0.f, 127.99f);
+
+	switch(t.state)
+	{
+		case kTouchStateOn:
+		{
+			// a voice should be off before it starts again, but make sure.
+			if(v.sounding)
+			{
+				v.sendNoteOff = true;
+				v.offNote = v.note;
+			}
+			v.pitch = pitch;
+			v.note = findNoteNumber(pitch, i);
+			float velocity = ml::clamp(t.dz*20000.f, 10.f, 127.f)/127.f;
+			v.velocity = static_cast<uint16_t>(velocity*65535.f);
+			v.sendNoteOn = true;
+
+			// the note on carries the pitch. The other controllers were reset by
+			// per-note management, so they are always sent with the note.
+			v.pitchValue = v.sentPitchValue = static_cast<uint32_t>(pitch*33554432.0);
+			v.pressure = UMP::unitToUInt32(t.z);
+			v.x = UMP::unitToUInt32(t.x);
+			v.y = UMP::unitToUInt32(t.y);
+			v.sentPressure = ~v.pressure;
+			v.sentX = ~v.x;
+			v.sentY = ~v.y;
+			break;
+		}
+		case kTouchStateContinue:
+			v.pitch = pitch;
+			v.pitchValue = static_cast<uint32_t>(pitch*33554432.0);
+			v.pressure = UMP::unitToUInt32(t.z);
+			v.x = UMP::unitToUInt32(t.x);
+			v.y = UMP::unitToUInt32(t.y);
+			break;
+
+		case kTouchStateOff:
+			if(v.sounding || v.sendNoteOn)
+			{
+				v.sendNoteOff = true;
+				v.offNote = v.note;
+			}
+			break;
+	}
+}
+
+void SoundplaneUMPOutput::processController(int zoneID, int offset, const ZoneMessage& m)
+{
+}
+
+// the note number nearest the pitch that no other sounding voice is using.
+int SoundplaneUMPOutput::findNoteNumber(float pitch, int voiceIdx)
+{
+	int nearest = ml::clamp(static_cast<int>(lroundf(pitch)), 0, 127);
+	for(int d=0; d<128; ++d)
+	{
+		for(int sign = 1; sign >= -1; sign -= 2)
+		{
+			int n = nearest + d*sign;
+			if((n < 0) || (n > 127)) continue;
+			bool used = false;
+			for(int i=0; i<kMaxTouches; ++i)
+			{
+				const UMPVoice& v = mVoices[i];
+				if((i != voiceIdx) && (v.sounding || v.sendNoteOn) && !v.sendNoteOff && (v.note == n))
+				{
+					used = true;
+					break;
+				}
+			}
+			if(!used) return n;
+			if(d == 0) break;
+		}
+	}
+	return nearest;
+}
+
+uint32_t* SoundplaneUMPOutput::addPacket()
+{
+	if(mNumWords + 2 > kMaxFrameWords) return nullptr;
+	uint32_t* w = mWords.data() + mNumWords;
+	mNumWords += 2;
+	return w;
+}
+
+// note offs first, then note ons, then the controllers of all sounding notes.
+void SoundplaneUMPOutput::addVoicePackets()
+{
+	const int ch = mChannel - 1;
+	uint32_t* w;
+
+	for(auto& v : mVoices)
+	{
+		if(v.sendNoteOff)
+		{
+			if((w = addPacket())) UMP::noteOff(w, mGroup, ch, v.offNote, 0);
+			v.sounding = false;
+			v.sendNoteOff = false;
+		}
+	}
+
+	for(auto& v : mVoices)
+	{
+		if(v.sendNoteOn)
+		{
+			if((w = addPacket())) UMP::perNoteManagement(w, mGroup, ch, v.note, UMP::kManagementDetach | UMP::kManagementReset);
+			uint16_t attribute = static_cast<uint16_t>(v.pitch*512.f);
+			if((w = addPacket())) UMP::noteOn(w, mGroup, ch, v.note, v.velocity, UMP::kAttributePitch79, attribute);
+			v.sounding = true;
+			v.sendNoteOn = false;
+		}
+	}
+
+	for(auto& v : mVoices)
+	{
+		if(!v.sounding) continue;
+		if(v.pitchValue != v.sentPitchValue)
+		{
+			if((w = addPacket())) UMP::registeredPerNoteController(w, mGroup, ch, v.note, UMP::kControllerPitch725, v.pitchValue);
+			v.sentPitchValue = v.pitchValue;
+		}
+		if(v.pressure != v.sentPressure)
+		{
+			if((w = addPacket())) UMP::polyPressure(w, mGroup, ch, v.note, v.pressure);
+			v.sentPressure = v.pressure;
+		}
+		if(v.x != v.sentX)
+		{
+			if((w = addPacket())) UMP::registeredPerNoteController(w, mGroup, ch, v.note, 73, v.x);
+			v.sentX = v.x;
+		}
+		if(v.y != v.sentY)
+		{
+			if((w = addPacket())) UMP::registeredPerNoteController(w, mGroup, ch, v.note, 74, v.y);
+			v.sentY = v.y;
+		}
+	}
+}
+
+void SoundplaneUMPOutput::endOutputFrame()
+{
+	bool stopping = mStopRequested.exchange(false, std::memory_order_acq_rel);
+	if(stopping)
+	{
+		clear();
+	}
+	addVoicePackets();
+	mSending.store(true);
+	UMPTransport* pTransport = mpTransport.load();
+	mSentFrame = pTransport && mNumWords && pTransport->send(mWords.data(), mNumWords);
+	mSending.store(false, std::memory_order_release);
+	mNumWords = 0;
+	if(stopping)
+	{
+		mActive = false;
+	}
+}
+
+// turn off every sounding note, and drop note ons not sent yet.
+void SoundplaneUMPOutput::clear()
+{
+	for(auto& v : mVoices)
+	{
+		if(v.sounding && !v.sendNoteOff)
+		{
+			v.sendNoteOff = true;
+			v.offNote = v.note;
+		}
+		v.sendNoteOn = false;
+	}
+}
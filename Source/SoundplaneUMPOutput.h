@@ -0,0 +1,153 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <stdint.h>
+
+#include "SoundplaneOutput.h"
+#include "Touch.h"
+#include "UMPTransport.h"
+
+// MIDI 2.0 channel voice messages, as 64-bit Universal MIDI Packets.
+
+namespace UMP
+{
+	const uint32_t kMessageTypeMIDI2 = 0x4;
+
+	// status nibbles
+	const int kRegisteredPerNoteController = 0x0;
+	const int kAssignablePerNoteController = 0x1;
+	const int kNoteOff = 0x8;
+	const int kNoteOn = 0x9;
+	const int kPolyPressure = 0xA;
+	const int kPerNoteManagement = 0xF;
+
+	// note attribute type for a pitch in 7.9 fixed point.
+	const int kAttributePitch79 = 0x3;
+
+	// registered per-note controller for an absolute pitch in 7.25 fixed point.
+	const int kControllerPitch725 = 3;
+
+	// per-note management option flags
+	const int kManagementReset = 0x1;
+	const int kManagementDetach = 0x2;
+
+	inline void channelVoice(uint32_t* w, int group, int status, int channel, int index1, int index2, uint32_t data)
+	{
+		w[0] = (kMessageTypeMIDI2 << 28) | ((group & 0xF) << 24) | ((status & 0xF) << 20) |
+			((channel & 0xF) << 16) | ((index1 & 0xFF) << 8) | (index2 & 0xFF);
+		w[1] = data;
+	}
+
+	inline void noteOn(uint32_t* w, int group, int channel, int note, uint16_t velocity, int attributeType, uint16_t attribute)
+	{
+		channelVoice(w, group, kNoteOn, channel, note & 0x7F, attributeType, (static_cast<uint32_t>(velocity) << 16) | attribute);
+	}
+
+	inline void noteOff(uint32_t* w, int group, int channel, int note, uint16_t velocity)
+	{
+		channelVoice(w, group, kNoteOff, channel, note & 0x7F, 0, static_cast<uint32_t>(velocity) << 16);
+	}
+
+	inline void polyPressure(uint32_t* w, int group, int channel, int note, uint32_t pressure)
+	{
+		channelVoice(w, group, kPolyPressure, channel, note & 0x7F, 0, pressure);
+	}
+
+	inline void registeredPerNoteController(uint32_t* w, int group, int channel, int note, int index, uint32_t value)
+	{
+		channelVoice(w, group, kRegisteredPerNoteController, channel, note & 0x7F, index, value);
+	}
+
+	inline void perNoteManagement(uint32_t* w, int group, int channel, int note, int flags)
+	{
+		channelVoice(w, group, kPerNoteManagement, channel, note & 0x7F, flags, 0);
+	}
+
+	// scale a value from 0-1 to the full unsigned 32-bit range.
+	inline uint32_t unitToUInt32(float v)
+	{
+		v = (v > 0.f) ? ((v < 1.f) ? v : 1.f) : 0.f;
+		return static_cast<uint32_t>(static_cast<double>(v)*4294967295.0);
+	}
+}
+
+// Sends touches as MIDI 2.0 notes on one channel. Each note starts with its exact
+// pitch as a 7.9 note attribute and a 16-bit velocity. While it sounds, its pitch
+// is sent as the 7.25 pitch per-note controller, its pressure as 32-bit poly
+// pressure, and x and y as registered per-note controllers 73 and 74, matching the
+// CC numbers of the MIDI 1.0 output. Each value is sent only when it changes.
+//
+// Note numbers only identify notes, because the pitch is always sent separately.
+// Each note gets the number nearest its starting pitch that no other sounding note
+// has, and per-note management detaches and resets it before the note starts.
+//
+// Packets for a frame are collected and handed to the transport in one call.
+
+class SoundplaneUMPOutput :
+public SoundplaneOutput
+{
+public:
+	SoundplaneUMPOutput() {}
+	~SoundplaneUMPOutput() {}
+
+	// going inactive waits for the next output frame, which sends note offs for the
+	// sounding notes, so none are left hanging.
+	void setActive(bool v);
+
+	// returns once the process thread is no longer sending to the previous transport,
+	// so that it can be closed.
+	void setTransport(UMPTransport* t);
+	void setChannel(int c) { mChannel = ml::clamp(c, 1, 16); }
+	void setGroup(int g) { mGroup = ml::clamp(g, 0, 15); }
+
+	// SoundplaneOutput
+	void beginOutputFrame(time_point<system_clock> now) override;
+	void processTouch(int i, int offset, const Touch& m) override;
+	void processController(int z, int offset, const ZoneMessage& m) override;
+	void endOutputFrame() override;
+	void clear() override;
+
+private:
+	struct UMPVoice
+	{
+		bool sounding{false};
+		bool sendNoteOn{false};
+		bool sendNoteOff{false};
+		int note{0};
+		int offNote{0};
+		float pitch{0.f};
+		uint16_t velocity{0};
+		uint32_t pitchValue{0};
+		uint32_t pressure{0};
+		uint32_t x{0};
+		uint32_t y{0};
+		uint32_t sentPitchValue{0};
+		uint32_t sentPressure{0};
+		uint32_t sentX{0};
+		uint32_t sentY{0};
+	};
+
+	int findNoteNumber(float pitch, int voiceIdx);
+	uint32_t* addPacket();
+	void addVoicePackets();
+
+	// the most words one frame can need: note off, management, note on and four
+	// controllers for every voice.
+	static constexpr size_t kMaxFrameWords = kMaxTouches*2*7;
+
+	std::array< UMPVoice, kMaxTouches > mVoices{};
+	std::array< uint32_t, kMaxFrameWords > mWords{};
+	size_t mNumWords{0};
+
+	std::atomic<UMPTransport*> mpTransport{nullptr};
+	std::atomic<bool> mSending{false};
+	std::atomic<bool> mStopRequested{false};
+	int mChannel{1};
+	int mGroup{0};
+};
@@ -55,6 +55,7 @@ SoundplaneFooterView::SoundplaneFooterView(SoundplaneModel* pModel, MLWidget::Li
 MLAppView(pResp, pRep),
 mpDevice(0),
 mpStatus(0),
+mpHealth(0),
 mCalibrateState(0),
 mCalibrateProgress(0.)
 {
@@ -77,6 +78,11 @@ mCalibrateProgress(0.)
 	mpStatus->setJustification(Justification::topRight);
 	mpStatus->setResizeToText(false);
 	
+	mpHealth = addLabel("", MLRect(labelWidth, 0, w - labelWidth*2.f, h));
+	mpHealth->setFont(myLookAndFeel->mCaptionFont);
+	mpHealth->setJustification(Justification::centredTop);
+	mpHealth->setResizeToText(false);
+	
 	mpCalibrateText = addLabel("calibrating...", MLRect(w - labelWidth*0.75f, 0, labelWidth*0.25, h));
 	mpCalibrateText->setFont(myLookAndFeel->mCaptionFont);
 	mpCalibrateText->setJustification(Justification::topLeft);
@@ -105,6 +111,15 @@ void SoundplaneFooterView::setStatus (const char* stat, const char* client)
 	}
 }
 
+void SoundplaneFooterView::setHealth(const char* c)
+{
+	if(mpHealth)
+	{
+		mpHealth->setProperty("text", c);
+		mpHealth->repaint();
+	}
+}
+
 void SoundplaneFooterView::setHardware(const char* c)
 {
 	if(mpDevice)
@@ -317,6 +332,17 @@ mpModel(pModel)
 	}
 	pB = page0->addToggleButton("MPE", toggleRect.withCenter(4.25, bottomDialsY2), "midi_mpe", c2);
 	
+	// MPE zone split: member channels of the lower and upper zones, and what to do when a zone is full
+	pD = page0->addDial("lower chans", dialRect.withCenter(6.25, bottomDialsY), "midi_mpe_lower", c2);
+	pD->setRange(0., 15., 1.);
+	pD->setDefault(15);
+	pD = page0->addDial("upper chans", dialRect.withCenter(7.25, bottomDialsY), "midi_mpe_upper", c2);
+	pD->setRange(0., 15., 1.);
+	pD->setDefault(0);
+	pD = page0->addDial("steal", dialRect.withCenter(6.25, bottomDialsY2), "midi_mpe_steal", c2);
+	pD->setRange(0., 2., 1.);
+	pD->setDefault(1);
+	
 	mpMidiChannelDial = page0->addDial("channel", dialRect.withCenter(5.25, bottomDialsY2), "midi_channel", c2);
 	mpMidiChannelDial->setRange(1., 16., 1.);
 	
@@ -445,6 +471,25 @@ mpModel(pModel)
 	page2->addTextButton("select carriers", MLRect(0, 2, 3, 0.4), "select_carriers");
 	page2->addTextButton("restore defaults", MLRect(0, 3., 3, 0.4), "restore_defaults");
 	
+	// tracing controls only in builds with the tracer compiled in.
+	if(SoundplaneTrace::kCompiledIn)
+	{
+		page2->addTextButton("dump trace", MLRect(0, 4., 3, 0.4), "dump_trace");
+	}
+	
+	// shared memory output for local readers
+	pB = page2->addToggleButton("shared mem", toggleRect.withCenter(0.75, 5.5), "shm_active", c2);
+	pB = page2->addToggleButton("shm sensor", toggleRect.withCenter(2.25, 5.5), "shm_send_sensor", c2);
+	
+	// send each frame of MIDI at a fixed delay after the sensor frame
+	pB = page2->addToggleButton("midi dejitter", toggleRect.withCenter(3.75, 5.5), "midi_dejitter", c2);
+	
+	// MIDI 2.0 output, to the device in the ump_device property
+	pB = page2->addToggleButton("midi 2.0", toggleRect.withCenter(5.25, 5.5), "ump_active", c2);
+	
+	// hold changes too small to hear, for all outputs. Thresholds are the thin_* properties.
+	pB = page2->addToggleButton("thin", toggleRect.withCenter(6.5, 5.5), "thin_active", c2);
+	
 	// console
 	MLDebugDisplay* pDebug = page2->addDebugDisplay(MLRect(7., 2., 7., 5.));
 	pDebug->setBufferedToImage(true);
@@ -454,10 +499,41 @@ mpModel(pModel)
 	pD->setRange(0.01, 1.0, 0.01);
 	pD->setDefault(0.5);
 	
+	// matrix output: rate in Hz (0 = every frame), decimation, and format (0 = float, 1 = float16, 2 = 8-bit)
+	pD = page2->addDial("matrix rate", dialRect.withCenter(2, dialY), "osc_matrix_rate", c2);
+	pD->setRange(0., 500., 10.);
+	pD->setDefault(0.);
+	
+	pD = page2->addDial("matrix decim", dialRect.withCenter(3.5, dialY), "osc_matrix_decimation", c2);
+	pD->setRange(1., 4., 1.);
+	pD->setDefault(1.);
+	
+	pD = page2->addDial("matrix format", dialRect.withCenter(5, dialY), "osc_matrix_format", c2);
+	pD->setRange(0., 2., 1.);
+	pD->setDefault(0.);
+	
 	pB = page2->addToggleButton("test touches", toggleRect.withCenter(11, dialY), "test_touches", c2);
 	
 	pB = page2->addToggleButton("verbose", toggleRect.withCenter(13, dialY), "verbose", c2);
 	
+	if(SoundplaneTrace::kCompiledIn)
+	{
+		pB = page2->addToggleButton("trace", toggleRect.withCenter(7, dialY), "trace", c2);
+	}
+	
+	pB = page2->addToggleButton("send stats", toggleRect.withCenter(9, dialY), "osc_send_stats", c2);
+	
+	// latency from frame arrival to the end of each processing stage: p50 / p99 / max
+	pL = page2->addLabel("latency, ms (p50 / p99 / max)", MLRect(3.25, 2., 3.5, 0.4), 1.0f, eMLCaption);
+	pL->setJustification(Justification::centredLeft);
+	for(int i=0; i<kNumLatencyStages; ++i)
+	{
+		pL = page2->addLabel("---", MLRect(3.25, 2.5 + i*0.4, 3.5, 0.4));
+		pL->setResizeToText(false);
+		pL->setJustification(Justification::centredLeft);
+		mpLatencyLabels[i] = pL;
+	}
+	
 	setWantsKeyboardFocus(true);
 	pDebug->setWantsKeyboardFocus(true);
 }
@@ -561,11 +637,65 @@ void SoundplaneView::getModelUpdates()
 			needsRepaint = true;
 		}
 		
+		// show pipeline health about once per second.
+		const int kHealthUpdateInterval = 10;
+		if(++mHealthUpdateCounter >= kHealthUpdateInterval)
+		{
+			mHealthUpdateCounter = 0;
+			updateHealthLabel();
+		}
+		
 		if(needsRepaint)
 		{
 			mpFooter->repaint();
 		}
 	}
+	
+	// update latency display about once per second when the expert page is showing.
+	const int kLatencyUpdateInterval = 10;
+	if(++mLatencyUpdateCounter >= kLatencyUpdateInterval)
+	{
+		mLatencyUpdateCounter = 0;
+		if(getCurrentPage() == 2)
+		{
+			updateLatencyLabels();
+		}
+	}
+}
+
+void SoundplaneView::updateHealthLabel()
+{
+	const SoundplaneMetrics& m = mpModel->getMetrics();
+	char buf[128];
+	snprintf(buf, 128, "dropped %llu  gaps %llu  resets %llu  late %llu  queue max %llu",
+		(unsigned long long)m.get(kMetricFramesDropped),
+		(unsigned long long)m.get(kMetricSequenceGaps),
+		(unsigned long long)m.get(kMetricDeviceResets),
+		(unsigned long long)m.get(kMetricDeadlineMisses),
+		(unsigned long long)m.get(kMetricQueueHighWater));
+	mpFooter->setHealth(buf);
+}
+
+void SoundplaneView::updateLatencyLabels()
+{
+	char buf[64];
+	for(int i=0; i<kNumLatencyStages; ++i)
+	{
+		MLLabel* pL = mpLatencyLabels[i];
+		if(!pL) continue;
+		const LatencyHistogram& h = mpModel->getLatencyHistogram(i);
+		if(h.getCount() > 0)
+		{
+			snprintf(buf, 64, "%s: %.2f / %.2f / %.2f", getLatencyStageName(i),
+				h.getPercentile(50.f)*0.001f, h.getPercentile(99.f)*0.001f, h.getMax()*0.001f);
+		}
+		else
+		{
+			snprintf(buf, 64, "%s: ---", getLatencyStageName(i));
+		}
+		pL->setProperty("text", buf);
+		pL->repaint();
+	}
 }
 
 int SoundplaneView::getCurrentPage()
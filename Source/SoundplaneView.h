@@ -53,6 +53,7 @@ public:
 	void paint (Graphics& g);
 	void setStatus(const char* stat, const char* client);
 	void setHardware(const char* s);
+	void setHealth(const char* s);
 	void setCalibrateProgress(float p);
 	void setCalibrateState(bool b);
 	
@@ -63,6 +64,7 @@ private:
 	bool mCalibrateState;
 	MLLabel* mpDevice;
 	MLLabel* mpStatus;
+	MLLabel* mpHealth;
 	MLLabel* mpCalibrateText;
 	MLProgressBar* mpCalibrateProgress;
 	String mStatusStr;
@@ -103,6 +105,9 @@ public:
 	void goToPage (int page);
 	
 private:
+	void updateLatencyLabels();
+	void updateHealthLabel();
+	
 	SoundplaneFooterView* mpFooter;
 	MLPageView* mpPages;
 	
@@ -139,6 +144,11 @@ private:
 	int mSoundplaneClientState;
 	int mSoundplaneDeviceState;
 	
+	// page 2
+	std::array<MLLabel*, kNumLatencyStages> mpLatencyLabels{};
+	int mLatencyUpdateCounter{0};
+	int mHealthUpdateCounter{0};
+	
 	ml::Timer mTimer;
 };
 
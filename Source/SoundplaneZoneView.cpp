@@ -126,9 +126,9 @@ void SoundplaneZoneView::renderZones()
 	
 	// float strokeWidth = viewW / 100;
 	
-	for(auto it = mpModel->getZonesBegin(); it != mpModel->getZonesEnd(); ++it)
+	std::shared_ptr< const ZoneMap > pZoneMap = mpModel->getZoneMap();
+	for(const Zone& zone : pZoneMap->zones)
 	{
-		const Zone& zone = *it;
 		
 		MLRect zr = zone.getBounds();
 		int offset = zone.getOffset();
@@ -167,8 +167,8 @@ void SoundplaneZoneView::renderZones()
 		float x, y;
 		int toggle;
 		const ZoneMessage& c = zone.getController();
-		Symbol t = zone.getType();
-		if(t == "note_row")
+		ZoneType t = zone.getType();
+		if(t == kZoneTypeNoteRow)
 		{
 				for(int i = 0; i < kMaxTouches; ++i)
 				{
@@ -183,7 +183,7 @@ void SoundplaneZoneView::renderZones()
 					}
 				}
 		}
-		else if(t == "x")
+		else if(t == kZoneTypeX)
 		{
 				x = xRange(unityToKeyX(c.x));
 				glColor4fv(&zoneStroke[0]);
@@ -192,7 +192,7 @@ void SoundplaneZoneView::renderZones()
 				glColor4fv(&activeFill[0]);
 				MLGL::fillRect(MLRect(zoneRectInView.left(), zoneRectInView.top(), x - zoneRectInView.left(), zoneRectInView.height()));
 		}
-		else if(t == "y")
+		else if(t == kZoneTypeY)
 		{
 				y = yRange(unityToKeyY(c.y));
 				glColor4fv(&zoneStroke[0]);
@@ -201,7 +201,7 @@ void SoundplaneZoneView::renderZones()
 				glColor4fv(&activeFill[0]);
 				MLGL::fillRect(MLRect(zoneRectInView.left(), zoneRectInView.top(), zoneRectInView.width(), y - zoneRectInView.top()));
 		}
-		else if(t == "xy")
+		else if(t == kZoneTypeXY)
 		{
 				x = xRange(unityToKeyX(c.x));
 				y = yRange(unityToKeyY(c.y));
@@ -213,7 +213,7 @@ void SoundplaneZoneView::renderZones()
 				glColor4fv(&dotFill[0]);
 				MLGL::drawDot(Vec2(x, y), smallDotSize*0.25f);
 		}
-		else if(t == "z")
+		else if(t == kZoneTypeZ)
 		{
 				y = yRange(unityToKeyY(c.z)); // look at z value over y range
 				glColor4fv(&zoneStroke[0]);
@@ -222,7 +222,7 @@ void SoundplaneZoneView::renderZones()
 				glColor4fv(&activeFill[0]);
 				MLGL::fillRect(MLRect(zoneRectInView.left(), zoneRectInView.top(), zoneRectInView.width(), y - zoneRectInView.top()));
 		}
-		else if(t == "toggle")
+		else if(t == kZoneTypeToggle)
 		{
 				toggle = c.x; // toggle is controller x
 				glColor4fv(&zoneStroke[0]);
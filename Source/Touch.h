@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <array>
+#include <stdint.h>
+
 static constexpr int kMaxTouches = 16;
 
 enum TouchState
@@ -42,3 +45,32 @@ typedef std::array<Touch, kMaxTouches> TouchArray;
 
 inline bool touchIsActive(Touch t) { return t.state != kTouchStateInactive; }
 
+// a set of touch indices, bit i for touch i. Usually only a few touches are live, so
+// loops over touches go through the set bits of a mask instead of every index.
+typedef uint16_t TouchMask;
+static_assert(kMaxTouches <= 16, "TouchMask is too small for kMaxTouches");
+
+static constexpr TouchMask kAllTouches = static_cast<TouchMask>((1u << kMaxTouches) - 1);
+
+inline TouchMask touchBit(int i) { return static_cast<TouchMask>(1u << i); }
+inline int countTouches(TouchMask m) { return __builtin_popcount(m); }
+
+// call f(i) for each touch i in the mask, in increasing order.
+template< typename F >
+inline void forEachTouch(TouchMask m, F f)
+{
+    unsigned b = m;
+    while(b)
+    {
+        f(__builtin_ctz(b));
+        b &= b - 1;
+    }
+}
+
+// the touches of a frame that are active, starting, and ending.
+struct TouchMasks
+{
+    TouchMask active{0};
+    TouchMask on{0};
+    TouchMask off{0};
+};
@@ -0,0 +1,85 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include "Touch.h"
+
+// One frame of touches as a structure of arrays: each field of Touch is a column indexed
+// by touch. Stages that treat every touch the same way loop over whole columns, which
+// the compiler can vectorize, and columns can be copied as blocks.
+// operator[] gathers one Touch for code that works a touch at a time.
+
+struct TouchFrame
+{
+	alignas(16) float x[kMaxTouches];
+	alignas(16) float y[kMaxTouches];
+	alignas(16) float z[kMaxTouches];
+	alignas(16) float dz[kMaxTouches];
+	alignas(16) float note[kMaxTouches];
+	alignas(16) float vibrato[kMaxTouches];
+
+	alignas(16) int age[kMaxTouches];
+	alignas(16) int state[kMaxTouches];
+	alignas(16) int kx[kMaxTouches];
+	alignas(16) int ky[kMaxTouches];
+	alignas(16) int voiceIdx[kMaxTouches];
+
+	// the active, starting and ending touches. Set by updateMasks() after the states change.
+	TouchMasks masks;
+
+	void clear() { *this = TouchFrame{}; }
+
+	Touch operator[](int i) const
+	{
+		return Touch{.x = x[i], .y = y[i], .z = z[i], .dz = dz[i], .age = age[i], .state = state[i],
+			.kx = kx[i], .ky = ky[i], .note = note[i], .vibrato = vibrato[i], .voiceIdx = voiceIdx[i]};
+	}
+
+	void set(int i, const Touch& t)
+	{
+		x[i] = t.x;
+		y[i] = t.y;
+		z[i] = t.z;
+		dz[i] = t.dz;
+		note[i] = t.note;
+		vibrato[i] = t.vibrato;
+		age[i] = t.age;
+		state[i] = t.state;
+		kx[i] = t.kx;
+		ky[i] = t.ky;
+		voiceIdx[i] = t.voiceIdx;
+	}
+
+	// copy touch i of another frame to touch j of this one.
+	void copyTouch(int j, const TouchFrame& from, int i)
+	{
+		x[j] = from.x[i];
+		y[j] = from.y[i];
+		z[j] = from.z[i];
+		dz[j] = from.dz[i];
+		note[j] = from.note[i];
+		vibrato[j] = from.vibrato[i];
+		age[j] = from.age[i];
+		state[j] = from.state[i];
+		kx[j] = from.kx[i];
+		ky[j] = from.ky[i];
+		voiceIdx[j] = from.voiceIdx[i];
+	}
+
+	void updateMasks()
+	{
+		TouchMask active = 0, on = 0, off = 0;
+		for(int i=0; i<kMaxTouches; ++i)
+		{
+			active |= static_cast<TouchMask>((state[i] != kTouchStateInactive) << i);
+			on |= static_cast<TouchMask>((state[i] == kTouchStateOn) << i);
+			off |= static_cast<TouchMask>((state[i] == kTouchStateOff) << i);
+		}
+		masks.active = active;
+		masks.on = on;
+		masks.off = off;
+	}
+};
@@ -0,0 +1,105 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "TouchThinner.h"
+
+#include <cmath>
+
+// send when the change exceeds the threshold, or when the value differs at all and
+// it has been too long since the last send.
+bool TouchThinner::shouldSend(float sent, float current, float threshold, SentTouch& s, int dim, time_point<system_clock> now)
+{
+	float change = fabsf(current - sent);
+	if((change > threshold) || ((change > 0.f) && (now - s.time[dim] >= mMaxInterval)))
+	{
+		s.time[dim] = now;
+		return true;
+	}
+	return false;
+}
+
+Touch TouchThinner::process(int i, const Touch& t, time_point<system_clock> now)
+{
+	if((i < 0) || (i >= kMaxTouches)) return t;
+	SentTouch& s = mSent[i];
+
+	if(t.state != kTouchStateContinue)
+	{
+		s.note = t.note;
+		s.vibrato = t.vibrato;
+		s.z = t.z;
+		s.x = t.x;
+		s.y = t.y;
+		s.time.fill(now);
+		s.lastSent = now;
+		return t;
+	}
+
+	// hold every dimension until the min interval has passed.
+	Touch out = t;
+	if(now - s.lastSent < mMinInterval)
+	{
+		out.note = s.note;
+		out.vibrato = s.vibrato;
+		out.z = s.z;
+		out.x = s.x;
+		out.y = s.y;
+		return out;
+	}
+
+	bool sent = false;
+	if(shouldSend(s.note + s.vibrato, t.note + t.vibrato, mPitchThreshold, s, kPitch, now))
+	{
+		sent = true;
+		s.note = t.note;
+		s.vibrato = t.vibrato;
+	}
+	else
+	{
+		out.note = s.note;
+		out.vibrato = s.vibrato;
+	}
+
+	if(shouldSend(s.z, t.z, mPressureThreshold, s, kPressure, now))
+	{
+		sent = true;
+		s.z = t.z;
+	}
+	else
+	{
+		out.z = s.z;
+	}
+
+	if(shouldSend(s.x, t.x, mPositionThreshold, s, kX, now))
+	{
+		sent = true;
+		s.x = t.x;
+	}
+	else
+	{
+		out.x = s.x;
+	}
+
+	if(shouldSend(s.y, t.y, mPositionThreshold, s, kY, now))
+	{
+		sent = true;
+		s.y = t.y;
+	}
+	else
+	{
+		out.y = s.y;
+	}
+
+	if(sent)
+	{
+		s.lastSent = now;
+	}
+	return out;
+}
+
+void TouchThinner::clear()
+{
+	mSent.fill(SentTouch());
+}
@@ -0,0 +1,74 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <chrono>
+
+#include "Touch.h"
+
+using namespace std::chrono;
+
+// Suppresses changes to touches too small to hear, before they reach the outputs.
+// Each dimension of a continuing touch keeps its last sent value until the new value
+// differs by more than the dimension's threshold, or until the max interval has passed
+// since it was last sent. Outputs that send only changed values then send nothing for
+// the held dimensions. No dimension of a continuing touch is sent again until the min
+// interval has passed since the touch last sent anything.
+//
+// Touches that start or end are passed through unchanged, without waiting for the
+// min interval, so note-ons and note-offs are never delayed and the final values of
+// every touch always go out.
+
+class TouchThinner
+{
+public:
+	TouchThinner() {}
+	~TouchThinner() {}
+
+	// thresholds for pitch in cents, and for z, x and y in steps of 1/128.
+	void setPitchThreshold(float cents) { mPitchThreshold = cents/100.f; }
+	void setPressureThreshold(float steps) { mPressureThreshold = steps/128.f; }
+	void setPositionThreshold(float steps) { mPositionThreshold = steps/128.f; }
+	void setMaxInterval(milliseconds m) { mMaxInterval = m; }
+	void setMinInterval(milliseconds m) { mMinInterval = m; }
+
+	// return the touch to send for voice i.
+	Touch process(int i, const Touch& t, time_point<system_clock> now);
+
+	void clear();
+
+private:
+	enum Dimension
+	{
+		kPitch = 0,
+		kPressure,
+		kX,
+		kY,
+		kNumDimensions
+	};
+
+	struct SentTouch
+	{
+		float note{0.f};
+		float vibrato{0.f};
+		float z{0.f};
+		float x{0.f};
+		float y{0.f};
+		std::array< time_point<system_clock>, kNumDimensions > time{};
+		time_point<system_clock> lastSent{};
+	};
+
+	bool shouldSend(float sent, float current, float threshold, SentTouch& s, int dim, time_point<system_clock> now);
+
+	float mPitchThreshold{0.02f};
+	float mPressureThreshold{1.f/128.f};
+	float mPositionThreshold{1.f/128.f};
+	milliseconds mMaxInterval{50};
+	milliseconds mMinInterval{2};
+
+	std::array< SentTouch, kMaxTouches > mSent{};
+};
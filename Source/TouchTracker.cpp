@@ -104,10 +104,7 @@ void TouchTracker::setRotate(bool b)
 
 void TouchTracker::clear()
 {
-	for (int i=0; i<kMaxTouches; i++)
-	{
-		mTouches[i] = Touch();
-	}
+	mTouches.clear();
 }
 
 // set the threshold of curvature that will cause a touch. Note that this will not correspond with the pressure (z) values reported by touches.
@@ -235,47 +232,48 @@ void TouchTracker::clearAndSendNextFrameIfNeeded()
 	if(mClearNextFrame)
 	{
 		mClearNextFrame = false;
-		mTouches = TouchArray{};
+		mTouches.clear();
 		for(int i=0; i<kMaxTouches; ++i)
 		{
-			mTouches[i].state = kTouchStateOff;
+			mTouches.state[i] = kTouchStateOff;
 		}
 	}
 }
 
-TouchArray TouchTracker::process(const SensorFrame& in, int maxTouches)
+const TouchFrame& TouchTracker::process(const SensorFrame& in, int maxTouches)
 {
 	setMaxTouches(maxTouches);
 	
-	mTouches = TouchArray{};
+	mTouches.clear();
 	
 	if(mMaxTouchesPerFrame > 0)
 	{
-		mTouches = findTouches(in);
+		TouchArray touches = findTouches(in);
 		
 		// match -> position filter -> feedback
-		mTouches = matchTouches(mTouches, mTouchesMatch1);
-		mTouches = filterTouchesXYAdaptive(mTouches, mTouchesMatch1);
-		mTouchesMatch1 = mTouches;
+		touches = matchTouches(touches, mTouchesMatch1);
+		touches = filterTouchesXYAdaptive(touches, mTouchesMatch1);
+		mTouchesMatch1 = touches;
 		
 		// asymmetrical z filter from user setting. Ages are created here.
-		mTouches = filterTouchesZ(mTouches, mTouches2, mLopassZ*2.f, mLopassZ*0.25f);
+		filterTouchesZ(touches, mTouches2, mTouches, mLopassZ*2.f, mLopassZ*0.25f);
 		mTouches2 = mTouches;
 		
 		// after variable filter, exile decayed touches so they are not matched. Note this affects match feedback!
-		mTouchesMatch1 = exileUnusedTouches(mTouchesMatch1, mTouches);
+		exileUnusedTouches(mTouchesMatch1, mTouches);
 		
 		// TODO hysteresis after matching to prevent glitching when there are more
 		// physical touches than mMaxTouchesPerFrame and touches are stolen
 		
 		if(mRotate)
 		{
-			mTouches = rotateTouches(mTouches);
+			rotateTouches(mTouches);
 		}
 		
-		mTouches = clampAndScaleTouches(mTouches);
+		clampAndScaleTouches(mTouches);
 	}
 	clearAndSendNextFrameIfNeeded();
+	mTouches.updateMasks();
 	return mTouches;
 }
 
@@ -676,7 +674,7 @@ TouchArray TouchTracker::filterTouchesXYAdaptive(const TouchArray& in, const Tou
 	return out;
 }
 
-TouchArray TouchTracker::filterTouchesZ(const TouchArray& in, const TouchArray& inz1, float upFreq, float downFreq)
+void TouchTracker::filterTouchesZ(const TouchArray& in, const TouchFrame& inz1, TouchFrame& out, float upFreq, float downFreq)
 {
 	const float omegaUp = upFreq*kTwoPi/mSampleRate;
 	const float kUp = expf(-omegaUp);
@@ -687,89 +685,66 @@ TouchArray TouchTracker::filterTouchesZ(const TouchArray& in, const TouchArray&
 	const float a0Down = 1.f - kDown;
 	const float b1Down = kDown;
 	
-	TouchArray out{};
+	out.clear();
+	const int n = mMaxTouchesPerFrame;
 	
-	for(int i=0; i<mMaxTouchesPerFrame; ++i)
+	// gather the matched positions into columns.
+	for(int i=0; i<n; ++i)
 	{
-		float x = in[i].x;
-		float y = in[i].y;
-		float z = in[i].z;
-		
-		float z1 = inz1[i].z;
-		int age1 = inz1[i].age;
-		
-		float newZ;
-		
-		// filter z variable
+		out.x[i] = in[i].x;
+		out.y[i] = in[i].y;
+		out.z[i] = in[i].z;
+	}
+	
+	// filter z variable
+	for(int i=0; i<n; ++i)
+	{
+		float z = out.z[i];
+		float z1 = inz1.z[i];
 		float dz = z - z1;
-		if(dz > 0.f)
-		{
-			newZ = (z*a0Up) + (z1*b1Up);
-		}
-		else
-		{
-			newZ = (z*a0Down) + (z1*b1Down);
-		}
-		
-		// gate with hysteresis
-		bool gate1 = (age1 > 0);
-		bool newGate = gate1;
-		if(newZ > mOnThreshold)
-		{
-			newGate = true;
-		}
-		else if (newZ < mOffThreshold)
-		{
-			newGate = false;
-		}
-		
-		// increment age
-		int newAge = newGate ? (age1 + 1) : 0;
-		
-		// set state
-		int newState = newGate ? (gate1 ? kTouchStateContinue : kTouchStateOn) : (gate1 ? kTouchStateOff : kTouchStateInactive);
-		
-		out[i] = Touch{.x=x, .y=y, .z=newZ, .dz=dz, .age=newAge, .state=newState};
+		bool up = (dz > 0.f);
+		float a0 = up ? a0Up : a0Down;
+		float b1 = up ? b1Up : b1Down;
+		out.z[i] = (z*a0) + (z1*b1);
+		out.dz[i] = dz;
 	}
 	
-	return out;
+	// gate with hysteresis, increment age and set state
+	for(int i=0; i<n; ++i)
+	{
+		float newZ = out.z[i];
+		int age1 = inz1.age[i];
+		bool gate1 = (age1 > 0);
+		bool newGate = (newZ > mOnThreshold) || (gate1 && !(newZ < mOffThreshold));
+		out.age[i] = newGate ? (age1 + 1) : 0;
+		out.state[i] = newGate ? (gate1 ? kTouchStateContinue : kTouchStateOn) : (gate1 ? kTouchStateOff : kTouchStateInactive);
+	}
 }
 
 // if a touch has decayed below the filter threshold after z filtering, move it off the scene so it won't match to other nearby touches.
-TouchArray TouchTracker::exileUnusedTouches(const TouchArray& preFiltered, const TouchArray& postFiltered)
+void TouchTracker::exileUnusedTouches(TouchArray& matched, const TouchFrame& filtered)
 {
-	TouchArray out(preFiltered);
 	for(int i = 0; i < mMaxTouchesPerFrame; ++i)
 	{
-		Touch a = preFiltered[i];
-		Touch b = postFiltered[i];
-		
-		if(b.x > 0.f)
+		if((filtered.x[i] > 0.f) && (filtered.z[i] <= mFilterThreshold))
 		{
-			if(b.z <= mFilterThreshold)
-			{
-				a.x = (-1.f);
-				a.y = (-10.f);
-				a.z = (0.f);
-			}
+			matched[i].x = (-1.f);
+			matched[i].y = (-10.f);
+			matched[i].z = (0.f);
 		}
-		
-		out[i] = a;
 	}
-	return out;
 }
 
 // rotate order of touches, changing order every time there is a new touch in a frame.
 // side effect: writes to mRotateShuffleOrder
-TouchArray TouchTracker::rotateTouches(const TouchArray& in)
+void TouchTracker::rotateTouches(TouchFrame& touches)
 {
-	TouchArray touches(in);
 	if(mMaxTouchesPerFrame > 1)
 	{
 		bool doRotate = false;
 		for(int i = 0; i < mMaxTouchesPerFrame; ++i)
 		{
-			if(in[i].age == 1)
+			if(touches.age[i] == 1)
 			{
 				// we have a new touch at index i.
 				doRotate = true;
@@ -785,7 +760,7 @@ TouchArray TouchTracker::rotateTouches(const TouchArray& in)
 			
 			for(int i=0; i<mMaxTouchesPerFrame; ++i)
 			{
-				if((in[i].z < mFilterThreshold) || (in[i].age == 1))
+				if((touches.z[i] < mFilterThreshold) || (touches.age[i] == 1))
 				{
 					freeIndexes[nFree++] = i;
 				}
@@ -803,43 +778,33 @@ TouchArray TouchTracker::rotateTouches(const TouchArray& in)
 		}
 		
 		// shuffle
+		mRotateTemp = touches;
 		for(int i = 0; i < mMaxTouchesPerFrame; ++i)
 		{
-			touches[mRotateShuffleOrder[i]] = in[i];
+			touches.copyTouch(mRotateShuffleOrder[i], mRotateTemp, i);
 		}
 	}
-	return touches;
 }
 
-TouchArray TouchTracker::clampAndScaleTouches(const TouchArray& in)
+void TouchTracker::clampAndScaleTouches(TouchFrame& t)
 {
 	const float kTouchOutputScale = 4.f;
-	TouchArray out{};
-	for(int i = 0; i < mMaxTouchesPerFrame; ++i)
+	const int n = mMaxTouchesPerFrame;
+	for(int i = 0; i < n; ++i)
 	{
-		Touch t = in[i];
-		
-		if(t.x != t.x)
-		{
-			t.x = (0.f);
-		}
-		if(t.y != t.y)
-		{
-			t.y = (0.f);
-		}
-		
-		out[i] = t;
-		float newZ = (clamp((t.z - mOnThreshold)*kTouchOutputScale, 0.f, 8.f));
-		if(t.age == 0)
-		{
-			newZ = 0.f;
-		}
-		out[i].z = (newZ);
+		float x = t.x[i];
+		float y = t.y[i];
+		t.x[i] = (x != x) ? 0.f : x;
+		t.y[i] = (y != y) ? 0.f : y;
+	}
+	for(int i = 0; i < n; ++i)
+	{
+		float newZ = (clamp((t.z[i] - mOnThreshold)*kTouchOutputScale, 0.f, 8.f));
+		t.z[i] = (t.age[i] == 0) ? 0.f : newZ;
 	}
-	return out;
 }
 
-TouchArray TouchTracker::getTestTouches(time_point<system_clock> now, int maxTouches)
+const TouchFrame& TouchTracker::getTestTouches(time_point<system_clock> now, int maxTouches)
 {
 	TouchArray t{};
 
@@ -870,13 +835,13 @@ TouchArray TouchTracker::getTestTouches(time_point<system_clock> now, int maxTou
 		t[i] = Touch{.x = x, .y = y, .z = amp};
 	}
 	
-	mTouches = t;
 	// asymmetrical z filter from user setting. Ages are created here.
-	mTouches = filterTouchesZ(mTouches, mTouches2, mLopassZ*2.f, mLopassZ*0.25f);
+	filterTouchesZ(t, mTouches2, mTouches, mLopassZ*2.f, mLopassZ*0.25f);
 	mTouches2 = mTouches;
-	mTouches = clampAndScaleTouches(mTouches);
+	clampAndScaleTouches(mTouches);
 	
 	clearAndSendNextFrameIfNeeded();
+	mTouches.updateMasks();
 	return mTouches;
 }
 
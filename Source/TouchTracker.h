@@ -6,7 +6,7 @@
 #pragma once
 
 #include "SensorFrame.h"
-#include "Touch.h"
+#include "TouchFrame.h"
 
 using namespace std::chrono;
 
@@ -25,10 +25,11 @@ public:
 	// preprocess input to get curvature
 	SensorFrame preprocess(const SensorFrame& in);
 	
-	// process input and get touches. returns one frame of touch data. changes history of many filters.
-	TouchArray process(const SensorFrame& in, int maxTouches);
+	// process input and get touches. returns one frame of touch data, with its masks set,
+	// which is valid until the next call. changes history of many filters.
+	const TouchFrame& process(const SensorFrame& in, int maxTouches);
 	
-	TouchArray getTestTouches(time_point<system_clock> t, int maxTouches);
+	const TouchFrame& getTestTouches(time_point<system_clock> t, int maxTouches);
 	
 private:
 	
@@ -45,21 +46,26 @@ private:
 	SensorFrame mInput{};
 	SensorFrame mInputZ1{};
 	
-	TouchArray mTouches{};
 	TouchArray mTouchesMatch1{};
-	TouchArray mTouches2{};
+	
+	// output, and z filter feedback.
+	TouchFrame mTouches{};
+	TouchFrame mTouches2{};
+	TouchFrame mRotateTemp{};
 	
 	std::array<int, kMaxTouches> mRotateShuffleOrder;
 	
 	void clearAndSendNextFrameIfNeeded();
 	void setMaxTouches(int t);
 	TouchArray findTouches(const SensorFrame& in);
-	TouchArray rotateTouches(const TouchArray& t);
 	TouchArray matchTouches(const TouchArray& x, const TouchArray& x1);
 	TouchArray filterTouchesXYAdaptive(const TouchArray& x, const TouchArray& x1);
-	TouchArray filterTouchesZ(const TouchArray& x, const TouchArray& x1, float upFreq, float downFreq);
-	TouchArray exileUnusedTouches(const TouchArray& x1, const TouchArray& x2);
-	TouchArray clampAndScaleTouches(const TouchArray& x);
+	
+	// after matching and position filtering, the stages work on all touches at once.
+	void filterTouchesZ(const TouchArray& x, const TouchFrame& y1, TouchFrame& y, float upFreq, float downFreq);
+	void exileUnusedTouches(TouchArray& x1, const TouchFrame& y);
+	void rotateTouches(TouchFrame& t);
+	void clampAndScaleTouches(TouchFrame& t);
 	void outputTouches(TouchArray touches);
 };
 
@@ -0,0 +1,196 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "UDPBatchSender.h"
+
+#include <cstring>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+UDPBatchSender::~UDPBatchSender()
+{
+	close();
+}
+
+bool UDPBatchSender::open()
+{
+	close();
+
+	mSocket = socket(AF_INET, SOCK_DGRAM, 0);
+	if(mSocket < 0) return false;
+
+	// receivers of multicast on this host get our datagrams too.
+	unsigned char loop = 1;
+	setsockopt(mSocket, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+	mQueued = 0;
+	mSyscalls = 0;
+	mDatagrams = 0;
+	for(auto& b : mBytesByPort)
+	{
+		b = 0;
+	}
+	for(auto& b : mBytesByDestination)
+	{
+		b = 0;
+	}
+	return true;
+}
+
+void UDPBatchSender::close()
+{
+	if(mSocket >= 0)
+	{
+		::close(mSocket);
+		mSocket = -1;
+	}
+	mQueued = 0;
+	mDestinationOpen.fill(false);
+	mDestinationMulticast.fill(false);
+	mMulticastInterface.clear();
+}
+
+bool UDPBatchSender::setDestination(int d, const std::string& hostName, const int* ports, int numPorts, int multicastTTL)
+{
+	if((d < 0) || (d >= kMaxDestinations)) return false;
+	mDestinationOpen[d] = false;
+	if(mSocket < 0) return false;
+	if((numPorts < 1) || (numPorts > kMaxPorts)) return false;
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_DGRAM;
+	addrinfo* result = nullptr;
+	if(getaddrinfo(hostName.c_str(), nullptr, &hints, &result) != 0) return false;
+	if(!result) return false;
+	sockaddr_in hostAddress;
+	std::memcpy(&hostAddress, result->ai_addr, sizeof(hostAddress));
+	freeaddrinfo(result);
+
+	mPortOpen[d].fill(false);
+	for(int i=0; i<numPorts; ++i)
+	{
+		if((ports[i] <= 0) || (ports[i] > 65535)) continue;
+		mAddresses[d][i] = hostAddress;
+		mAddresses[d][i].sin_port = htons(static_cast<uint16_t>(ports[i]));
+		mPortOpen[d][i] = true;
+	}
+
+	mDestinationMulticast[d] = IN_MULTICAST(ntohl(hostAddress.sin_addr.s_addr));
+	mMulticastTTL[d] = multicastTTL;
+	mDestinationOpen[d] = true;
+	updateMulticastTTL();
+	return true;
+}
+
+// one socket sends to all destinations, so it uses the largest TTL any of them asks for.
+void UDPBatchSender::updateMulticastTTL()
+{
+	int ttl = 0;
+	for(int d=0; d<kMaxDestinations; ++d)
+	{
+		if(mDestinationOpen[d] && mDestinationMulticast[d] && (mMulticastTTL[d] > ttl))
+		{
+			ttl = mMulticastTTL[d];
+		}
+	}
+	if(ttl > 0)
+	{
+		unsigned char t = static_cast<unsigned char>((ttl < 255) ? ttl : 255);
+		setsockopt(mSocket, IPPROTO_IP, IP_MULTICAST_TTL, &t, sizeof(t));
+	}
+}
+
+bool UDPBatchSender::setMulticastInterface(const std::string& address)
+{
+	if(mSocket < 0) return false;
+	in_addr a;
+	if(inet_pton(AF_INET, address.c_str(), &a) != 1) return false;
+	if(setsockopt(mSocket, IPPROTO_IP, IP_MULTICAST_IF, &a, sizeof(a)) != 0) return false;
+	mMulticastInterface = address;
+	return true;
+}
+
+void UDPBatchSender::add(int portOffset, const char* data, size_t size, uint32_t destinations)
+{
+	if((portOffset < 0) || (portOffset >= kMaxPorts)) return;
+	for(int d=0; d<kMaxDestinations; ++d)
+	{
+		if((destinations & (1u << d)) && mDestinationOpen[d] && mPortOpen[d][portOffset])
+		{
+			queue(d, portOffset, data, size);
+		}
+	}
+}
+
+void UDPBatchSender::queue(int d, int portOffset, const char* data, size_t size)
+{
+	if(mQueued >= kMaxDatagrams)
+	{
+		flush();
+	}
+	mQueuedPorts[mQueued] = portOffset;
+	mQueuedDestinations[mQueued] = d;
+	mIOVecs[mQueued].iov_base = const_cast<char*>(data);
+	mIOVecs[mQueued].iov_len = size;
+	mQueued++;
+}
+
+void UDPBatchSender::flush()
+{
+	if(mSocket < 0)
+	{
+		mQueued = 0;
+		return;
+	}
+
+	for(int i=0; i<mQueued; ++i)
+	{
+		mBytesByPort[mQueuedPorts[i]].fetch_add(mIOVecs[i].iov_len, std::memory_order_relaxed);
+		mBytesByDestination[mQueuedDestinations[i]].fetch_add(mIOVecs[i].iov_len, std::memory_order_relaxed);
+	}
+	mDatagrams.fetch_add(mQueued, std::memory_order_relaxed);
+
+#if defined(__linux__)
+	for(int i=0; i<mQueued; ++i)
+	{
+		msghdr& h = mMessages[i].msg_hdr;
+		h.msg_name = &mAddresses[mQueuedDestinations[i]][mQueuedPorts[i]];
+		h.msg_namelen = sizeof(sockaddr_in);
+		h.msg_iov = &mIOVecs[i];
+		h.msg_iovlen = 1;
+		h.msg_control = nullptr;
+		h.msg_controllen = 0;
+		h.msg_flags = 0;
+	}
+
+	// sendmmsg() may send fewer than all the messages. Datagrams that fail to send
+	// are dropped, as they would be anywhere else on the way.
+	int sent = 0;
+	while(sent < mQueued)
+	{
+		int r = sendmmsg(mSocket, mMessages.data() + sent, mQueued - sent, 0);
+		mSyscalls.fetch_add(1, std::memory_order_relaxed);
+		if(r <= 0)
+		{
+			// skip the datagram that failed.
+			r = 1;
+		}
+		sent += r;
+	}
+#else
+	for(int i=0; i<mQueued; ++i)
+	{
+		sendto(mSocket, mIOVecs[i].iov_base, mIOVecs[i].iov_len, 0,
+			reinterpret_cast<const sockaddr*>(&mAddresses[mQueuedDestinations[i]][mQueuedPorts[i]]), sizeof(sockaddr_in));
+		mSyscalls.fetch_add(1, std::memory_order_relaxed);
+	}
+#endif
+
+	mQueued = 0;
+}
@@ -0,0 +1,97 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__linux__)
+#include <sys/socket.h>
+#endif
+#include <sys/uio.h>
+#include <netinet/in.h>
+
+// Sends the UDP datagrams for one output frame to one or more destinations, each a
+// set of ports on one host. Datagrams are queued with add() for any set of
+// destinations and sent with flush(), which on Linux uses a single sendmmsg() call
+// for the whole frame. Elsewhere each datagram is sent with sendto().
+//
+// Destinations with a multicast group address are sent to with the multicast TTL,
+// and multicast loopback is on, so receivers on this host get the datagrams too.
+// All destinations share one socket, so the multicast TTL and interface are settings
+// of the sender, not of each destination.
+//
+// Queued data is not copied, and must stay valid until flush() returns.
+
+class UDPBatchSender
+{
+public:
+	static constexpr int kMaxPorts = 16;
+	static constexpr int kMaxDestinations = 8;
+	static constexpr int kMaxDatagrams = 128;
+
+	UDPBatchSender() {}
+	~UDPBatchSender();
+
+	// open a socket with no destinations. Returns false on failure.
+	bool open();
+
+	void close();
+	bool isOpen() const { return mSocket >= 0; }
+
+	// set destination d to send port offsets 0 to numPorts - 1 to the given ports on a
+	// host. A port of 0 skips its offset. Returns false if the host can't be resolved.
+	bool setDestination(int d, const std::string& hostName, const int* ports, int numPorts, int multicastTTL = 1);
+	bool hasDestination(int d) const { return (d >= 0) && (d < kMaxDestinations) && mDestinationOpen[d]; }
+	bool isMulticast(int d) const { return hasDestination(d) && mDestinationMulticast[d]; }
+	
+	// send multicast to every destination from the interface with the given IPv4 address,
+	// such as 127.0.0.1 to stay on this host. By default the system chooses. Returns
+	// false on failure.
+	bool setMulticastInterface(const std::string& address);
+	const std::string& getMulticastInterface() const { return mMulticastInterface; }
+
+	// queue a datagram for the port at portOffset of each destination whose bit is set
+	// in the destinations mask.
+	void add(int portOffset, const char* data, size_t size, uint32_t destinations = 1);
+
+	void flush();
+
+	// statistics since open().
+	uint64_t getSyscallCount() const { return mSyscalls.load(std::memory_order_relaxed); }
+	uint64_t getDatagramCount() const { return mDatagrams.load(std::memory_order_relaxed); }
+	uint64_t getBytesSent(int portOffset) const { return mBytesByPort[portOffset].load(std::memory_order_relaxed); }
+	uint64_t getBytesSentTo(int d) const { return mBytesByDestination[d].load(std::memory_order_relaxed); }
+	int getNumPorts() const { return kMaxPorts; }
+
+private:
+	void queue(int d, int portOffset, const char* data, size_t size);
+	void updateMulticastTTL();
+
+	int mSocket{-1};
+	std::array< std::array< sockaddr_in, kMaxPorts >, kMaxDestinations > mAddresses{};
+	std::array< std::array< bool, kMaxPorts >, kMaxDestinations > mPortOpen{};
+	std::array< bool, kMaxDestinations > mDestinationOpen{};
+	std::array< bool, kMaxDestinations > mDestinationMulticast{};
+	std::array< int, kMaxDestinations > mMulticastTTL{};
+	std::string mMulticastInterface{};
+
+	int mQueued{0};
+	std::array< int, kMaxDatagrams > mQueuedPorts{};
+	std::array< int, kMaxDatagrams > mQueuedDestinations{};
+	std::array< iovec, kMaxDatagrams > mIOVecs{};
+#if defined(__linux__)
+	std::array< mmsghdr, kMaxDatagrams > mMessages{};
+#endif
+
+	std::atomic<uint64_t> mSyscalls{0};
+	std::atomic<uint64_t> mDatagrams{0};
+	std::array< std::atomic<uint64_t>, kMaxPorts > mBytesByPort{};
+	std::array< std::atomic<uint64_t>, kMaxDestinations > mBytesByDestination{};
+};
@@ -0,0 +1,93 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "UMPTransport.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// --------------------------------------------------------------------------------
+#pragma mark UMPLoopbackTransport
+
+bool UMPLoopbackTransport::send(const uint32_t* words, size_t numWords)
+{
+	size_t w = mWriteIndex.load(std::memory_order_relaxed);
+	size_t r = mReadIndex.load(std::memory_order_acquire);
+	if(w - r + numWords > kRingWords) return false;
+
+	for(size_t i=0; i<numWords; ++i)
+	{
+		mWords[(w + i) & (kRingWords - 1)] = words[i];
+	}
+	mWriteIndex.store(w + numWords, std::memory_order_release);
+	return true;
+}
+
+size_t UMPLoopbackTransport::read(uint32_t* dest, size_t maxWords)
+{
+	size_t r = mReadIndex.load(std::memory_order_relaxed);
+	size_t w = mWriteIndex.load(std::memory_order_acquire);
+	size_t n = w - r;
+	if(n > maxWords) n = maxWords;
+
+	for(size_t i=0; i<n; ++i)
+	{
+		dest[i] = mWords[(r + i) & (kRingWords - 1)];
+	}
+	mReadIndex.store(r + n, std::memory_order_release);
+	return n;
+}
+
+// --------------------------------------------------------------------------------
+#pragma mark UMPDeviceTransport
+
+UMPDeviceTransport::~UMPDeviceTransport()
+{
+	close();
+}
+
+bool UMPDeviceTransport::open(const std::string& path)
+{
+#if defined(__linux__)
+	int f = ::open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if(f < 0) return false;
+	int prev = mFile.exchange(f, std::memory_order_acq_rel);
+	if(prev >= 0)
+	{
+		::close(prev);
+	}
+	return true;
+#else
+	(void)path;
+	return false;
+#endif
+}
+
+void UMPDeviceTransport::close()
+{
+#if defined(__linux__)
+	int prev = mFile.exchange(-1, std::memory_order_acq_rel);
+	if(prev >= 0)
+	{
+		::close(prev);
+	}
+#endif
+}
+
+bool UMPDeviceTransport::send(const uint32_t* words, size_t numWords)
+{
+#if defined(__linux__)
+	int f = mFile.load(std::memory_order_acquire);
+	if(f < 0) return false;
+	size_t bytes = numWords*sizeof(uint32_t);
+	return (write(f, words, bytes) == static_cast<ssize_t>(bytes));
+#else
+	(void)words;
+	(void)numWords;
+	return false;
+#endif
+}
@@ -0,0 +1,67 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+// Destinations for Universal MIDI Packets. Each call to send() passes whole packets,
+// as 32-bit words in host byte order.
+
+class UMPTransport
+{
+public:
+	virtual ~UMPTransport() {}
+
+	// returns false if the words could not all be sent.
+	virtual bool send(const uint32_t* words, size_t numWords) = 0;
+};
+
+// Keeps sent words in a ring for a reader in the same process, such as a test or a
+// monitor. One thread may send and one other thread may read. If the ring is full,
+// new packets are dropped.
+class UMPLoopbackTransport :
+public UMPTransport
+{
+public:
+	static constexpr size_t kRingWords = 4096;
+
+	bool send(const uint32_t* words, size_t numWords) override;
+
+	// copy up to maxWords waiting words into dest. Returns the number copied. Packets
+	// are never split as long as maxWords is a multiple of 4, the largest packet size.
+	size_t read(uint32_t* dest, size_t maxWords);
+
+	void clear() { mReadIndex.store(mWriteIndex.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+	std::array< uint32_t, kRingWords > mWords{};
+	std::atomic<size_t> mWriteIndex{0};
+	std::atomic<size_t> mReadIndex{0};
+};
+
+// Writes packets to a UMP device node, such as /dev/snd/umpC1D0 from the ALSA UMP
+// driver in Linux 6.5 and later. Not available on other systems.
+class UMPDeviceTransport :
+public UMPTransport
+{
+public:
+	UMPDeviceTransport() {}
+	~UMPDeviceTransport();
+
+	// open the device, closing any previous one. Returns false on failure.
+	bool open(const std::string& path);
+	void close();
+	bool isOpen() const { return mFile.load(std::memory_order_acquire) >= 0; }
+
+	bool send(const uint32_t* words, size_t numWords) override;
+
+private:
+	std::atomic<int> mFile{-1};
+};
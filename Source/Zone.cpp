@@ -8,6 +8,27 @@
 
 #include "Zone.h"
 
+#include <algorithm>
+
+
+const ml::Symbol noteRowSym("note_row");
+const ml::Symbol xSym("x");
+const ml::Symbol ySym("y");
+const ml::Symbol xySym("xy");
+const ml::Symbol toggleSym("toggle");
+const ml::Symbol zSym("z");
+
+ZoneType zoneTypeFromSymbol(Symbol t)
+{
+	if(t == noteRowSym) return kZoneTypeNoteRow;
+	if(t == xSym) return kZoneTypeX;
+	if(t == ySym) return kZoneTypeY;
+	if(t == xySym) return kZoneTypeXY;
+	if(t == toggleSym) return kZoneTypeToggle;
+	if(t == zSym) return kZoneTypeZ;
+	return kZoneTypeNone;
+}
+
 const float kVibratoFilterFreq = 12.0f;
 const float kSoundplaneVibratoAmount = 5.;
 
@@ -30,6 +51,12 @@ Zone::Zone()
 		mVibratoFilters[i].setSampleRate(kSoundplaneFrameRate);
 		mVibratoFilters[i].setOnePole(kVibratoFilterFreq);
 	}
+	
+	for(auto& f : mControllerFilters)
+	{
+		f.setSampleRate(kSoundplaneFrameRate);
+		f.setDeadband(kDefaultControllerDeadband);
+	}
 }
 
 void Zone::setBounds(MLRect b)
@@ -40,12 +67,18 @@ void Zone::setBounds(MLRect b)
 	mXRangeInv = MLRange(b.left(), b.right(), 0., 1.);
 	mYRangeInv = MLRange(b.top(), b.bottom(), 0., 1.);
 	
-	mScaleMap.setDims(b.width() + 1);
-	// setup chromatic scale
-	for(int i=0; i<mScaleMap.getWidth(); ++i)
+	mScale.setChromatic(b.width() + 1);
+}
+
+void Zone::setControllerResponse(float smoothMs, float slewRate, float deadband, bool hiRes)
+{
+	for(auto& f : mControllerFilters)
 	{
-		mScaleMap[i] = i;
+		f.setSmoothTime(smoothMs);
+		f.setSlewRate(slewRate);
+		f.setDeadband(deadband);
 	}
+	mHiRes = hiRes;
 }
 
 // input: approx. snap time in ms
@@ -59,14 +92,19 @@ void Zone::setSnapFreq(float f)
 	}
 }
 
+// the touch arrays are cleared and copied only at the touches that were in use.
 void Zone::newFrame()
 {
-	for(int i=0; i<kMaxTouches; ++i)
+	forEachTouch(mOutputMask, [&](int i){ mOutputTouches[i] = Touch{}; });
+	forEachTouch(mActive1 & ~mActive0, [&](int i){ mTouches1[i] = Touch{}; });
+	forEachTouch(mActive0, [&](int i)
 	{
 		mTouches1[i] = mTouches0[i];
 		mTouches0[i] = Touch{};
-		mOutputTouches[i] = Touch{};
-	}
+	});
+	mOutputMask = 0;
+	mActive1 = mActive0;
+	mActive0 = 0;
 }
 
 void Zone::addTouchToFrame(int i, Touch t)
@@ -79,121 +117,67 @@ void Zone::addTouchToFrame(int i, Touch t)
 	u.x = mXRangeInv(t.x);
 	u.y = mYRangeInv(t.y);
 	mTouches0[i] = u;
-}
-
-void Zone::storeAnyNewTouches()
-{
-	for(int i=0; i<kMaxTouches; ++i)
-	{
-		// store start of touch
-		if (touchIsActive(mTouches0[i]) && !(touchIsActive(mTouches1[i])))
-		{
-			mStartTouches[i] = mTouches0[i];
-		}
-	}
-}
-
-int Zone::getNumberOfActiveTouches() const
-{
-	int activeTouches = 0;
-	for(int i=0; i<kMaxTouches; ++i)
+	if(touchIsActive(u))
 	{
-		if(touchIsActive(mTouches0[i]))
-		{
-			activeTouches++;
-		}
+		mActive0 |= touchBit(i);
 	}
-	return activeTouches;
 }
 
-int Zone::getNumberOfNewTouches() const
+void Zone::storeAnyNewTouches()
 {
-	int newTouches = 0;
-	for(int i=0; i<kMaxTouches; ++i)
-	{
-		if(touchIsActive(mTouches0[i]) && (!touchIsActive(mTouches1[i])))
-		{
-			newTouches++;
-		}
-	}
-	return newTouches;
+	// store start of touch
+	forEachTouch(mActive0 & ~mActive1, [&](int i){ mStartTouches[i] = mTouches0[i]; });
 }
 
-Vec3 Zone::getAveragePositionOfActiveTouches() const
+Zone::ActiveTouchSummary Zone::summarizeActiveTouches() const
 {
-	Vec2 avg;
-	int activeTouches = 0;
-	for(int i=0; i<kMaxTouches; ++i)
+	ActiveTouchSummary s;
+	forEachTouch(mActive0, [&](int i)
 	{
-		Touch t = mTouches0[i];
-		if(touchIsActive(t))
-		{
-			avg += Vec2{t.x, t.y};
-			activeTouches++;
-		}
-	}
-	if(activeTouches > 0)
+		const Touch& t = mTouches0[i];
+		s.position += Vec2{t.x, t.y};
+		s.maxZ = std::max(s.maxZ, t.z);
+		s.count++;
+	});
+	if(s.count > 0)
 	{
-		avg *= (1.f / (float)activeTouches);
+		s.position *= (1.f / (float)s.count);
 	}
-	return avg;
+	return s;
 }
 
-float Zone::getMaxZOfActiveTouches() const
+const Zone::ProcessFn Zone::kProcessFns[kNumZoneTypes] =
 {
-	float maxZ = 0.f;
-	for(int i=0; i<kMaxTouches; ++i)
-	{
-		Touch t = mTouches0[i];
-		if(touchIsActive(t))
-		{
-			float z = t.z;
-			if(z > maxZ)
-			{
-				maxZ = z;
-			}
-		}
-	}
-	return maxZ;
-}
+	[](Zone&, const std::bitset<kMaxTouches>&) {},
+	[](Zone& z, const std::bitset<kMaxTouches>& freed) { z.processTouchesNoteRow(freed); },
+	[](Zone& z, const std::bitset<kMaxTouches>&) { z.processTouchesControllerX(); },
+	[](Zone& z, const std::bitset<kMaxTouches>&) { z.processTouchesControllerY(); },
+	[](Zone& z, const std::bitset<kMaxTouches>&) { z.processTouchesControllerXY(); },
+	[](Zone& z, const std::bitset<kMaxTouches>&) { z.processTouchesControllerToggle(); },
+	[](Zone& z, const std::bitset<kMaxTouches>&) { z.processTouchesControllerPressure(); }
+};
 
 // after all touches for a frame have been received using addTouchToFrame, generate
 // any needed messages about the frame and prepare for the next frame.
 void Zone::processTouches(const std::bitset<kMaxTouches>& freedTouches)
 {
 	mOutputController.type = mType;
-	mOutputController.name = mName;
+	mOutputController.name = mNameSymbol;
+	mOutputController.hiRes = mHiRes;
 	//	mOutputController.active = true;
 	
-	if(mType == "note_row")
-	{
-			processTouchesNoteRow(freedTouches);
-	}
-	else if(mType == "x")
-	{
-			processTouchesControllerX();
-	}
-	else if(mType == "y")
-	{
-			processTouchesControllerY();
-	}
-	else if(mType == "xy")
-	{
-			processTouchesControllerXY();
-	}
-	else if(mType == "toggle")
-	{
-			processTouchesControllerToggle();
-	}
-	else if(mType == "z")
+	kProcessFns[mType](*this, freedTouches);
+	
+	// toggles jump between their two values.
+	if(isControllerZoneType(mType) && (mType != kZoneTypeToggle))
 	{
-			processTouchesControllerPressure();
+		filterControllerValues();
 	}
 }
 
 void Zone::processTouchesNoteRow(const std::bitset<kMaxTouches>& freedTouches)
 {
-	for(int i=0; i<kMaxTouches; ++i)
+	forEachTouch(mActive0, [&](int i)
 	{
 		Touch t1 = mTouches0[i];
 		Touch t2 = mTouches1[i];
@@ -233,11 +217,11 @@ void Zone::processTouchesNoteRow(const std::bitset<kMaxTouches>& freedTouches)
 		
 		if(mQuantize)
 		{
-			scaleNote = mScaleMap[(int)touchPos];
+			scaleNote = mScale.getNote((int)touchPos);
 		}
 		else
 		{
-			scaleNote = mScaleMap.getInterpolatedLinear(touchPos - 0.5f);
+			scaleNote = mScale.getInterpolatedNote(touchPos - 0.5f);
 		}
 		
 		if(isActive && !wasActive)
@@ -262,6 +246,7 @@ void Zone::processTouchesNoteRow(const std::bitset<kMaxTouches>& freedTouches)
 			}
 			float note = mStartNote + mTranspose + scaleNote;
 			mOutputTouches[i] = Touch{.x = t1x, .y = t1y, .z = t1z, .dz = t1dz, .note = note, .state = kTouchStateOn};
+			mOutputMask |= touchBit(i);
 		}
 		else if(isActive)
 		{
@@ -274,58 +259,59 @@ void Zone::processTouchesNoteRow(const std::bitset<kMaxTouches>& freedTouches)
 			
 			float note = mStartNote + mTranspose + scaleNote + vibratoHP;
 			mOutputTouches[i] = Touch{.x = t1x, .y = t1y, .z = t1z, .dz = t1dz, .note = note, .state = kTouchStateContinue, .vibrato = vibratoHP};
+			mOutputMask |= touchBit(i);
 		}
-	}
+	});
 }
 
 void Zone::processTouchesControllerX()
 {
-	if(getNumberOfActiveTouches() > 0)
+	if(mActive0)
 	{
-		float zVal = ml::clamp(getMaxZOfActiveTouches(), 0.f, 1.f);
+		ActiveTouchSummary touches = summarizeActiveTouches();
+		float zVal = ml::clamp(touches.maxZ, 0.f, 1.f);
 		if(zVal > 0.f)
 		{
-			Vec3 avgPos = getAveragePositionOfActiveTouches();
-			float xVal = ml::clamp(avgPos.x(), 0.f, 1.f);
+			float xVal = ml::clamp(touches.position.x(), 0.f, 1.f);
 			
 			mOutputController.number1 = mControllerNum1;
-			mOutputController.x=xVal;
+			mControllerTargets[0] = xVal;
 		}
 	}
 }
 
 void Zone::processTouchesControllerY()
 {
-	if(getNumberOfActiveTouches() > 0)
+	if(mActive0)
 	{
-		Vec3 avgPos = getAveragePositionOfActiveTouches();
-		float yVal = ml::clamp(avgPos.y(), 0.f, 1.f);
+		ActiveTouchSummary touches = summarizeActiveTouches();
+		float yVal = ml::clamp(touches.position.y(), 0.f, 1.f);
 		mOutputController.number1 = mControllerNum1;
-		mOutputController.y = yVal;
+		mControllerTargets[1] = yVal;
 	}
 }
 
 void Zone::processTouchesControllerXY()
 {
-	if(getNumberOfActiveTouches() > 0)
+	if(mActive0)
 	{
-		float zVal = ml::clamp(getMaxZOfActiveTouches(), 0.f, 1.f);
+		ActiveTouchSummary touches = summarizeActiveTouches();
+		float zVal = ml::clamp(touches.maxZ, 0.f, 1.f);
 		if(zVal > 0.f)
 		{
-		Vec3 avgPos = getAveragePositionOfActiveTouches();
-		float xVal = ml::clamp(avgPos.x(), 0.f, 1.f);
-		float yVal = ml::clamp(avgPos.y(), 0.f, 1.f);
+		float xVal = ml::clamp(touches.position.x(), 0.f, 1.f);
+		float yVal = ml::clamp(touches.position.y(), 0.f, 1.f);
 		mOutputController.number1 = mControllerNum1;
 		mOutputController.number2 = mControllerNum2;
-		mOutputController.x=xVal;
-		mOutputController.y = yVal;
+		mControllerTargets[0] = xVal;
+		mControllerTargets[1] = yVal;
 		}
 	}
 }
 
 void Zone::processTouchesControllerToggle()
 {
-	bool touchOn = getNumberOfNewTouches() > 0;
+	bool touchOn = (mActive0 & ~mActive1) != 0;
 	if(touchOn)
 	{
 		mToggleValue = !mToggleValue;
@@ -337,9 +323,18 @@ void Zone::processTouchesControllerToggle()
 
 void Zone::processTouchesControllerPressure()
 {
-	float zVal = ml::clamp(getMaxZOfActiveTouches(), 0.f, 1.f);
+	float zVal = ml::clamp(summarizeActiveTouches().maxZ, 0.f, 1.f);
 	mOutputController.number1 = mControllerNum1;
-	mOutputController.z=zVal;
+	mControllerTargets[2] = zVal;
+}
+
+// move the controller values toward their targets every frame, so that smoothing and
+// slewing carry on after the touch has gone.
+void Zone::filterControllerValues()
+{
+	mOutputController.x = mControllerFilters[0].process(mControllerTargets[0]);
+	mOutputController.y = mControllerFilters[1].process(mControllerTargets[1]);
+	mOutputController.z = mControllerFilters[2].process(mControllerTargets[2]);
 }
 
 
@@ -350,7 +345,7 @@ void Zone::processTouchesControllerPressure()
 // say 16 possible touches?
 void Zone::processTouchesNoteOffs(std::bitset<kMaxTouches>& freedTouches)
 {
-	for(int i=0; i<kMaxTouches; ++i)
+	forEachTouch(mActive1 & ~mActive0, [&](int i)
 	{
 		Touch t1 = mTouches0[i];
 		Touch t2 = mTouches1[i];
@@ -363,11 +358,11 @@ void Zone::processTouchesNoteOffs(std::bitset<kMaxTouches>& freedTouches)
 		float scaleNote;
 		if(mQuantize)
 		{
-			scaleNote = mScaleMap[(int)xPos];
+			scaleNote = mScale.getNote((int)xPos);
 		}
 		else
 		{
-			scaleNote = mScaleMap.getInterpolatedLinear(xPos - 0.5f);
+			scaleNote = mScale.getInterpolatedNote(xPos - 0.5f);
 		}
 		if(wasActive)
 		{
@@ -385,15 +380,16 @@ void Zone::processTouchesNoteOffs(std::bitset<kMaxTouches>& freedTouches)
 				else
 				{
 					float lastX = mXRange(t2.x) - mBounds.left();
-					lastScaleNote = mScaleMap.getInterpolatedLinear(lastX - 0.5f);
+					lastScaleNote = mScale.getInterpolatedNote(lastX - 0.5f);
 				}
 				freedTouches[i] = true;
 				
 				// set state
 				float note = mStartNote + mTranspose + lastScaleNote;
 				mOutputTouches[i] = Touch{.x = t2.x, .y = t2.y, .z = t2.z, .dz = t2.dz, .note = note, .state = kTouchStateOff};
+				mOutputMask |= touchBit(i);
 			}
 		}
-	}
+	});
 }
 
@@ -13,11 +13,14 @@
 #include "SoundplaneDriver.h"
 #include "MLOSCListener.h"
 #include "TouchTracker.h"
+#include "ZoneScale.h"
+#include "ControllerFilter.h"
 
 #include "MLSymbol.h"
 #include "MLParameter.h"
 #include "MLFileCollection.h"
 
+#include <array>
 #include <list>
 #include <map>
 
@@ -26,23 +29,58 @@
 #include "NetService.h"
 #include "NetServiceBrowser.h"
 
+// Zone types, compiled from the "type" symbols in zone files when the zones are loaded.
+
+enum ZoneType
+{
+	kZoneTypeNone = 0,
+	kZoneTypeNoteRow,
+	kZoneTypeX,
+	kZoneTypeY,
+	kZoneTypeXY,
+	kZoneTypeToggle,
+	kZoneTypeZ,
+	kNumZoneTypes
+};
+
+// returns kZoneTypeNone for an unknown type.
+ZoneType zoneTypeFromSymbol(Symbol t);
+
+inline bool isControllerZoneType(ZoneType t)
+{
+	switch(t)
+	{
+		case kZoneTypeX:
+		case kZoneTypeY:
+		case kZoneTypeXY:
+		case kZoneTypeToggle:
+		case kZoneTypeZ:
+			return true;
+		default:
+			return false;
+	}
+}
+
 // Zone messages - currently used only for Controllers. TODO use for touches?
 
 struct ZoneMessage
 {
 	Symbol name{};
-	Symbol type{};
+	ZoneType type{kZoneTypeNone};
 	int number1{0};
 	int number2{0};
 	int offset{0};
 	float x{0.f};
 	float y{0.f};
 	float z{0.f};
+	bool hiRes{false};
 };
 
+// values are quantized by the zone's ControllerFilters, so they can be compared exactly.
 inline bool operator==(const ZoneMessage& a, const ZoneMessage& b)
 {
-	return (memcmp(&a, &b, sizeof(ZoneMessage)) == 0);
+	return (a.name == b.name) && (a.type == b.type) && (a.number1 == b.number1) && (a.number2 == b.number2) &&
+		(a.offset == b.offset) && (a.x == b.x) && (a.y == b.y) && (a.z == b.z) && (a.hiRes == b.hiRes);
 }
 
 inline bool operator!=(const ZoneMessage& a, const ZoneMessage& b)
@@ -50,18 +88,11 @@ inline bool operator!=(const ZoneMessage& a, const ZoneMessage& b)
 	return !(a == b);
 }
 
-inline bool isControllerZoneType(Symbol t)
-{
-	if(t == "x") return true;
-	if(t == "y") return true;
-	if(t == "xy") return true;
-	if(t == "z") return true;
-	if(t == "toggle") return true;
-	return false;
-}
-
 const int kZoneValArraySize = 8;
 
+// controller dead-band in steps of 1/128, for zones that do not set one.
+const float kDefaultControllerDeadband = 0.25f;
+
 class Zone
 {
 	friend class SoundplaneModel;
@@ -90,14 +121,23 @@ public:
 	
 	const ml::TextFragment getName() const { return mName; }
 	MLRect getBounds() const { return mBounds; }
-	Symbol getType() const { return mType; }
+	ZoneType getType() const { return mType; }
+	bool isController() const { return isControllerZoneType(mType); }
 	int getOffset() const { return mOffset; }
 	
 	const ZoneMessage& getController() const { return mOutputController; }
+	TouchMask getOutputMask() const { return mOutputMask; }
 	
 	void setZoneID(int z) { mZoneID = z; }
 	void setSnapFreq(float f);
 	
+	// tune the keys to a compiled pitch table, one note per key. Call after setting bounds.
+	void setScaleNotes(const std::vector< float >& notes) { mScale.setNotes(notes); }
+	
+	// set how controller values are shaped before they are sent. See ControllerFilter.
+	// hiRes asks the MIDI output for 14-bit controller pairs.
+	void setControllerResponse(float smoothMs, float slewRate, float deadband, bool hiRes);
+	
 	// set bounds in key grid
 	void setBounds(MLRect b);
 	
@@ -111,7 +151,7 @@ public:
 protected:
 	
 	int mZoneID{0};
-	Symbol mType{};
+	ZoneType mType{kZoneTypeNone};
 	int mStartNote{60};
 	
 	float mVibrato{0};
@@ -120,35 +160,48 @@ protected:
 	bool mNoteLock{false};
 	int mTranspose{0};
 	
-	// start note falls on this degree of scale-- for diatonic and other non-chromatic scales
-	int mScaleNoteOffset = 0;
-	
-	// TODO make a scale object instead
-	ml::Matrix mScaleMap{};
+	// pitch of each key over the zone's width, chromatic unless a scale is set.
+	ZoneScale mScale;
 	
 	int mControllerNum1{0};
 	int mControllerNum2{0};
 	int mControllerNum3{0};
 	
 	bool mToggleValue{};
+	
+	// targets for the x, y and z controller values, set by touches and followed by the filters.
+	std::array< float, 3 > mControllerTargets{};
+	std::array< ControllerFilter, 3 > mControllerFilters;
+	bool mHiRes{false};
+	
 	int mOffset{0};
 	ml::TextFragment mName{"unnamed zone"};
+	Symbol mNameSymbol{"unnamed zone"};
 	
 	// states read by the Model to generate output
 	TouchArray mOutputTouches{};
 	ZoneMessage mOutputController;
 	
 private:
-	int getNumberOfActiveTouches() const;
-	int getNumberOfNewTouches() const;
-	Vec3 getAveragePositionOfActiveTouches() const;
-	float getMaxZOfActiveTouches() const;
+	// the number, average position and greatest pressure of the active touches.
+	struct ActiveTouchSummary
+	{
+		int count{0};
+		Vec2 position;
+		float maxZ{0.f};
+	};
+	ActiveTouchSummary summarizeActiveTouches() const;
 	
 	void processTouchesControllerX();
 	void processTouchesControllerY();
 	void processTouchesControllerXY();
 	void processTouchesControllerToggle();
 	void processTouchesControllerPressure();
+	void filterControllerValues();
+	
+	// process functions for each ZoneType, indexed by type.
+	typedef void (*ProcessFn)(Zone& z, const std::bitset<kMaxTouches>& freedTouches);
+	static const ProcessFn kProcessFns[kNumZoneTypes];
 	
 	// touch locations are stored scaled to [0..1] over the Zone boundary.
 	// incoming touches
@@ -158,6 +211,11 @@ private:
 	// touch positions saved at touch onsets
 	TouchArray mStartTouches{};
 	
+	// the active touches in mTouches0 and mTouches1, and the touches set in mOutputTouches.
+	TouchMask mActive0{0};
+	TouchMask mActive1{0};
+	TouchMask mOutputMask{0};
+	
 	std::vector<MLBiquad> mNoteFilters;
 	std::vector<MLBiquad> mVibratoFilters;
 };
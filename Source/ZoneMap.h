@@ -0,0 +1,101 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <stdint.h>
+
+#include "Zone.h"
+
+// A set of zones, stored as a bitmask of their indices.
+
+struct ZoneSet
+{
+	static const int kWords = (kSoundplaneAMaxZones + 63)/64;
+	std::array< uint64_t, kWords > bits{};
+
+	void add(int z) { bits[z >> 6] |= (1ull << (z & 63)); }
+	void remove(int z) { bits[z >> 6] &= ~(1ull << (z & 63)); }
+	bool contains(int z) const { return (bits[z >> 6] >> (z & 63)) & 1; }
+
+	// call f(z) for each zone index z in the set, in increasing order.
+	template< typename F >
+	void forEach(F f) const
+	{
+		for(int w=0; w<kWords; ++w)
+		{
+			uint64_t b = bits[w];
+			while(b)
+			{
+				f((w << 6) + __builtin_ctzll(b));
+				b &= b - 1;
+			}
+		}
+	}
+};
+
+// The Model's properties that apply to every Zone. A snapshot is made by the thread
+// setting the properties and handed to the process thread, which copies it into its Zones.
+
+struct ZoneParameters
+{
+	float vibrato{0.f};
+	float hysteresis{0.f};
+	bool quantize{false};
+	bool noteLock{false};
+	int transpose{0};
+	float snap{0.f};
+};
+
+// A zone layout: the Zones, the set of Zones over each key, and the Zones of each type.
+// Controller zones can be layered over each other and over a note row. Each key is in
+// at most one note row, because the outputs have one voice per touch.
+//
+// A ZoneMap is built completely by the thread loading the zones and then handed
+// to the process thread. After that its layout does not change, and only the process
+// thread updates the touch states in its Zones.
+
+struct ZoneMap
+{
+	std::vector< Zone > zones;
+
+	// the Zones over each key, indexed by (y*kSoundplaneAKeyWidth + x).
+	std::array< ZoneSet, kSoundplaneAKeyWidth*kSoundplaneAKeyHeight > keyZones{};
+
+	// indices into zones for each ZoneType.
+	std::array< std::vector< int >, kNumZoneTypes > zonesByType;
+
+	const ZoneSet& getZonesAtKey(int x, int y) const
+	{
+		static const ZoneSet kNoZones{};
+		if((x < 0) || (x >= kSoundplaneAKeyWidth) || (y < 0) || (y >= kSoundplaneAKeyHeight)) return kNoZones;
+		return keyZones[y*kSoundplaneAKeyWidth + x];
+	}
+
+	// add zone z over key (x, y). Returns the note row it replaced there, or -1.
+	int addZoneAtKey(int z, int x, int y);
+};
+
+inline int ZoneMap::addZoneAtKey(int z, int x, int y)
+{
+	if((x < 0) || (x >= kSoundplaneAKeyWidth) || (y < 0) || (y >= kSoundplaneAKeyHeight)) return -1;
+	ZoneSet& keySet = keyZones[y*kSoundplaneAKeyWidth + x];
+	int replaced = -1;
+	if(zones[z].getType() == kZoneTypeNoteRow)
+	{
+		keySet.forEach([&](int other)
+		{
+			if(zones[other].getType() == kZoneTypeNoteRow)
+			{
+				keySet.remove(other);
+				replaced = other;
+			}
+		});
+	}
+	keySet.add(z);
+	return replaced;
+}
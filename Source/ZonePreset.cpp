@@ -0,0 +1,298 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "ZonePreset.h"
+
+#include "MLScale.h"
+#include "OSCPacketTemplate.h"
+
+#include <algorithm>
+
+namespace
+{
+	// no string or table in a preset comes near this. Anything longer is a corrupt cache.
+	const uint32_t kMaxCachedSize = 1 << 24;
+
+	template< typename T >
+	void writeValue(std::ostream& out, const T& v)
+	{
+		out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+	}
+
+	template< typename T >
+	bool readValue(std::istream& in, T& v)
+	{
+		return static_cast<bool>(in.read(reinterpret_cast<char*>(&v), sizeof(T)));
+	}
+
+	void writeString(std::ostream& out, const std::string& s)
+	{
+		writeValue(out, static_cast<uint32_t>(s.size()));
+		out.write(s.data(), s.size());
+	}
+
+	bool readString(std::istream& in, std::string& s)
+	{
+		uint32_t n;
+		if(!readValue(in, n) || (n > kMaxCachedSize)) return false;
+		s.resize(n);
+		return (n == 0) || static_cast<bool>(in.read(&s[0], n));
+	}
+
+	template< typename T >
+	void writeVector(std::ostream& out, const std::vector< T >& v)
+	{
+		writeValue(out, static_cast<uint32_t>(v.size()));
+		out.write(reinterpret_cast<const char*>(v.data()), v.size()*sizeof(T));
+	}
+
+	template< typename T >
+	bool readVector(std::istream& in, std::vector< T >& v)
+	{
+		uint32_t n;
+		if(!readValue(in, n) || (n > kMaxCachedSize/sizeof(T))) return false;
+		v.resize(n);
+		return (n == 0) || static_cast<bool>(in.read(reinterpret_cast<char*>(v.data()), n*sizeof(T)));
+	}
+
+	float getJSONFloat(cJSON* pNode, const char* name, float defaultValue)
+	{
+		cJSON* pItem = cJSON_GetObjectItem(pNode, name);
+		return (pItem && (pItem->type == cJSON_Number)) ? static_cast<float>(pItem->valuedouble) : defaultValue;
+	}
+
+	int64_t getScaleFileTime(const std::string& relativePath)
+	{
+		File scaleFile = File(MLScale::mRootPath).getChildFile(String(relativePath.c_str())).withFileExtension(".scl");
+		int64_t t = scaleFile.getLastModificationTime().toMilliseconds();
+		File mappingFile = scaleFile.withFileExtension(".kbm");
+		if(mappingFile.exists())
+		{
+			t = std::max(t, static_cast<int64_t>(mappingFile.getLastModificationTime().toMilliseconds()));
+		}
+		return t;
+	}
+}
+
+bool compileZonePreset(const std::string& json, ZonePreset& preset)
+{
+	preset.zones.clear();
+	preset.json = json;
+
+	cJSON* root = cJSON_Parse(json.c_str());
+	if(!root)
+	{
+		MLConsole() << "zone file parse failed!\n";
+		const char* errStr = cJSON_GetErrorPtr();
+		MLConsole() << "    error at: " << errStr << "\n";
+		return false;
+	}
+	for(cJSON* pNode = root->child; pNode; pNode = pNode->next)
+	{
+		if(strcmp(pNode->string, "zone")) continue;
+
+		preset.zones.emplace_back(ZoneRecord());
+		ZoneRecord& r = preset.zones.back();
+
+		cJSON* pZoneType = cJSON_GetObjectItem(pNode, "type");
+		if(pZoneType)
+		{
+			// get zone type and type specific attributes
+			r.type = zoneTypeFromSymbol(Symbol(pZoneType->valuestring));
+			if(r.type == kZoneTypeNone)
+			{
+				MLConsole() << "Unknown zone type " << pZoneType->valuestring << "\n";
+			}
+		}
+		else
+		{
+			MLConsole() << "No type for zone!\n";
+		}
+
+		// get the keys the zone covers, if it is not the whole rect.
+		cJSON* pZoneKeys = cJSON_GetObjectItem(pNode, "keys");
+		if(pZoneKeys && (pZoneKeys->type == cJSON_Array))
+		{
+			for(cJSON* pKey = pZoneKeys->child; pKey; pKey = pKey->next)
+			{
+				int kx = -1, ky = -1;
+				if(cJSON_GetArraySize(pKey) == 2)
+				{
+					kx = cJSON_GetArrayItem(pKey, 0)->valueint;
+					ky = cJSON_GetArrayItem(pKey, 1)->valueint;
+				}
+				if((kx >= 0) && (kx < kSoundplaneAKeyWidth) && (ky >= 0) && (ky < kSoundplaneAKeyHeight))
+				{
+					r.keys.emplace_back(kx, ky);
+				}
+				else
+				{
+					MLConsole() << "Bad key for zone!\n";
+				}
+			}
+		}
+
+		// get zone rect in keys
+		cJSON* pZoneRect = cJSON_GetObjectItem(pNode, "rect");
+		if(pZoneRect)
+		{
+			int size = cJSON_GetArraySize(pZoneRect);
+			if(size == 4)
+			{
+				r.x = cJSON_GetArrayItem(pZoneRect, 0)->valueint;
+				r.y = cJSON_GetArrayItem(pZoneRect, 1)->valueint;
+				r.w = cJSON_GetArrayItem(pZoneRect, 2)->valueint;
+				r.h = cJSON_GetArrayItem(pZoneRect, 3)->valueint;
+			}
+			else
+			{
+				MLConsole() << "Bad rect for zone!\n";
+			}
+		}
+		else if(!r.keys.empty())
+		{
+			// the bounds of a zone with only keys are the smallest rect around them.
+			int left = r.keys[0].first, right = left, top = r.keys[0].second, bottom = top;
+			for(const auto& k : r.keys)
+			{
+				left = std::min(left, static_cast<int>(k.first));
+				right = std::max(right, static_cast<int>(k.first));
+				top = std::min(top, static_cast<int>(k.second));
+				bottom = std::max(bottom, static_cast<int>(k.second));
+			}
+			r.x = left;
+			r.y = top;
+			r.w = right - left + 1;
+			r.h = bottom - top + 1;
+		}
+		else
+		{
+			MLConsole() << "No rect for zone\n";
+		}
+
+		cJSON* pName = cJSON_GetObjectItem(pNode, "name");
+		if(pName && (pName->type == cJSON_String))
+		{
+			r.name = pName->valuestring;
+			if(isControllerZoneType(r.type) && (r.name.size() + 1 > OSCMessageTemplate::kMaxAddressLength))
+			{
+				MLConsole() << "zone " << r.name << ": name is too long for an OSC address, its controller won't be sent by OSC.\n";
+			}
+		}
+		r.note = getJSONInt(pNode, "note");
+		r.offset = getJSONInt(pNode, "offset");
+		r.ctrl1 = getJSONInt(pNode, "ctrl1");
+		r.ctrl2 = getJSONInt(pNode, "ctrl2");
+		r.ctrl3 = getJSONInt(pNode, "ctrl3");
+
+		r.smooth = getJSONFloat(pNode, "smooth", 0.f);
+		r.slew = getJSONFloat(pNode, "slew", 0.f);
+		r.deadband = getJSONFloat(pNode, "deadband", kDefaultControllerDeadband);
+		cJSON* pHiRes = cJSON_GetObjectItem(pNode, "hires");
+		r.hiRes = pHiRes && (pHiRes->type == cJSON_True);
+		if(r.hiRes && ((r.ctrl1 >= 32) || (r.ctrl2 >= 32)))
+		{
+			MLConsole() << "zone " << r.name << ": 14-bit controllers must be below 32, sending 7-bit.\n";
+			r.hiRes = false;
+		}
+
+		// tune the zone to a Scala scale: the path of a .scl file in the scales folder,
+		// without the extension. A .kbm mapping file with the same name is used if present.
+		cJSON* pScale = cJSON_GetObjectItem(pNode, "scale");
+		if(pScale && (pScale->type == cJSON_String))
+		{
+			MLScale scale;
+			scale.loadFromRelativePath(ml::Text(pScale->valuestring));
+			ZoneScale zoneScale;
+			zoneScale.setFromScale(scale, r.note, r.w + 1);
+			r.scale = pScale->valuestring;
+			r.scaleNotes = zoneScale.getNotes();
+		}
+	}
+	cJSON_Delete(root);
+
+	preset.scaleTime = getZonePresetScaleTime(preset);
+	return true;
+}
+
+int64_t getZonePresetScaleTime(const ZonePreset& preset)
+{
+	int64_t t = 0;
+	for(const auto& r : preset.zones)
+	{
+		if(!r.scale.empty())
+		{
+			t = std::max(t, getScaleFileTime(r.scale));
+		}
+	}
+	return t;
+}
+
+bool zonePresetIsCurrent(const ZonePreset& preset, int64_t fileTime)
+{
+	return (preset.fileTime == fileTime) && (getZonePresetScaleTime(preset) == preset.scaleTime);
+}
+
+void writeZonePreset(std::ostream& out, const ZonePreset& preset)
+{
+	writeValue(out, preset.fileTime);
+	writeValue(out, preset.scaleTime);
+	writeString(out, preset.json);
+	writeValue(out, static_cast<uint32_t>(preset.zones.size()));
+	for(const auto& r : preset.zones)
+	{
+		writeValue(out, static_cast<int32_t>(r.type));
+		int16_t fields[] = {r.x, r.y, r.w, r.h, r.note, r.offset, r.ctrl1, r.ctrl2, r.ctrl3};
+		out.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+		float response[] = {r.smooth, r.slew, r.deadband};
+		out.write(reinterpret_cast<const char*>(response), sizeof(response));
+		writeValue(out, static_cast<uint8_t>(r.hiRes));
+		writeVector(out, r.keys);
+		writeString(out, r.name);
+		writeString(out, r.scale);
+		writeVector(out, r.scaleNotes);
+	}
+}
+
+bool readZonePreset(std::istream& in, ZonePreset& preset)
+{
+	uint32_t zones;
+	if(!readValue(in, preset.fileTime)) return false;
+	if(!readValue(in, preset.scaleTime)) return false;
+	if(!readString(in, preset.json)) return false;
+	if(!readValue(in, zones) || (zones > kMaxCachedSize/sizeof(ZoneRecord))) return false;
+	preset.zones.resize(zones);
+	for(auto& r : preset.zones)
+	{
+		int32_t type;
+		if(!readValue(in, type)) return false;
+		if((type < 0) || (type >= kNumZoneTypes)) return false;
+		r.type = static_cast<ZoneType>(type);
+		int16_t fields[9];
+		if(!in.read(reinterpret_cast<char*>(fields), sizeof(fields))) return false;
+		r.x = fields[0];
+		r.y = fields[1];
+		r.w = fields[2];
+		r.h = fields[3];
+		r.note = fields[4];
+		r.offset = fields[5];
+		r.ctrl1 = fields[6];
+		r.ctrl2 = fields[7];
+		r.ctrl3 = fields[8];
+		float response[3];
+		uint8_t hiRes;
+		if(!in.read(reinterpret_cast<char*>(response), sizeof(response))) return false;
+		if(!readValue(in, hiRes)) return false;
+		r.smooth = response[0];
+		r.slew = response[1];
+		r.deadband = response[2];
+		r.hiRes = hiRes;
+		if(!readVector(in, r.keys)) return false;
+		if(!readString(in, r.name)) return false;
+		if(!readString(in, r.scale)) return false;
+		if(!readVector(in, r.scaleNotes)) return false;
+	}
+	return true;
+}
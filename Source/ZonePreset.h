@@ -0,0 +1,69 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+#include "Zone.h"
+
+// One zone of a compiled zone preset: everything read from its JSON object, with the
+// bounds worked out and any scale compiled to a pitch table.
+
+struct ZoneRecord
+{
+	ZoneType type{kZoneTypeNone};
+	int16_t x{0}, y{0}, w{0}, h{0};
+	int16_t note{0}, offset{0};
+	int16_t ctrl1{0}, ctrl2{0}, ctrl3{0};
+
+	// the keys covered, or empty if the zone covers its whole rect.
+	std::vector< std::pair< int8_t, int8_t > > keys;
+
+	std::string name;
+
+	// controller response: smoothing time in ms, slew limit in ranges per second,
+	// dead-band in steps of 1/128, and 14-bit MIDI output.
+	float smooth{0.f};
+	float slew{0.f};
+	float deadband{kDefaultControllerDeadband};
+	bool hiRes{false};
+
+	// relative path of the scale file, and its pitch table. Both are empty for 12-equal.
+	std::string scale;
+	std::vector< float > scaleNotes;
+};
+
+// A zone preset compiled from JSON. The source text is kept so that the preset can be
+// restored to the Model's zone_JSON property without reading the file again.
+
+struct ZonePreset
+{
+	std::vector< ZoneRecord > zones;
+	std::string json;
+
+	// modification times in ms of the preset file and the newest scale file it uses.
+	int64_t fileTime{0};
+	int64_t scaleTime{0};
+};
+
+// parse and validate zone JSON, reporting any problems to the console. Returns false
+// only if the JSON could not be parsed; zones with errors are compiled as well as they can be.
+bool compileZonePreset(const std::string& json, ZonePreset& preset);
+
+// the modification time in ms of the newest scale file used by the preset, or 0.
+int64_t getZonePresetScaleTime(const ZonePreset& preset);
+
+// true if neither the preset file, now modified at fileTime, nor its scales have changed
+// since the preset was compiled.
+bool zonePresetIsCurrent(const ZonePreset& preset, int64_t fileTime);
+
+// binary form for the preset cache. Reads fail on a short or malformed stream.
+void writeZonePreset(std::ostream& out, const ZonePreset& preset);
+bool readZonePreset(std::istream& in, ZonePreset& preset);
@@ -0,0 +1,156 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "ZonePresetIndex.h"
+
+#include <fstream>
+
+namespace
+{
+	const uint32_t kCacheMagic = 0x5A505043; // 'ZPPC'
+
+	// increment when the ZonePreset binary form or the ZoneType values change.
+	const uint32_t kCacheVersion = 2;
+}
+
+ZonePresetIndex::ZonePresetIndex(const File& cacheFile) :
+	mCacheFile(cacheFile)
+{
+}
+
+ZonePresetIndex::~ZonePresetIndex()
+{
+}
+
+void ZonePresetIndex::processFileFromCollection(ml::Symbol action, const MLFile& file, const MLFileCollection& collection, int, size_t)
+{
+	if(action == "begin")
+	{
+		readCache();
+		mIndexed.clear();
+		mCompiled = 0;
+	}
+	else if(action == "process")
+	{
+		indexFile(file, collection);
+	}
+	else if(action == "end")
+	{
+		// presets whose files are gone are dropped here.
+		bool removed = false;
+		for(const auto& entry : mCached)
+		{
+			if(!mIndexed.count(entry.first))
+			{
+				removed = true;
+				break;
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(mPresetsMutex);
+			mPresets = mIndexed;
+		}
+		if(mCompiled || removed)
+		{
+			writeCache();
+		}
+		MLConsole() << "ZonePresetIndex: " << static_cast<int>(mIndexed.size()) << " zone presets, " << mCompiled << " compiled.\n";
+		mCached.clear();
+	}
+}
+
+std::shared_ptr< const ZonePreset > ZonePresetIndex::find(const std::string& relativePath) const
+{
+	std::lock_guard<std::mutex> lock(mPresetsMutex);
+	auto it = mPresets.find(relativePath);
+	return (it != mPresets.end()) ? it->second : nullptr;
+}
+
+void ZonePresetIndex::replace(const std::string& relativePath, std::shared_ptr< const ZonePreset > pPreset)
+{
+	std::lock_guard<std::mutex> lock(mPresetsMutex);
+	mPresets[relativePath] = pPreset;
+}
+
+void ZonePresetIndex::indexFile(const MLFile& file, const MLFileCollection& collection)
+{
+	const File& juceFile = file.getJuceFile();
+	if(juceFile.isDirectory()) return;
+	std::string path = collection.getRelativePathFromName(file.getLongName()).toString();
+	int64_t fileTime = juceFile.getLastModificationTime().toMilliseconds();
+
+	std::shared_ptr< const ZonePreset > pPreset;
+	auto it = mCached.find(path);
+	if((it != mCached.end()) && zonePresetIsCurrent(*it->second, fileTime))
+	{
+		pPreset = it->second;
+	}
+	else
+	{
+		std::shared_ptr< ZonePreset > pNew = std::make_shared< ZonePreset >();
+		String zoneStr(juceFile.loadFileAsString());
+		if(!compileZonePreset(std::string(zoneStr.toUTF8()), *pNew))
+		{
+			MLConsole() << "    in zone preset " << path << "\n";
+			return;
+		}
+		pNew->fileTime = fileTime;
+		pPreset = pNew;
+		mCompiled++;
+	}
+
+	mIndexed[path] = pPreset;
+	std::lock_guard<std::mutex> lock(mPresetsMutex);
+	mPresets[path] = pPreset;
+}
+
+void ZonePresetIndex::readCache()
+{
+	mCached.clear();
+	std::ifstream in(mCacheFile.getFullPathName().toUTF8(), std::ios::binary);
+	if(!in) return;
+
+	uint32_t magic, version, count;
+	if(!in.read(reinterpret_cast<char*>(&magic), sizeof(magic)) || (magic != kCacheMagic)) return;
+	if(!in.read(reinterpret_cast<char*>(&version), sizeof(version)) || (version != kCacheVersion)) return;
+	if(!in.read(reinterpret_cast<char*>(&count), sizeof(count))) return;
+	for(uint32_t i=0; i<count; ++i)
+	{
+		uint32_t pathSize;
+		if(!in.read(reinterpret_cast<char*>(&pathSize), sizeof(pathSize)) || (pathSize > 4096)) break;
+		std::string path(pathSize, 0);
+		if(pathSize && !in.read(&path[0], pathSize)) break;
+		std::shared_ptr< ZonePreset > pPreset = std::make_shared< ZonePreset >();
+		if(!readZonePreset(in, *pPreset)) break;
+		mCached[path] = pPreset;
+	}
+}
+
+void ZonePresetIndex::writeCache() const
+{
+	// write to a temporary file and move it into place, so a cache is never half written.
+	File tempFile = mCacheFile.getSiblingFile(mCacheFile.getFileName() + ".tmp");
+	{
+		std::ofstream out(tempFile.getFullPathName().toUTF8(), std::ios::binary | std::ios::trunc);
+		if(!out)
+		{
+			MLConsole() << "ZonePresetIndex: could not write " << mCacheFile.getFullPathName().toUTF8() << "\n";
+			return;
+		}
+		uint32_t count = mIndexed.size();
+		out.write(reinterpret_cast<const char*>(&kCacheMagic), sizeof(kCacheMagic));
+		out.write(reinterpret_cast<const char*>(&kCacheVersion), sizeof(kCacheVersion));
+		out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+		for(const auto& entry : mIndexed)
+		{
+			uint32_t pathSize = entry.first.size();
+			out.write(reinterpret_cast<const char*>(&pathSize), sizeof(pathSize));
+			out.write(entry.first.data(), pathSize);
+			writeZonePreset(out, *entry.second);
+		}
+		if(!out) return;
+	}
+	tempFile.moveFileTo(mCacheFile);
+}
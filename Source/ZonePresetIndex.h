@@ -0,0 +1,56 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "MLFileCollection.h"
+#include "ZonePreset.h"
+
+// Compiled zone presets by their paths in the zone preset collection. The collection
+// calls the index from its background thread as it finds files. A file is compiled
+// only if it is not in the cache file from the last run or has changed since; at the
+// end of the search the cache is rewritten if anything was compiled or removed.
+// find() can be called from any thread at any time, and finds the presets indexed so far.
+// A preset found may be older than its file, so callers compare it with the file before use.
+
+class ZonePresetIndex : public MLFileCollection::Listener
+{
+public:
+	ZonePresetIndex(const File& cacheFile);
+	~ZonePresetIndex();
+
+	// MLFileCollection::Listener
+	void processFileFromCollection(ml::Symbol action, const MLFile& file, const MLFileCollection& collection, int idx, size_t size) override;
+
+	// the compiled preset at the path, relative to the collection root and without extension,
+	// or null if it has not been indexed.
+	std::shared_ptr< const ZonePreset > find(const std::string& relativePath) const;
+
+	// replace the preset at the path with one compiled after its file changed.
+	void replace(const std::string& relativePath, std::shared_ptr< const ZonePreset > pPreset);
+
+private:
+	typedef std::unordered_map< std::string, std::shared_ptr< const ZonePreset > > PresetMap;
+
+	void indexFile(const MLFile& file, const MLFileCollection& collection);
+	void readCache();
+	void writeCache() const;
+
+	File mCacheFile;
+
+	// presets that can be found. Guarded by mPresetsMutex.
+	PresetMap mPresets;
+	mutable std::mutex mPresetsMutex;
+
+	// used only by the collection's thread during a search.
+	PresetMap mCached;
+	PresetMap mIndexed;
+	int mCompiled{0};
+};
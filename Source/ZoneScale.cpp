@@ -0,0 +1,54 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#include "ZoneScale.h"
+
+#include "MLScale.h"
+
+void ZoneScale::setChromatic(int keys)
+{
+	if(keys < 1) keys = 1;
+	mNotes.resize(keys);
+	for(int i=0; i<keys; ++i)
+	{
+		mNotes[i] = i;
+	}
+	computeSlopes();
+}
+
+void ZoneScale::setFromScale(const MLScale& scale, int startNote, int keys)
+{
+	if(keys < 1) keys = 1;
+	mNotes.resize(keys);
+	for(int i=0; i<keys; ++i)
+	{
+		// MLScale gives log2 of the frequency over 440 Hz, which is MIDI note 69.
+		float midiNote = 69.f + 12.f*scale.noteToLogPitch(startNote + i);
+		mNotes[i] = midiNote - startNote;
+	}
+	computeSlopes();
+}
+
+void ZoneScale::setNotes(const std::vector< float >& notes)
+{
+	if(notes.empty())
+	{
+		setChromatic(1);
+		return;
+	}
+	mNotes = notes;
+	computeSlopes();
+}
+
+void ZoneScale::computeSlopes()
+{
+	int n = getSize();
+	mSlopes.resize(n);
+	for(int i=0; i<n - 1; ++i)
+	{
+		mSlopes[i] = mNotes[i + 1] - mNotes[i];
+	}
+	mSlopes[n - 1] = 0.f;
+}
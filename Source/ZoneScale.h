@@ -0,0 +1,58 @@
+
+// Part of the Soundplane client software by Madrona Labs.
+// Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+// Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+#pragma once
+
+#include <vector>
+
+class MLScale;
+
+// The pitch of each key in a note zone, in semitones from the zone's start note, with
+// the slope to the next key precomputed so that a position between key centers costs
+// one table fetch and one multiply-add. Tables are compiled when zones are loaded.
+
+class ZoneScale
+{
+public:
+	ZoneScale() { setChromatic(1); }
+	~ZoneScale() {}
+
+	// one semitone per key.
+	void setChromatic(int keys);
+
+	// the pitches of MIDI notes startNote to startNote + keys - 1 in the scale.
+	void setFromScale(const MLScale& scale, int startNote, int keys);
+
+	// set the table from the notes of another table, as stored in a compiled zone preset.
+	void setNotes(const std::vector< float >& notes);
+	const std::vector< float >& getNotes() const { return mNotes; }
+
+	int getSize() const { return static_cast<int>(mNotes.size()); }
+
+	// the pitch of key k, clamped to the table.
+	float getNote(int k) const
+	{
+		int n = getSize();
+		k = (k < 0) ? 0 : ((k >= n) ? n - 1 : k);
+		return mNotes[k];
+	}
+
+	// the pitch at fractional key position x, where x = k is the center of key k.
+	// Positions outside the table are clamped to its ends.
+	float getInterpolatedNote(float x) const
+	{
+		int last = getSize() - 1;
+		if(x <= 0.f) return mNotes[0];
+		if(x >= last) return mNotes[last];
+		int i = static_cast<int>(x);
+		return mNotes[i] + mSlopes[i]*(x - i);
+	}
+
+private:
+	void computeSlopes();
+
+	std::vector< float > mNotes;
+	std::vector< float > mSlopes;
+};
@@ -0,0 +1,196 @@
+
+/* Part of the Soundplane client software by Madrona Labs.
+   Copyright (c) 2013 Madrona Labs LLC. http://www.madronalabs.com
+   Distributed under the MIT license: http://madrona-labs.mit-license.org/
+
+   Shared memory output of the Soundplane application, for readers on the same host.
+
+   The segment is a header followed by a ring of frame slots. The writer fills the slot
+   for output frame n at index (n % slot_count), and protects it with a sequence lock:
+   the slot's seq is odd while it is written and 2*(n + 1) once frame n is complete.
+   Readers copy a slot and then check that seq did not change, so they never block
+   the writer and any number of readers may run at once.
+
+   Typical use:
+
+	soundplane_shm_header* h = soundplane_shm_open(SOUNDPLANE_SHM_DEFAULT_NAME);
+	uint64_t next = soundplane_shm_frames_written(h);
+	soundplane_shm_frame frame;
+	while(running)
+	{
+		uint64_t written = soundplane_shm_frames_written(h);
+		if(next > written) next = written;	// the writer restarted
+		while(next < written)
+		{
+			if(soundplane_shm_read_frame(h, next, &frame) == 0) handle(&frame);
+			next++;
+		}
+	}
+
+   Only C99 and the GCC / Clang __atomic builtins are required. */
+
+#ifndef SOUNDPLANE_SHM_H
+#define SOUNDPLANE_SHM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SOUNDPLANE_SHM_DEFAULT_NAME "/soundplane"
+#define SOUNDPLANE_SHM_MAGIC 0x53505348u /* "SPSH" */
+#define SOUNDPLANE_SHM_VERSION 1
+
+#define SOUNDPLANE_SHM_SLOTS 64
+#define SOUNDPLANE_SHM_MAX_TOUCHES 16
+#define SOUNDPLANE_SHM_MAX_CONTROLLERS 32
+#define SOUNDPLANE_SHM_NAME_LENGTH 16
+#define SOUNDPLANE_SHM_SENSOR_WIDTH 64
+#define SOUNDPLANE_SHM_SENSOR_HEIGHT 8
+
+/* touch states, as in the t3d and MIDI outputs. */
+enum
+{
+	SOUNDPLANE_SHM_TOUCH_ON = 1,
+	SOUNDPLANE_SHM_TOUCH_CONTINUE = 2,
+	SOUNDPLANE_SHM_TOUCH_OFF = 3
+};
+
+/* controller zone types. */
+enum
+{
+	SOUNDPLANE_SHM_CONTROLLER_X = 1,
+	SOUNDPLANE_SHM_CONTROLLER_Y = 2,
+	SOUNDPLANE_SHM_CONTROLLER_XY = 3,
+	SOUNDPLANE_SHM_CONTROLLER_Z = 4,
+	SOUNDPLANE_SHM_CONTROLLER_TOGGLE = 5
+};
+
+typedef struct
+{
+	int32_t voice;		/* touch index, 0 - 15 */
+	int32_t offset;		/* zone offset, the same as the OSC port offset */
+	int32_t state;
+	float x;
+	float y;
+	float z;
+	float dz;
+	float note;
+	float vibrato;
+	int32_t reserved;
+} soundplane_shm_touch;
+
+typedef struct
+{
+	int32_t zone;
+	int32_t offset;
+	int32_t type;
+	int32_t number1;
+	int32_t number2;
+	float x;
+	float y;
+	float z;
+	char name[SOUNDPLANE_SHM_NAME_LENGTH];
+} soundplane_shm_controller;
+
+typedef struct
+{
+	uint64_t frame;			/* output frame number */
+	uint64_t time_ns;		/* frame time in ns since the system clock's epoch */
+	int32_t num_touches;
+	int32_t num_controllers;
+	int32_t has_sensor;		/* nonzero if sensor holds this frame's calibrated pressure */
+	int32_t reserved;
+	soundplane_shm_touch touches[SOUNDPLANE_SHM_MAX_TOUCHES];
+	soundplane_shm_controller controllers[SOUNDPLANE_SHM_MAX_CONTROLLERS];
+	float sensor[SOUNDPLANE_SHM_SENSOR_HEIGHT][SOUNDPLANE_SHM_SENSOR_WIDTH];
+} soundplane_shm_frame;
+
+typedef struct
+{
+	uint64_t seq;
+	uint64_t reserved[7];	/* keep the frame on its own cache line */
+	soundplane_shm_frame frame;
+} soundplane_shm_slot;
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t slot_count;
+	uint32_t slot_size;
+	uint64_t frames_written;
+	uint64_t reserved[5];
+	soundplane_shm_slot slots[SOUNDPLANE_SHM_SLOTS];
+} soundplane_shm_header;
+
+/* the number of frames completed so far. Frame n is readable once this exceeds n,
+   until the writer reuses its slot SOUNDPLANE_SHM_SLOTS frames later. */
+static inline uint64_t soundplane_shm_frames_written(const soundplane_shm_header* h)
+{
+	return __atomic_load_n(&h->frames_written, __ATOMIC_ACQUIRE);
+}
+
+/* copy frame n into out. Returns 0 on success, or -1 if the frame is not complete
+   or has already been overwritten. */
+static inline int soundplane_shm_read_frame(const soundplane_shm_header* h, uint64_t n, soundplane_shm_frame* out)
+{
+	const soundplane_shm_slot* slot = &h->slots[n % SOUNDPLANE_SHM_SLOTS];
+	uint64_t expected = 2*(n + 1);
+	uint64_t s1 = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+	if(s1 != expected) return -1;
+	memcpy(out, &slot->frame, sizeof(soundplane_shm_frame));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	uint64_t s2 = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+	return (s2 == expected) ? 0 : -1;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* map an existing segment for reading. Returns NULL if it does not exist or does not
+   match this header. Unmap with soundplane_shm_close(). */
+static inline soundplane_shm_header* soundplane_shm_open(const char* name)
+{
+	struct stat st;
+	int fd = shm_open(name, O_RDONLY, 0);
+	if(fd < 0) return NULL;
+	if((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(soundplane_shm_header)))
+	{
+		close(fd);
+		return NULL;
+	}
+	void* p = mmap(NULL, sizeof(soundplane_shm_header), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(p == MAP_FAILED) return NULL;
+
+	/* the writer sets magic last, once the rest of the header is valid. */
+	soundplane_shm_header* h = (soundplane_shm_header*)p;
+	if((__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != SOUNDPLANE_SHM_MAGIC) || (h->version != SOUNDPLANE_SHM_VERSION) ||
+		(h->slot_size != sizeof(soundplane_shm_slot)))
+	{
+		munmap(p, sizeof(soundplane_shm_header));
+		return NULL;
+	}
+	return h;
+}
+
+static inline void soundplane_shm_close(soundplane_shm_header* h)
+{
+	if(h) munmap(h, sizeof(soundplane_shm_header));
+}
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SOUNDPLANE_SHM_H */
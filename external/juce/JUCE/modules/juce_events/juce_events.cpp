@@ -47,10 +47,12 @@
  #import <IOKit/pwr_mgt/IOPMLib.h>
 
 #elif JUCE_LINUX
- #include <X11/Xlib.h>
- #include <X11/Xresource.h>
- #include <X11/Xutil.h>
- #undef KeyPress
+ #if ! JUCE_EVENTS_HEADLESS
+  #include <X11/Xlib.h>
+  #include <X11/Xresource.h>
+  #include <X11/Xutil.h>
+  #undef KeyPress
+ #endif
  #include <unistd.h>
 #endif
 
@@ -85,7 +87,11 @@ namespace juce
 
 #elif JUCE_LINUX
  #include "native/juce_ScopedXLock.h"
- #include "native/juce_linux_Messaging.cpp"
+ #if JUCE_EVENTS_HEADLESS
+  #include "native/juce_linux_HeadlessMessaging.cpp"
+ #else
+  #include "native/juce_linux_Messaging.cpp"
+ #endif
 
 #elif JUCE_ANDROID
  #include "native/juce_android_Messaging.cpp"
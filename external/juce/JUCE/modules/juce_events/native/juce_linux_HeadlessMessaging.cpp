@@ -0,0 +1,230 @@
+/*
+  ==============================================================================
+
+   This file is part of the JUCE library.
+   Copyright (c) 2015 - ROLI Ltd.
+
+   Permission is granted to use this software under the terms of either:
+   a) the GPL v2 (or any later version)
+   b) the Affero GPL v3
+
+   Details of these licenses can be found at: www.gnu.org/licenses
+
+   JUCE is distributed in the hope that it will be useful, but WITHOUT ANY
+   WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR
+   A PARTICULAR PURPOSE.  See the GNU General Public License for more details.
+
+   ------------------------------------------------------------------------------
+
+   To release a closed-source product which uses JUCE, commercial licenses are
+   available: visit www.juce.com for more information.
+
+  ==============================================================================
+*/
+
+// The message queue without X11, for builds with no GUI (JUCE_EVENTS_HEADLESS).
+// Messages are passed through a socket pair as in juce_linux_Messaging.cpp, and
+// there is never a display.
+
+//==============================================================================
+ScopedXLock::ScopedXLock()       {}
+ScopedXLock::~ScopedXLock()      {}
+
+//==============================================================================
+class InternalMessageQueue
+{
+public:
+    InternalMessageQueue()
+        : bytesInSocket (0)
+    {
+        int ret = ::socketpair (AF_LOCAL, SOCK_STREAM, 0, fd);
+        ignoreUnused (ret); jassert (ret == 0);
+    }
+
+    ~InternalMessageQueue()
+    {
+        close (fd[0]);
+        close (fd[1]);
+
+        clearSingletonInstance();
+    }
+
+    //==============================================================================
+    void postMessage (MessageManager::MessageBase* const msg)
+    {
+        const int maxBytesInSocketQueue = 128;
+
+        ScopedLock sl (lock);
+        queue.add (msg);
+
+        if (bytesInSocket < maxBytesInSocketQueue)
+        {
+            ++bytesInSocket;
+
+            ScopedUnlock ul (lock);
+            const unsigned char x = 0xff;
+            ssize_t bytesWritten = write (fd[0], &x, 1);
+            ignoreUnused (bytesWritten);
+        }
+    }
+
+    bool isEmpty() const
+    {
+        ScopedLock sl (lock);
+        return queue.size() == 0;
+    }
+
+    bool dispatchNextEvent()
+    {
+        return dispatchNextInternalMessage();
+    }
+
+    // Wait for an internal Message
+    bool sleepUntilEvent (const int timeoutMs)
+    {
+        if (! isEmpty())
+            return true;
+
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = timeoutMs * 1000;
+        int fd0 = getWaitHandle();
+
+        fd_set readset;
+        FD_ZERO (&readset);
+        FD_SET (fd0, &readset);
+
+        const int ret = select (fd0 + 1, &readset, 0, 0, &tv);
+        return (ret > 0); // ret <= 0 if error or timeout
+    }
+
+    //==============================================================================
+    juce_DeclareSingleton_SingleThreaded_Minimal (InternalMessageQueue)
+
+private:
+    CriticalSection lock;
+    ReferenceCountedArray <MessageManager::MessageBase> queue;
+    int fd[2];
+    int bytesInSocket;
+
+    int getWaitHandle() const noexcept      { return fd[1]; }
+
+    MessageManager::MessageBase::Ptr popNextMessage()
+    {
+        const ScopedLock sl (lock);
+
+        if (bytesInSocket > 0)
+        {
+            --bytesInSocket;
+
+            const ScopedUnlock ul (lock);
+            unsigned char x;
+            ssize_t numBytes = read (fd[1], &x, 1);
+            ignoreUnused (numBytes);
+        }
+
+        return queue.removeAndReturn (0);
+    }
+
+    bool dispatchNextInternalMessage()
+    {
+        if (const MessageManager::MessageBase::Ptr msg = popNextMessage())
+        {
+            JUCE_TRY
+            {
+                msg->messageCallback();
+                return true;
+            }
+            JUCE_CATCH_EXCEPTION
+        }
+
+        return false;
+    }
+};
+
+juce_ImplementSingleton_SingleThreaded (InternalMessageQueue)
+
+
+//==============================================================================
+namespace LinuxErrorHandling
+{
+    static bool errorOccurred = false;
+    static bool keyboardBreakOccurred = false;
+
+    //==============================================================================
+    void keyboardBreakSignalHandler (int sig)
+    {
+        if (sig == SIGINT)
+            keyboardBreakOccurred = true;
+    }
+
+    void installKeyboardBreakHandler()
+    {
+        struct sigaction saction;
+        sigset_t maskSet;
+        sigemptyset (&maskSet);
+        saction.sa_handler = keyboardBreakSignalHandler;
+        saction.sa_mask = maskSet;
+        saction.sa_flags = 0;
+        sigaction (SIGINT, &saction, 0);
+    }
+}
+
+//==============================================================================
+void MessageManager::doPlatformSpecificInitialisation()
+{
+    if (JUCEApplicationBase::isStandaloneApp())
+        LinuxErrorHandling::installKeyboardBreakHandler();
+
+    // Create the internal message queue
+    InternalMessageQueue::getInstance();
+}
+
+void MessageManager::doPlatformSpecificShutdown()
+{
+    InternalMessageQueue::deleteInstance();
+}
+
+bool MessageManager::postMessageToSystemQueue (MessageManager::MessageBase* const message)
+{
+    if (LinuxErrorHandling::errorOccurred)
+        return false;
+
+    InternalMessageQueue::getInstanceWithoutCreating()->postMessage (message);
+    return true;
+}
+
+void MessageManager::broadcastMessage (const String& /* value */)
+{
+    /* TODO */
+}
+
+// this function expects that it will NEVER be called simultaneously for two concurrent threads
+bool MessageManager::dispatchNextMessageOnSystemQueue (bool returnIfNoPendingMessages)
+{
+    while (! LinuxErrorHandling::errorOccurred)
+    {
+        if (LinuxErrorHandling::keyboardBreakOccurred)
+        {
+            LinuxErrorHandling::errorOccurred = true;
+
+            if (JUCEApplicationBase::isStandaloneApp())
+                Process::terminate();
+
+            break;
+        }
+
+        InternalMessageQueue* const queue = InternalMessageQueue::getInstanceWithoutCreating();
+        jassert (queue != nullptr);
+
+        if (queue->dispatchNextEvent())
+            return true;
+
+        if (returnIfNoPendingMessages)
+            break;
+
+        queue->sleepUntilEvent (2000);
+    }
+
+    return false;
+}
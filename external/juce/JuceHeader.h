@@ -13,10 +13,14 @@
 #include "JUCE/modules/juce_core/juce_core.h"
 #include "JUCE/modules/juce_data_structures/juce_data_structures.h"
 #include "JUCE/modules/juce_events/juce_events.h"
+
+// the core library and the daemon are built with ML_JUCE_HEADLESS, and see no GUI modules.
+#if ! ML_JUCE_HEADLESS
 #include "JUCE/modules/juce_graphics/juce_graphics.h"
 #include "JUCE/modules/juce_gui_basics/juce_gui_basics.h"
 #include "JUCE/modules/juce_gui_extra/juce_gui_extra.h"
 #include "JUCE/modules/juce_opengl/juce_opengl.h"
+#endif
 
 
 #endif // __JUCE_HEADER_H__
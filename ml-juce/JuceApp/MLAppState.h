@@ -8,8 +8,6 @@
 
 #include "JuceHeader.h"
 #include "MLModel.h"
-#include "MLWidget.h"
-#include "MLAppView.h"
 #include "MLTimer.h"
 #include "cJSON.h" // installed by madronalib
 
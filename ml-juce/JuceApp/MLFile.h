@@ -11,7 +11,7 @@
 
 #include "JuceHeader.h"
 #include "MLDefaultFileLocations.h"
-#include "MLMenu.h"
+#include "MLSymbol.h"
 #include "MLTextUtils.h"
 
 class MLFile
@@ -47,17 +47,33 @@ mProcessDelay(0)
 {
 	mRoot.setValue(MLFile(std::string(startDir.getFullPathName().toUTF8())));
 	setProperty("progress", 0.);
-	
-	//mRunThread = std::thread(&MLFileCollection::runThread, this);
 }
 
-
 void MLFileCollection::runThread()
 {
+	{
+		std::lock_guard<std::mutex> lock(mFilesMutex);
+		searchForFilesImmediate();
+		buildIndex();
+	}
+	
+	sendActionToListeners("begin");
+	int t = getSize();
+	for(int i=0; i<t; i++)
+	{
+		if(mCancelProcess) return;
+		processFileInMap(i);
+		if(mProcessDelay > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(mProcessDelay));
+		}
+	}
+	sendActionToListeners("end");
 }
 
 MLFileCollection::~MLFileCollection()
 {
+	cancelProcess();
 	for(std::list<Listener*>::iterator it = mpListeners.begin(); it != mpListeners.end(); it++)
 	{
 		Listener* pL = *it;
@@ -212,7 +228,7 @@ void MLFileCollection::dump() const
 //
 void MLFileCollection::processFileInMap(int i)
 {
-	if(ml::within(static_cast<size_t>(i), size_t(0), mFilesByIndex.size()))
+	if(ml::within(static_cast<size_t>(i), size_t(0), getSize()))
 	{
 		sendActionToListeners(ml::Symbol("process"), i);
 	}
@@ -220,22 +236,27 @@ void MLFileCollection::processFileInMap(int i)
 
 void MLFileCollection::sendActionToListeners(ml::Symbol action, int fileIndex)
 {
-	const MLFile& f = getFileByIndex(fileIndex);
+	const MLFile f = getFileByIndex(fileIndex);
+	size_t size = getSize();
 	
 	std::list<Listener*>::iterator it;
 	for(it = mpListeners.begin(); it != mpListeners.end(); it++)
 	{
 		Listener* pL = *it;
-		pL->processFileFromCollection(action, f, *this, fileIndex + 1, mFilesByIndex.size());
+		pL->processFileFromCollection(action, f, *this, fileIndex + 1, size);
 	}
 }
 
 int MLFileCollection::processFilesImmediate(int delay)
 {
 	cancelProcess();
-	int found = searchForFilesImmediate();
+	int found;
+	{
+		std::lock_guard<std::mutex> lock(mFilesMutex);
+		found = searchForFilesImmediate();
+		buildIndex();
+	}
 	mProcessDelay = delay;
-	buildIndex();
 	
 	sendActionToListeners("begin");
 	int t = getSize();
@@ -255,12 +276,14 @@ int MLFileCollection::processFilesImmediate(int delay)
 int MLFileCollection::processFiles(int delay)
 {
 	cancelProcess();
-	int found = searchForFilesImmediate();
+	int found;
+	{
+		std::lock_guard<std::mutex> lock(mFilesMutex);
+		found = searchForFilesImmediate();
+		buildIndex();
+	}
 	mProcessDelay = delay;
 	
-	// MLTEST
-	buildIndex();
-	
 	sendActionToListeners("begin");
 	int t = getSize();
 	for(int i=0; i<t; i++)
@@ -281,16 +304,24 @@ int MLFileCollection::processFiles(int delay)
 
 void MLFileCollection::processFilesInBackground(int delay)
 {
-	// TODO
+	cancelProcess();
+	mProcessDelay = delay;
+	mCancelProcess = false;
+	mRunThread = std::thread(&MLFileCollection::runThread, this);
 }
 
 void MLFileCollection::cancelProcess()
 {
-	//	stopThread(1000);
+	mCancelProcess = true;
+	if(mRunThread.joinable())
+	{
+		mRunThread.join();
+	}
 }
 
 std::string MLFileCollection::getFilePathByIndex(int idx)
 {
+	std::lock_guard<std::mutex> lock(mFilesMutex);
 	int size = mFilesByIndex.size();
 	if(ml::within(idx, 0, size))
 	{
@@ -302,6 +333,7 @@ std::string MLFileCollection::getFilePathByIndex(int idx)
 
 const MLFile MLFileCollection::getFileByIndex(int idx)
 {
+	std::lock_guard<std::mutex> lock(mFilesMutex);
 	int size = mFilesByIndex.size();
 	if(ml::within(idx, 0, size))
 	{
@@ -312,11 +344,13 @@ const MLFile MLFileCollection::getFileByIndex(int idx)
 
 const MLFile MLFileCollection::getFileByPath(const std::string& path)
 {
+	std::lock_guard<std::mutex> lock(mFilesMutex);
 	return mRoot.findValue(ml::Path(path.c_str()));
 }
 
 const int MLFileCollection::getFileIndexByPath(const std::string& path)
 {
+	std::lock_guard<std::mutex> lock(mFilesMutex);
 	int r = -1;
 	const MLFile& f = mRoot.findValue(ml::Path(path.c_str()));
 	
@@ -342,6 +376,7 @@ const MLFile MLFileCollection::createFile(const std::string& relativePathAndName
 	
 	// insert file into file tree at relative path
 	MLFile f(fullPath);
+	std::lock_guard<std::mutex> lock(mFilesMutex);
 	insertFileIntoMap(f.getJuceFile());
 	return f;
 }
@@ -398,47 +433,3 @@ ml::TextFragment MLFileCollection::getRelativePathFromName(const ml::TextFragmen
 	return (ml::textUtils::stripFileExtension(pf));
 }
 
-MLMenuPtr MLFileCollection::buildMenu(std::function<bool(FileTree::const_iterator)> includeFn) const
-{
-	MLMenuPtr root(new MLMenu());
-	std::vector< MLMenuPtr > menuStack;
-	menuStack.push_back(root);
-	for(auto it = mRoot.begin(); it != mRoot.end(); ++it)
-	{
-		if(!it.atEndOfMap())
-		{
-			ml::Symbol itemName = it.getLeafName();
-			if(it->isLeaf())
-			{
-				if(includeFn(it))
-				{
-					menuStack.back()->addItem(itemName.toString(), it.nodeHasValue());
-				}
-			}
-			else
-			{
-				// add submenu at current depth
-				MLMenuPtr newMenu (new MLMenu(itemName));
-				if(includeFn(it))
-				{
-					menuStack.back()->addSubMenu(newMenu);
-				}
-				menuStack.push_back(newMenu);
-			}
-		}
-		else
-		{
-			// note that *it will not have a valid value here!
-			MLMenuPtr popped = menuStack.back();
-			menuStack.pop_back();
-		}
-	}
-	return root;
-}
-
-MLMenuPtr MLFileCollection::buildMenu() const
-{
-	return buildMenu([=](ml::FileTree::const_iterator it){ return true; });
-}
-
-
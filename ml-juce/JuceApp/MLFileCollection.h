@@ -8,16 +8,24 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include "JuceHeader.h"
 #include "MLFile.h"
 #include "MLDefaultFileLocations.h"
-#include "MLMenu.h"
 #include "MLProperty.h"
 #include "MLTextUtils.h"
 #include "MLResourceMap.h"
 
+// menus are built by the GUI library, in MLFileCollectionMenu.cpp, so that the
+// collection itself needs no GUI.
+class MLMenu;
+typedef std::shared_ptr<MLMenu> MLMenuPtr;
+
 // a collection of files matching some kind of criteria. Uses the PropertySet interface
 // to report progress for searches.
 
@@ -66,7 +74,7 @@ namespace ml
 		~MLFileCollection();
 		
 		void clear();
-		size_t getSize() const { return mFilesByIndex.size(); }
+		size_t getSize() const { std::lock_guard<std::mutex> lock(mFilesMutex); return mFilesByIndex.size(); }
 		ml::Symbol getName() const { return mName; }
 		//const MLFile* getRoot() const { return (const_cast<const MLFile *>(&mRoot)); }
 		
@@ -84,10 +92,9 @@ namespace ml
 		// the given delay between files. returns the number of files found.
 		int processFiles(int delay = 0);
 		
-		// runs process thread in the background, to monitor any changes to the collection.
-		// the process thread keeps running and any changes are processed until cancelProcess()
-		// is called.
-		// UNIMPLEMENTED
+		// search for and process all files on a background thread, with the given delay in
+		// milliseconds between files, and return at once. Listeners are called on that thread.
+		// The collection can be read from other threads while the search runs.
 		void processFilesInBackground(int delay = 0);
 		
 		// will cancel the process thread started by either processFiles() or processFilesInBackground().
@@ -130,7 +137,11 @@ namespace ml
 		void run();
 		
 		void runThread();
-		//	std::thread mRunThread;
+		std::thread mRunThread;
+		std::atomic<bool> mCancelProcess{false};
+		
+		// guards mRoot and mFilesByIndex while a background search is changing them.
+		mutable std::mutex mFilesMutex;
 		
 		FileTree mRoot;
 		
@@ -0,0 +1,56 @@
+//
+//  MLFileCollectionMenu.cpp
+//  madronalib
+//
+//  Created by Randy Jones on 10/10/13.
+//
+//
+
+#include "MLFileCollection.h"
+#include "MLMenu.h"
+
+using namespace ml;
+
+MLMenuPtr MLFileCollection::buildMenu(std::function<bool(FileTree::const_iterator)> includeFn) const
+{
+	std::lock_guard<std::mutex> lock(mFilesMutex);
+	MLMenuPtr root(new MLMenu());
+	std::vector< MLMenuPtr > menuStack;
+	menuStack.push_back(root);
+	for(auto it = mRoot.begin(); it != mRoot.end(); ++it)
+	{
+		if(!it.atEndOfMap())
+		{
+			ml::Symbol itemName = it.getLeafName();
+			if(it->isLeaf())
+			{
+				if(includeFn(it))
+				{
+					menuStack.back()->addItem(itemName.toString(), it.nodeHasValue());
+				}
+			}
+			else
+			{
+				// add submenu at current depth
+				MLMenuPtr newMenu (new MLMenu(itemName));
+				if(includeFn(it))
+				{
+					menuStack.back()->addSubMenu(newMenu);
+				}
+				menuStack.push_back(newMenu);
+			}
+		}
+		else
+		{
+			// note that *it will not have a valid value here!
+			MLMenuPtr popped = menuStack.back();
+			menuStack.pop_back();
+		}
+	}
+	return root;
+}
+
+MLMenuPtr MLFileCollection::buildMenu() const
+{
+	return buildMenu([=](ml::FileTree::const_iterator it){ return true; });
+}